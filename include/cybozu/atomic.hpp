@@ -138,6 +138,34 @@ T AtomicExchange(T *p, T newValue)
 	return atomic_local::Tag<sizeof(T)>::AtomicExchangeSub(p, newValue);
 }
 
+/**
+	*p = 0 with a release barrier
+	use this to release a lock taken by AtomicCompareExchange
+*/
+template<class T>
+void AtomicRelease(T *p)
+{
+#ifdef _WIN32
+	AtomicExchange(p, T(0));
+#else
+	__sync_lock_release(p);
+#endif
+}
+
+/**
+	hint to the cpu in a spin-wait loop
+*/
+inline void cpuPause()
+{
+#if CYBOZU_HOST == CYBOZU_HOST_INTEL
+	_mm_pause();
+#elif defined(_WIN32) && CYBOZU_HOST == CYBOZU_HOST_ARM
+	__yield();
+#elif CYBOZU_HOST == CYBOZU_HOST_ARM
+	__asm__ __volatile__("yield");
+#endif
+}
+
 inline void mfence()
 {
 #if defined(_WIN32) && CYBOZU_HOST == CYBOZU_HOST_INTEL
@@ -49,6 +49,7 @@ struct AGGST {
 	static G1 P_;
 	static G2 Q_;
 	static std::vector<Fp6> Qcoeff_;
+	static FixedBaseMulG2 QbaseMul_; // for getPublicKey
 public:
 	static void init(const mcl::CurveParam& cp = mcl::BN254)
 	{
@@ -56,6 +57,7 @@ public:
 		hashAndMapToG1(P_, "0");
 		hashAndMapToG2(Q_, "0");
 		precomputeG2(Qcoeff_, Q_);
+		QbaseMul_.init(Q_, Fr::getBitSize());
 	}
 	class Signature : public fp::Serializable<Signature> {
 		G1 S_;
@@ -140,17 +142,12 @@ public:
 				e(aggSig, xQ) = prod_i e(hv[i], pub[i].Q)
 				<=> finalExp(e(-aggSig, xQ) * prod_i millerLoop(hv[i], pub[i].xQ)) == 1
 			*/
-			GT e1, e2;
-			precomputedMillerLoop(e1, -S_, Qcoeff_);
-			millerLoop(e2, hv[0], pubVec[0].xQ_);
-			for (size_t i = 1; i < n; i++) {
-				GT e;
-				millerLoop(e, hv[i], pubVec[i].xQ_);
-				e2 *= e;
+			PairingProductChecker checker;
+			checker.addPrecomputed(-S_, Qcoeff_);
+			for (size_t i = 0; i < n; i++) {
+				checker.add(hv[i], pubVec[i].xQ_);
 			}
-			e1 *= e2;
-			finalExp(e1, e1);
-			return e1.isOne();
+			return checker.check();
 		}
 		bool verify(const std::vector<std::string>& msgVec, const std::vector<PublicKey>& pubVec) const
 		{
@@ -287,7 +284,7 @@ public:
 		}
 		void getPublicKey(PublicKey& pub) const
 		{
-			G2::mul(pub.xQ_, Q_, x_);
+			QbaseMul_.mul(pub.xQ_, x_);
 		}
 		void sign(Signature& sig, const void *m, size_t mSize) const
 		{
@@ -304,6 +301,7 @@ public:
 template<size_t dummyImpl> G1 AGGST<dummyImpl>::P_;
 template<size_t dummyImpl> G2 AGGST<dummyImpl>::Q_;
 template<size_t dummyImpl> std::vector<Fp6> AGGST<dummyImpl>::Qcoeff_;
+template<size_t dummyImpl> FixedBaseMulG2 AGGST<dummyImpl>::QbaseMul_;
 
 typedef AGGST<> AGGS;
 typedef AGGS::SecretKey SecretKey;
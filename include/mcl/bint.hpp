@@ -442,6 +442,12 @@ MCL_DLL_API Unit divSmall(Unit *q, size_t qn, Unit *x, size_t xn, const Unit *y,
 */
 MCL_DLL_API size_t div(Unit *q, size_t qn, Unit *x, size_t xn, const Unit *y, size_t yn);
 
+/*
+	return the Jacobi symbol (x[xn]|y[yn]) for odd y
+	it is the Legendre symbol if y is prime
+*/
+MCL_DLL_API int jacobi(const Unit *x, size_t xn, const Unit *y, size_t yn);
+
 MCL_DLL_API void mod_SECP256K1(Unit *z, const Unit *x, const Unit *p);
 MCL_DLL_API void mul_SECP256K1(Unit *z, const Unit *x, const Unit *y, const Unit *p);
 MCL_DLL_API void sqr_SECP256K1(Unit *y, const Unit *x, const Unit *p);
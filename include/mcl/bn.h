@@ -484,9 +484,14 @@ MCLBN_DLL_API void mclBnGT_pow(mclBnGT *z, const mclBnGT *x, const mclBnFr *y);
 MCLBN_DLL_API void mclBnG1_mulVec(mclBnG1 *z, mclBnG1 *x, const mclBnFr *y, mclSize n);
 MCLBN_DLL_API void mclBnG2_mulVec(mclBnG2 *z, mclBnG2 *x, const mclBnFr *y, mclSize n);
 MCLBN_DLL_API void mclBnGT_powVec(mclBnGT *z, const mclBnGT *x, const mclBnFr *y, mclSize n);
+// z[i] = x[i] y[i] for i = 0, ..., n-1 (z[] is normalized and may be equal to x[])
+MCLBN_DLL_API void mclBnG1_mulEach(mclBnG1 *z, const mclBnG1 *x, const mclBnFr *y, mclSize n);
+MCLBN_DLL_API void mclBnG2_mulEach(mclBnG2 *z, const mclBnG2 *x, const mclBnFr *y, mclSize n);
 
 MCLBN_DLL_API void mclBn_pairing(mclBnGT *z, const mclBnG1 *x, const mclBnG2 *y);
 MCLBN_DLL_API void mclBn_finalExp(mclBnGT *y, const mclBnGT *x);
+// y[i] = finalExp(x[i]) for i = 0, ..., n-1 (y may be equal to x)
+MCLBN_DLL_API void mclBn_finalExpVec(mclBnGT *y, const mclBnGT *x, mclSize n);
 MCLBN_DLL_API void mclBn_millerLoop(mclBnGT *z, const mclBnG1 *x, const mclBnG2 *y);
 // z = prod_{i=0}^{n-1} millerLoop(x[i], y[i])
 MCLBN_DLL_API void mclBn_millerLoopVec(mclBnGT *z, const mclBnG1 *x, const mclBnG2 *y, mclSize n);
@@ -496,6 +501,30 @@ MCLBN_DLL_API void mclBn_millerLoopVec(mclBnGT *z, const mclBnG1 *x, const mclBn
 MCLBN_DLL_API void mclBn_millerLoopVecMT(mclBnGT *z, const mclBnG1 *x, const mclBnG2 *y, mclSize n, mclSize cpuN);
 MCLBN_DLL_API void mclBnG1_mulVecMT(mclBnG1 *z, mclBnG1 *x, const mclBnFr *y, mclSize n, mclSize cpuN);
 MCLBN_DLL_API void mclBnG2_mulVecMT(mclBnG2 *z, mclBnG2 *x, const mclBnFr *y, mclSize n, mclSize cpuN);
+MCLBN_DLL_API void mclBnGT_powVecMT(mclBnGT *z, const mclBnGT *x, const mclBnFr *y, mclSize n, mclSize cpuN);
+MCLBN_DLL_API void mclBn_finalExpVecMT(mclBnGT *y, const mclBnGT *x, mclSize n, mclSize cpuN);
+// multi thread version of mclBnG1_mulEach/mclBnG2_mulEach
+MCLBN_DLL_API void mclBnG1_mulEachMT(mclBnG1 *z, const mclBnG1 *x, const mclBnFr *y, mclSize n, mclSize cpuN);
+MCLBN_DLL_API void mclBnG2_mulEachMT(mclBnG2 *z, const mclBnG2 *x, const mclBnFr *y, mclSize n, mclSize cpuN);
+
+/*
+	same as mulVec/powVec/mulVecMT/powVecMT but use work[0:workSize] instead of malloc
+	if workSize >= the size returned by the corresponding get*WorkSize, otherwise work is ignored
+	work should be aligned to 8 bytes and each thread of *MT uses its own part of work
+	get*WorkSize returns 0 if no work is needed (e.g. mulVec/powVec with 16 < n < 128 uses only the stack)
+*/
+MCLBN_DLL_API mclSize mclBnG1_getMulVecWorkSize(mclSize n);
+MCLBN_DLL_API mclSize mclBnG2_getMulVecWorkSize(mclSize n);
+MCLBN_DLL_API mclSize mclBnGT_getPowVecWorkSize(mclSize n);
+MCLBN_DLL_API void mclBnG1_mulVecWork(mclBnG1 *z, mclBnG1 *x, const mclBnFr *y, mclSize n, void *work, mclSize workSize);
+MCLBN_DLL_API void mclBnG2_mulVecWork(mclBnG2 *z, mclBnG2 *x, const mclBnFr *y, mclSize n, void *work, mclSize workSize);
+MCLBN_DLL_API void mclBnGT_powVecWork(mclBnGT *z, const mclBnGT *x, const mclBnFr *y, mclSize n, void *work, mclSize workSize);
+MCLBN_DLL_API mclSize mclBnG1_getMulVecMTWorkSize(mclSize n, mclSize cpuN);
+MCLBN_DLL_API mclSize mclBnG2_getMulVecMTWorkSize(mclSize n, mclSize cpuN);
+MCLBN_DLL_API mclSize mclBnGT_getPowVecMTWorkSize(mclSize n, mclSize cpuN);
+MCLBN_DLL_API void mclBnG1_mulVecMTWork(mclBnG1 *z, mclBnG1 *x, const mclBnFr *y, mclSize n, mclSize cpuN, void *work, mclSize workSize);
+MCLBN_DLL_API void mclBnG2_mulVecMTWork(mclBnG2 *z, mclBnG2 *x, const mclBnFr *y, mclSize n, mclSize cpuN, void *work, mclSize workSize);
+MCLBN_DLL_API void mclBnGT_powVecMTWork(mclBnGT *z, const mclBnGT *x, const mclBnFr *y, mclSize n, mclSize cpuN, void *work, mclSize workSize);
 
 // return precomputedQcoeffSize * sizeof(Fp6) / sizeof(uint64_t)
 MCLBN_DLL_API int mclBn_getUint64NumToPrecompute(void);
@@ -507,6 +536,37 @@ MCLBN_DLL_API void mclBn_precomputedMillerLoop(mclBnGT *f, const mclBnG1 *P, con
 MCLBN_DLL_API void mclBn_precomputedMillerLoop2(mclBnGT *f, const mclBnG1 *P1, const uint64_t *Q1buf, const mclBnG1 *P2, const uint64_t *Q2buf);
 MCLBN_DLL_API void mclBn_precomputedMillerLoop2mixed(mclBnGT *f, const mclBnG1 *P1, const mclBnG2 *Q1, const mclBnG1 *P2, const uint64_t *Q2buf);
 
+/*
+	save Qbuf with a header (curve, Fp representation) to a file and mmap it
+	the data is valid only for the same curve, mode(Montgomery or not) and MCL_MAX_FP_BIT_SIZE
+*/
+// return byte size of serialized Qbuf
+MCLBN_DLL_API mclSize mclBn_getPrecomputedG2SerializeSize(void);
+// return written byte size if success else 0
+MCLBN_DLL_API mclSize mclBn_serializePrecomputedG2(void *buf, mclSize maxBufSize, const uint64_t *Qbuf);
+// return Qbuf in buf without copying if buf is valid else NULL
+MCLBN_DLL_API const uint64_t *mclBn_getPrecomputedG2FromBuffer(const void *buf, mclSize bufSize);
+
+/*
+	check prod_i e(P_i, Q_i) == 1 with only one final exponentiation
+	add functions may be called from multiple threads at the same time
+*/
+typedef struct mclBnPairingProductChecker mclBnPairingProductChecker;
+// return NULL if failure
+MCLBN_DLL_API mclBnPairingProductChecker *mclBnPairingProductChecker_create(void);
+MCLBN_DLL_API void mclBnPairingProductChecker_destroy(mclBnPairingProductChecker *c);
+MCLBN_DLL_API void mclBnPairingProductChecker_clear(mclBnPairingProductChecker *c);
+// multiply e(P, Q)
+MCLBN_DLL_API void mclBnPairingProductChecker_add(mclBnPairingProductChecker *c, const mclBnG1 *P, const mclBnG2 *Q);
+// multiply prod_{i=0}^{n-1} e(P[i], Q[i])
+MCLBN_DLL_API void mclBnPairingProductChecker_addVec(mclBnPairingProductChecker *c, const mclBnG1 *P, const mclBnG2 *Q, mclSize n);
+// multi thread version of addVec (enabled if the library built with MCL_USE_OMP=1, all cores are used if cpuN = 0)
+MCLBN_DLL_API void mclBnPairingProductChecker_addVecMT(mclBnPairingProductChecker *c, const mclBnG1 *P, const mclBnG2 *Q, mclSize n, mclSize cpuN);
+// multiply e(P, Q) where Qbuf is computed by mclBn_precomputeG2
+MCLBN_DLL_API void mclBnPairingProductChecker_addPrecomputed(mclBnPairingProductChecker *c, const mclBnG1 *P, const uint64_t *Qbuf);
+// return 1 if the product of the pairings is one else 0
+MCLBN_DLL_API int mclBnPairingProductChecker_check(mclBnPairingProductChecker *c);
+
 /*
 	Lagrange interpolation
 	recover out = y(0) by { (xVec[i], yVec[i]) }
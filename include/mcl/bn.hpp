@@ -19,6 +19,7 @@ void mulByCofactorBLS12fast(T& Q, const T& P);
 
 } } // mcl::local
 #include <mcl/mapto_wb19.hpp>
+#include <cybozu/atomic.hpp>
 #include <assert.h>
 #ifndef CYBOZU_DONT_USE_EXCEPTION
 #include <vector>
@@ -50,6 +51,21 @@ struct FpTag;
 struct FrTag;
 }
 
+} // mcl::bn
+
+/*
+	MCL_FP_INLINE_CURVE = MCL_BN254 or MCL_BLS12_381
+	Fp and Fr use fp::InlineFpT of the curve instead of Op and initPairing fails for the other curves
+*/
+#ifdef MCL_FP_INLINE_CURVE
+namespace fp {
+template<> struct InlineModT<MCL_NAMESPACE_BN::local::FpTag> : InlineCurveT<MCL_FP_INLINE_CURVE>::Fp {};
+template<> struct InlineModT<MCL_NAMESPACE_BN::local::FrTag> : InlineCurveT<MCL_FP_INLINE_CURVE>::Fr {};
+} // mcl::fp
+#endif
+
+namespace MCL_NAMESPACE_BN {
+
 typedef mcl::FpT<local::FpTag, MCL_MAX_FP_BIT_SIZE> Fp;
 typedef mcl::FpT<local::FrTag, MCL_MAX_FR_BIT_SIZE> Fr;
 typedef mcl::Fp2T<Fp> Fp2;
@@ -311,16 +327,13 @@ struct MapTo {
 
 	int legendre(bool *pb, const Fp& x) const
 	{
-		mpz_class xx;
-		x.getMpz(pb, xx);
-		if (!*pb) return 0;
-		return gmp::legendre(xx, Fp::getOp().mp);
+		*pb = true;
+		return Fp::legendre(x);
 	}
 	int legendre(bool *pb, const Fp2& x) const
 	{
-		Fp y;
-		Fp2::norm(y, x);
-		return legendre(pb, y);
+		*pb = true;
+		return Fp2::legendre(x);
 	}
 	void mulFp(Fp& x, const Fp& y) const
 	{
@@ -361,7 +374,8 @@ struct MapTo {
 			case 2: F::sqr(x, w); F::inv(x, x); *x.getFp0() += Fp::one(); break;
 			}
 			G::getWeierstrass(y, x);
-			if (F::squareRoot(y, y)) {
+			// the Legendre symbol is cheaper than squareRoot of a non-square
+			if (F::isSquare(y) && F::squareRoot(y, y)) {
 				if (negative) F::neg(y, y);
 				P.set(&b, x, y, false);
 				assert(b);
@@ -656,7 +670,10 @@ struct GLV1 : mcl::GLV1T<G1, Fr> {
 	}
 	static void initForBN(const mpz_class& z, bool isBLS12 = false, int curveType = -1)
 	{
-		if (usePrecomputedTable(curveType)) return;
+		if (usePrecomputedTable(curveType)) {
+			initSplitUnit();
+			return;
+		}
 		bool b = Fp::squareRoot(rw, -3);
 		assert(b);
 		(void)b;
@@ -690,6 +707,7 @@ struct GLV1 : mcl::GLV1T<G1, Fr> {
 		const mpz_class& r = Fr::getOp().mp;
 		v0 = ((-B[1][1]) << rBitSize) / r;
 		v1 = ((B[1][0]) << rBitSize) / r;
+		initSplitUnit();
 	}
 };
 
@@ -707,6 +725,9 @@ struct GLV2T {
 	static mpz_class z;
 	static mpz_class abs_z;
 	static bool isBLS12;
+	static const size_t splitUnitN = _Fr::maxSize;
+	static mcl::local::GLVSplitUnitT<4, splitUnitN> splitUnit_;
+	static Unit abs_z1; // abs_z if it is one Unit else 0
 	static void init(const mpz_class& z, bool isBLS12 = false)
 	{
 		const mpz_class& r = Fr::getOp().mp;
@@ -759,6 +780,8 @@ struct GLV2T {
 			v[2] = ((z * (1 + z * (4 + z * 6))) << rBitSize) / r;
 			v[3] = -((z * (1 + z * 2)) << rBitSize) / r;
 		}
+		abs_z1 = gmp::getUnitSize(abs_z) == 1 ? gmp::getUnit(abs_z)[0] : 0;
+		splitUnit_.init(v, B, rBitSize);
 	}
 	/*
 		u[] = [x, 0, 0, 0] - v[] * x * B
@@ -798,6 +821,35 @@ struct GLV2T {
 			}
 		}
 	}
+	// |u_j| <= |z| for BLS12 and |u_j| < 8|z| for BN
+	static size_t getSplitMaxBitSize()
+	{
+		return gmp::getBitSize(abs_z) + (isBLS12 ? 0 : 3);
+	}
+	/*
+		same as split for x[0:xn] without mpz_class
+		u[i] = abs(u_i), isNeg[i] = u_i < 0
+	*/
+	static void splitUnit(bool isNeg[4], Unit u[4][splitUnitN], const Unit *x, size_t xn)
+	{
+		Unit t[splitUnitN];
+		xn = mcl::local::modForSplit<Fr, splitUnitN>(t, x, xn);
+		if (isBLS12 && abs_z1) {
+			bint::clearN(t + xn, splitUnitN - xn);
+			for (int i = 0; i < 4; i++) {
+				bint::clearN(u[i], splitUnitN);
+				// t = t / abs_z, u[i] = t % abs_z
+				u[i][0] = bint::divUnit(t, t, splitUnitN, abs_z1);
+				isNeg[i] = (z < 0) && (i & 1) && u[i][0];
+			}
+			return;
+		}
+		if (splitUnit_.enabled) {
+			splitUnit_.split(isNeg, u, t, xn);
+		} else {
+			mcl::local::splitByMpz<GLV2, splitUnitN>(isNeg, u, t, xn);
+		}
+	}
 	template<class T>
 	static void mulLambda(T& Q, const T& P)
 	{
@@ -811,6 +863,8 @@ template<class Fr> mpz_class GLV2T<Fr>::v[4];
 template<class Fr> mpz_class GLV2T<Fr>::z;
 template<class Fr> mpz_class GLV2T<Fr>::abs_z;
 template<class Fr> bool GLV2T<Fr>::isBLS12 = false;
+template<class Fr> mcl::local::GLVSplitUnitT<4, GLV2T<Fr>::splitUnitN> GLV2T<Fr>::splitUnit_;
+template<class Fr> Unit GLV2T<Fr>::abs_z1 = 0;
 
 struct Param {
 	CurveParam cp;
@@ -985,14 +1039,6 @@ namespace local {
 
 typedef GLV2T<Fr> GLV2;
 
-inline bool powVecGLV(Fp12& z, const Fp12 *xVec, const void *yVec, size_t n, fp::getMpzAtType getMpzAt, fp::getUnitAtType getUnitAt)
-{
-	typedef GroupMtoA<Fp12> AG; // as additive group
-	AG& _z = static_cast<AG&>(z);
-	const AG *_xVec = static_cast<const AG*>(xVec);
-	return mcl::ec::mulVecGLVT<GLV2, AG, Fr>(_z, _xVec, yVec, n, getMpzAt, getUnitAt);
-}
-
 /*
 	Faster Squaring in the Cyclotomic Subgroup of Sixth Degree Extensions
 	Robert Granger, Michael Scott
@@ -1099,6 +1145,188 @@ inline void pow_z(Fp12& y, const Fp12& x)
 		Fp12::unitaryInv(y, y);
 	}
 }
+// window size of powVecBucket for m sub-scalars
+inline size_t getPowVecBucketWindow(size_t m, size_t maxBit)
+{
+	size_t c = 2;
+	size_t minCost = ~size_t(0);
+	for (size_t i = 2; i <= 16; i++) {
+		// maxBit + 1 bits for the signed digits
+		const size_t cost = (maxBit + i) / i * (m + (size_t(1) << i));
+		if (cost < minCost) {
+			minCost = cost;
+			c = i;
+		}
+	}
+	return c;
+}
+/*
+	byte size of the workspace used by powVecBucket
+	it is rounded up to sizeof(Unit) to keep each part of work of powVecMT aligned
+*/
+inline size_t getPowVecBucketWorkSize(size_t n)
+{
+	const size_t m = n * GLV2::splitN;
+	const size_t maxBit = GLV2::getSplitMaxBitSize();
+	const size_t c = getPowVecBucketWindow(m, maxBit);
+	const size_t winN = (maxBit + c) / c;
+	const size_t bucketN = size_t(1) << (c - 1);
+	const size_t size = sizeof(Fp12) * (m + bucketN) + sizeof(int) * m * winN + bucketN;
+	return (size + sizeof(Unit) - 1) & ~(sizeof(Unit) - 1);
+}
+/*
+	z = prod_{i=0}^{n-1} xVec[i]^yVec[i] by the bucket method for xVec[i] in GT
+	yVec[i] is split into 4 sub-scalars by GLV2 and each is recoded into signed c-bit digits
+	a negative digit uses unitaryInv and empty buckets are skipped instead of multiplied by 1
+	use work of getPowVecBucketWorkSize(n) bytes instead of malloc if work != 0
+	return false if malloc fails
+*/
+inline bool powVecBucket(Fp12& z, const Fp12 *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt, void *work = 0)
+{
+	const int splitN = GLV2::splitN;
+	const size_t m = n * splitN;
+	const size_t maxBit = GLV2::getSplitMaxBitSize();
+	const size_t c = getPowVecBucketWindow(m, maxBit);
+	const size_t winN = (maxBit + c) / c;
+	const size_t bucketN = size_t(1) << (c - 1);
+	const size_t tblByteSize = sizeof(Fp12) * (m + bucketN);
+	const size_t digitByteSize = sizeof(int) * m * winN;
+	char *buf = (char*)(work ? work : malloc(tblByteSize + digitByteSize + bucketN));
+	if (buf == 0) return false;
+	Fp12 *tbl = (Fp12*)buf;
+	Fp12 *bucket = tbl + m;
+	int *digit = (int*)(buf + tblByteSize);
+	bool *used = (bool*)(buf + tblByteSize + digitByteSize);
+
+	const Unit mask = (Unit(1) << c) - 1;
+	Unit u[splitN][GLV2::splitUnitN], y[maxUnitSize];
+	bool isNeg[splitN];
+	bint::clearN(y, maxUnitSize);
+	for (size_t i = 0; i < n; i++) {
+		getUnitAt(y, yVec, i);
+		GLV2::splitUnit(isNeg, u, y, maxUnitSize);
+		Fp12 t = xVec[i];
+		for (int j = 0; j < splitN; j++) {
+			const size_t idx = j * n + i;
+			if (j > 0) GLV2::mulLambda(t, t);
+			if (isNeg[j]) {
+				Fp12::unitaryInv(tbl[idx], t);
+			} else {
+				tbl[idx] = t;
+			}
+			const Unit *p = u[j];
+			const size_t pn = GLV2::splitUnitN;
+			if (fp::BitIterator<Unit>(p, pn).getBitSize() > maxBit) {
+				if (work == 0) free(buf);
+				return false;
+			}
+			int *d = digit + idx * winN;
+			int carry = 0;
+			for (size_t w = 0; w < winN; w++) {
+				int v = int(fp::getUnitAt(p, pn, c * w) & mask) + carry;
+				if (v > int(bucketN)) {
+					v -= int(mask) + 1;
+					carry = 1;
+				} else {
+					carry = 0;
+				}
+				d[w] = v;
+			}
+			assert(carry == 0);
+		}
+	}
+	Fp12 out;
+	bool outIsOne = true;
+	for (size_t k = 0; k < winN; k++) {
+		const size_t w = winN - 1 - k;
+		if (!outIsOne) {
+			for (size_t i = 0; i < c; i++) fasterSqr(out, out);
+		}
+		memset(used, 0, bucketN);
+		for (size_t i = 0; i < m; i++) {
+			const int v = digit[i * winN + w];
+			if (v == 0) continue;
+			const size_t b = size_t(v > 0 ? v : -v) - 1;
+			Fp12 t;
+			const Fp12 *x = &tbl[i];
+			if (v < 0) {
+				Fp12::unitaryInv(t, *x);
+				x = &t;
+			}
+			if (used[b]) {
+				bucket[b] *= *x;
+			} else {
+				bucket[b] = *x;
+				used[b] = true;
+			}
+		}
+		// acc = prod_{b} bucket[b]^(b+1)
+		Fp12 sum, acc;
+		bool sumIsOne = true, accIsOne = true;
+		for (size_t i = 0; i < bucketN; i++) {
+			const size_t b = bucketN - 1 - i;
+			if (used[b]) {
+				if (sumIsOne) {
+					sum = bucket[b];
+					sumIsOne = false;
+				} else {
+					sum *= bucket[b];
+				}
+			}
+			if (sumIsOne) continue;
+			if (accIsOne) {
+				acc = sum;
+				accIsOne = false;
+			} else {
+				acc *= sum;
+			}
+		}
+		if (accIsOne) continue;
+		if (outIsOne) {
+			out = acc;
+			outIsOne = false;
+		} else {
+			out *= acc;
+		}
+	}
+	if (outIsOne) {
+		z = 1;
+	} else {
+		z = out;
+	}
+	if (work == 0) free(buf);
+	return true;
+}
+
+inline bool powVecGLV(Fp12& z, const Fp12 *xVec, const void *yVec, size_t n, fp::getMpzAtType getMpzAt, fp::getUnitAtType getUnitAt)
+{
+	if (n > mcl::fp::maxMulVecNGLV && powVecBucket(z, xVec, yVec, n, getUnitAt)) return true;
+	typedef GroupMtoA<Fp12> AG; // as additive group
+	AG& _z = static_cast<AG&>(z);
+	const AG *_xVec = static_cast<const AG*>(xVec);
+	return mcl::ec::mulVecGLVT<GLV2, AG, Fr>(_z, _xVec, yVec, n, getMpzAt, getUnitAt);
+}
+
+inline size_t getPowVecGLVworkSize(size_t n)
+{
+	if (n > mcl::fp::maxMulVecNGLV) return getPowVecBucketWorkSize(n);
+	return mcl::ec::getMulVecGLVworkSizeT<GLV2, GroupMtoA<Fp12> >(n);
+}
+/*
+	same as powVecGLV but use work instead of malloc and alloca
+	work is used as arrays of Fp12 and int, so return false if it is not aligned to sizeof(Unit)
+*/
+inline bool powVecGLVwork(Fp12& z, const Fp12 *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt, void *work, size_t workSize)
+{
+	if (n == 0 || work == 0 || workSize < getPowVecGLVworkSize(n)) return false;
+	if (size_t(work) % sizeof(Unit) != 0) return false;
+	if (n > mcl::fp::maxMulVecNGLV) return powVecBucket(z, xVec, yVec, n, getUnitAt, work);
+	typedef GroupMtoA<Fp12> AG; // as additive group
+	AG& _z = static_cast<AG&>(z);
+	const AG *_xVec = static_cast<const AG*>(xVec);
+	return mcl::ec::mulVecGLVworkT<GLV2, AG>(_z, _xVec, yVec, n, getUnitAt, work, workSize);
+}
+
 inline void mul_twist_b(Fp2& y, const Fp2& x)
 {
 	switch (BN::param.twist_b_type) {
@@ -1220,28 +1448,31 @@ inline void mulFp6cb_by_G1xy(Fp6& y, const Fp6& x, const G1& P)
 	z = xy = (a + bv + cv^2)(d + ev)
 	= (ad + ce xi) + ((a + b)(d + e) - ad - be)v + (be + cd)v^2
 */
-inline void Fp6mul_01(Fp6& z, const Fp6& x, const Fp2& d, const Fp2& e)
+inline void Fp6mul_01Dbl(Fp6Dbl& z, const Fp6& x, const Fp2& d, const Fp2& e)
 {
 	const Fp2& a = x.a;
 	const Fp2& b = x.b;
 	const Fp2& c = x.c;
 	Fp2 t0, t1;
-	Fp2Dbl AD, CE, BE, CD, T;
+	Fp2Dbl AD, CE, BE, CD;
 	Fp2Dbl::mulPre(AD, a, d);
 	Fp2Dbl::mulPre(CE, c, e);
 	Fp2Dbl::mulPre(BE, b, e);
 	Fp2Dbl::mulPre(CD, c, d);
 	Fp2::add(t0, a, b);
 	Fp2::add(t1, d, e);
-	Fp2Dbl::mulPre(T, t0, t1);
-	T -= AD;
-	T -= BE;
-	Fp2Dbl::mod(z.b, T);
+	Fp2Dbl::mulPre(z.b, t0, t1);
+	z.b -= AD;
+	z.b -= BE;
 	Fp2Dbl::mul_xi(CE, CE);
-	AD += CE;
-	Fp2Dbl::mod(z.a, AD);
-	BE += CD;
-	Fp2Dbl::mod(z.c, BE);
+	Fp2Dbl::add(z.a, AD, CE);
+	Fp2Dbl::add(z.c, BE, CD);
+}
+inline void Fp6mul_01(Fp6& z, const Fp6& x, const Fp2& d, const Fp2& e)
+{
+	Fp6Dbl Z;
+	Fp6mul_01Dbl(Z, x, d, e);
+	Fp6Dbl::mod(z, Z);
 }
 /*
 	input
@@ -1256,6 +1487,7 @@ inline void Fp6mul_01(Fp6& z, const Fp6& x, const Fp2& d, const Fp2& e)
 	Z0X0 = Z0 b
 	Z1X1 = Z1 (c, a, 0)
 	(Z0 + Z1)(X0 + X1) = (Z0 + Z1) (b + c, a, 0)
+	the products are kept in Fp6Dbl and each coefficient is reduced once
 */
 inline void mul_403(Fp12& z, const Fp6& x)
 {
@@ -1264,22 +1496,21 @@ inline void mul_403(Fp12& z, const Fp6& x)
 	const Fp2& c = x.c;
 	Fp6& z0 = z.a;
 	Fp6& z1 = z.b;
-	Fp6 z0x0, z1x1, t0;
+	Fp6Dbl Z0X0, Z1X1, T;
+	Fp6 t0;
 	Fp2 t1;
 	Fp2::add(t1, x.b, c);
 	Fp6::add(t0, z0, z1);
-	Fp2::mul(z0x0.a, z0.a, b);
-	Fp2::mul(z0x0.b, z0.b, b);
-	Fp2::mul(z0x0.c, z0.c, b);
-	Fp6mul_01(z1x1, z1, c, a);
-	Fp6mul_01(t0, t0, t1, a);
-	Fp6::sub(z.b, t0, z0x0);
-	z.b -= z1x1;
-	// a + bv + cv^2 = cxi + av + bv^2
-	Fp2::mul_xi(z1x1.c, z1x1.c);
-	Fp2::add(z.a.a, z0x0.a, z1x1.c);
-	Fp2::add(z.a.b, z0x0.b, z1x1.a);
-	Fp2::add(z.a.c, z0x0.c, z1x1.b);
+	Fp2Dbl::mulPre(Z0X0.a, z0.a, b);
+	Fp2Dbl::mulPre(Z0X0.b, z0.b, b);
+	Fp2Dbl::mulPre(Z0X0.c, z0.c, b);
+	Fp6mul_01Dbl(Z1X1, z1, c, a);
+	Fp6mul_01Dbl(T, t0, t1, a);
+	Fp6Dbl::sub(T, T, Z0X0);
+	Fp6Dbl::sub(T, T, Z1X1);
+	Fp6Dbl::mod(z.b, T);
+	Fp12::mulVadd(T, Z1X1, Z0X0);
+	Fp6Dbl::mod(z.a, T);
 }
 /*
 	input
@@ -1296,6 +1527,7 @@ inline void mul_403(Fp12& z, const Fp6& x)
 	(Z0 + Z1)(X0 + X1) = (Z0 + Z1) (a, b + c, 0)
 
 	(a + bv + cv^2)v = c xi + av + bv^2
+	the products are kept in Fp6Dbl and each coefficient is reduced once
 */
 inline void mul_041(Fp12& z, const Fp6& x)
 {
@@ -1304,23 +1536,22 @@ inline void mul_041(Fp12& z, const Fp6& x)
 	const Fp2& c = x.c;
 	Fp6& z0 = z.a;
 	Fp6& z1 = z.b;
-	Fp6 z0x0, z1x1, t0;
+	Fp6Dbl Z0X0, Z1X1, T;
+	Fp6 t0;
 	Fp2 t1;
-	Fp2::mul(z1x1.a, z1.c, b);
-	Fp2::mul_xi(z1x1.a, z1x1.a);
-	Fp2::mul(z1x1.b, z1.a, b);
-	Fp2::mul(z1x1.c, z1.b, b);
+	Fp2Dbl::mulPre(Z1X1.a, z1.c, b);
+	Fp2Dbl::mul_xi(Z1X1.a, Z1X1.a);
+	Fp2Dbl::mulPre(Z1X1.b, z1.a, b);
+	Fp2Dbl::mulPre(Z1X1.c, z1.b, b);
 	Fp2::add(t1, x.b, c);
 	Fp6::add(t0, z0, z1);
-	Fp6mul_01(z0x0, z0, a, c);
-	Fp6mul_01(t0, t0, a, t1);
-	Fp6::sub(z.b, t0, z0x0);
-	z.b -= z1x1;
-	// a + bv + cv^2 = cxi + av + bv^2
-	Fp2::mul_xi(z1x1.c, z1x1.c);
-	Fp2::add(z.a.a, z0x0.a, z1x1.c);
-	Fp2::add(z.a.b, z0x0.b, z1x1.a);
-	Fp2::add(z.a.c, z0x0.c, z1x1.b);
+	Fp6mul_01Dbl(Z0X0, z0, a, c);
+	Fp6mul_01Dbl(T, t0, a, t1);
+	Fp6Dbl::sub(T, T, Z0X0);
+	Fp6Dbl::sub(T, T, Z1X1);
+	Fp6Dbl::mod(z.b, T);
+	Fp12::mulVadd(T, Z1X1, Z0X0);
+	Fp6Dbl::mod(z.a, T);
 }
 inline void mulSparse(Fp12& z, const Fp6& x)
 {
@@ -1350,10 +1581,62 @@ inline void convertFp6toFp12(Fp12& y, const Fp6& x)
 		y.b.c.clear();
 	}
 }
+/*
+	z = xy for x = (a, b, c) and y = (d, e, f) converted by convertFp6toFp12
+	M-type : x = (a, c, 0, 0, b, 0), y = (d, f, 0, 0, e, 0)
+	z = (ad + be xi, af + cd, cf, 0, ae + bd, bf + ce)
+	D-type : x = (b, 0, 0, c, a, 0), y = (e, 0, 0, f, d, 0)
+	z = (be + ad xi, cf, af + cd, bf + ce, ae + bd, 0)
+	af + cd = (a + c)(d + f) - ad - cf
+	ae + bd = (a + b)(d + e) - ad - be
+	bf + ce = (b + c)(e + f) - be - cf
+*/
 inline void mulSparse2(Fp12& z, const Fp6& x, const Fp6& y)
 {
-	convertFp6toFp12(z, x);
-	mulSparse(z, y);
+	const Fp2& a = x.a;
+	const Fp2& b = x.b;
+	const Fp2& c = x.c;
+	const Fp2& d = y.a;
+	const Fp2& e = y.b;
+	const Fp2& f = y.c;
+	Fp2 t0, t1;
+	Fp2Dbl AD, BE, CF, AF_CD, AE_BD, BF_CE;
+	Fp2Dbl::mulPre(AD, a, d);
+	Fp2Dbl::mulPre(BE, b, e);
+	Fp2Dbl::mulPre(CF, c, f);
+	Fp2::add(t0, a, c);
+	Fp2::add(t1, d, f);
+	Fp2Dbl::mulPre(AF_CD, t0, t1);
+	AF_CD -= AD;
+	AF_CD -= CF;
+	Fp2::add(t0, a, b);
+	Fp2::add(t1, d, e);
+	Fp2Dbl::mulPre(AE_BD, t0, t1);
+	AE_BD -= AD;
+	AE_BD -= BE;
+	Fp2::add(t0, b, c);
+	Fp2::add(t1, e, f);
+	Fp2Dbl::mulPre(BF_CE, t0, t1);
+	BF_CE -= BE;
+	BF_CE -= CF;
+	Fp2Dbl::mod(z.b.b, AE_BD);
+	if (BN::param.cp.isMtype) {
+		Fp2Dbl::mul_xi(BE, BE);
+		AD += BE;
+		Fp2Dbl::mod(z.a.a, AD);
+		Fp2Dbl::mod(z.a.b, AF_CD);
+		Fp2Dbl::mod(z.a.c, CF);
+		z.b.a.clear();
+		Fp2Dbl::mod(z.b.c, BF_CE);
+	} else {
+		Fp2Dbl::mul_xi(AD, AD);
+		AD += BE;
+		Fp2Dbl::mod(z.a.a, AD);
+		Fp2Dbl::mod(z.a.b, CF);
+		Fp2Dbl::mod(z.a.c, AF_CD);
+		Fp2Dbl::mod(z.b.a, BF_CE);
+		z.b.c.clear();
+	}
 }
 inline void mapToCyclotomic(Fp12& y, const Fp12& x)
 {
@@ -1543,6 +1826,646 @@ inline void finalExp(Fp12& y, const Fp12& x)
 		expHardPartBN(y, y);
 	}
 }
+/*
+	y[i] = finalExp(x[i]) for i = 0, ..., n-1
+	share the inversions of the easy part by Montgomery's trick
+	&y[0] may be equal to &x[0]
+*/
+inline void finalExpVec(Fp12 *y, const Fp12 *x, size_t n)
+{
+	const size_t N = 16;
+	Fp12 z[N], w[N];
+	while (n > 0) {
+		const size_t m = fp::min_(n, N);
+		for (size_t i = 0; i < m; i++) {
+			Fp12::Frobenius2(z[i], x[i]);
+			z[i] *= x[i]; // x^(p^2 + 1)
+		}
+		Fp12::invVec(w, z, m);
+		for (size_t i = 0; i < m; i++) {
+			if (x[i].isZero()) {
+				y[i].clear();
+				continue;
+			}
+			Fp6::neg(z[i].b, z[i].b);
+			Fp12::mul(y[i], w[i], z[i]);
+			if (BN::param.isBLS12) {
+				expHardPartBLS12(y[i], y[i]);
+			} else {
+				expHardPartBN(y[i], y[i]);
+			}
+		}
+		x += m;
+		y += m;
+		n -= m;
+	}
+}
+/*
+	multi thread version of finalExpVec
+	the num of thread is automatically detected if cpuN = 0
+*/
+inline void finalExpVecMT(Fp12 *y, const Fp12 *x, size_t n, size_t cpuN = 0)
+{
+#ifdef MCL_USE_OMP
+	const size_t minN = 16;
+	if (cpuN == 0) {
+		cpuN = omp_get_num_procs();
+		if (n < minN * cpuN) {
+			cpuN = (n + minN - 1) / minN;
+		}
+	}
+	if (cpuN <= 1 || n <= cpuN) {
+		finalExpVec(y, x, n);
+		return;
+	}
+	size_t q = n / cpuN;
+	size_t r = n % cpuN;
+	#pragma omp parallel for
+	for (size_t i = 0; i < cpuN; i++) {
+		size_t adj = q * i + fp::min_(i, r);
+		finalExpVec(y + adj, x + adj, q + (i < r));
+	}
+#else
+	(void)cpuN;
+	finalExpVec(y, x, n);
+#endif
+}
+
+/*
+	compressed GT by the algebraic torus T2
+	x = a + bw in GT (a, b in Fp6, w^2 = v) satisfies a^2 - b^2 v = 1
+	then x is represented by c = (1 + a) / b in Fp6 (half of Fp12)
+	and x = (c + w) / (c - w) = ((c^2 + v) + 2cw) / (c^2 - v)
+	c = 0 means x = 1 (x = -1 is not in GT)
+*/
+class CompressedGT : public fp::Serializable<CompressedGT> {
+	Fp6 c_;
+	static void getDenomi(Fp6& d, Fp6& cc, const Fp6& c)
+	{
+		Fp6::sqr(cc, c);
+		d = cc;
+		d.b.a -= Fp::one(); // c^2 - v
+	}
+	static void decompressAfterInv(Fp12& x, const Fp6& c, const Fp6& cc, const Fp6& invD)
+	{
+		Fp6 t = cc;
+		t.b.a += Fp::one(); // c^2 + v
+		Fp6::mul(x.a, t, invD);
+		Fp6::mul2(t, c);
+		Fp6::mul(x.b, t, invD);
+	}
+public:
+	CompressedGT() { c_.clear(); }
+	explicit CompressedGT(const Fp12& x) { set(x); }
+	const Fp6& getFp6() const { return c_; }
+	void clear() { c_.clear(); } // 1
+	bool isOne() const { return c_.isZero(); }
+	bool operator==(const CompressedGT& rhs) const { return c_ == rhs.c_; }
+	bool operator!=(const CompressedGT& rhs) const { return !operator==(rhs); }
+	/*
+		x must be in GT
+	*/
+	void set(const Fp12& x)
+	{
+		if (x.b.isZero()) {
+			c_.clear();
+			return;
+		}
+		Fp6 t;
+		Fp6::inv(t, x.b);
+		Fp6 a = x.a;
+		a.a.a += Fp::one();
+		Fp6::mul(c_, a, t);
+	}
+	void get(Fp12& x) const
+	{
+		if (c_.isZero()) {
+			x = 1;
+			return;
+		}
+		Fp6 d, cc;
+		getDenomi(d, cc, c_);
+		Fp6::inv(d, d);
+		decompressAfterInv(x, c_, cc, d);
+	}
+	/*
+		y[i] = compress(x[i]) with one Fp6 inversion per 32 elements
+	*/
+	static void compressVec(CompressedGT *y, const Fp12 *x, size_t n)
+	{
+		const size_t N = 32;
+		Fp6 t[N];
+		while (n > 0) {
+			const size_t m = fp::min_(n, N);
+			for (size_t i = 0; i < m; i++) t[i] = x[i].b;
+			Fp6::invVec(t, t, m);
+			for (size_t i = 0; i < m; i++) {
+				if (x[i].b.isZero()) {
+					y[i].c_.clear();
+					continue;
+				}
+				Fp6 a = x[i].a;
+				a.a.a += Fp::one();
+				Fp6::mul(y[i].c_, a, t[i]);
+			}
+			x += m;
+			y += m;
+			n -= m;
+		}
+	}
+	/*
+		y[i] = decompress(x[i]) with one Fp6 inversion per 32 elements
+	*/
+	static void decompressVec(Fp12 *y, const CompressedGT *x, size_t n)
+	{
+		const size_t N = 32;
+		Fp6 d[N], cc[N];
+		while (n > 0) {
+			const size_t m = fp::min_(n, N);
+			for (size_t i = 0; i < m; i++) {
+				if (x[i].c_.isZero()) {
+					d[i].clear();
+				} else {
+					getDenomi(d[i], cc[i], x[i].c_);
+				}
+			}
+			Fp6::invVec(d, d, m);
+			for (size_t i = 0; i < m; i++) {
+				if (x[i].c_.isZero()) {
+					y[i] = 1;
+				} else {
+					decompressAfterInv(y[i], x[i].c_, cc[i], d[i]);
+				}
+			}
+			x += m;
+			y += m;
+			n -= m;
+		}
+	}
+	/*
+		z = x^y
+		decompress x and use GT::pow (GLV with cyclotomic squaring)
+	*/
+	static void pow(CompressedGT& z, const CompressedGT& x, const Fr& y)
+	{
+		Fp12 t;
+		x.get(t);
+		Fp12::pow(t, t, y);
+		z.set(t);
+	}
+	/*
+		any c decompresses to x in T2 (x^(p^6 + 1) = 1)
+		return true if x is also in the cyclotomic subgroup (x^(p^4 - p^2 + 1) = 1)
+		the order r of x is not checked (use GT::pow(x, r) if necessary)
+	*/
+	bool isValid() const
+	{
+		Fp12 x, y, z;
+		get(x);
+		Fp12::Frobenius2(y, x); // x^(p^2)
+		Fp12::Frobenius2(z, y); // x^(p^4)
+		z *= x;
+		return z == y;
+	}
+	/*
+		load fails if the loaded value is not valid (see isValid)
+	*/
+	template<class InputStream>
+	void load(bool *pb, InputStream& is, int ioMode)
+	{
+		c_.load(pb, is, ioMode);
+		if (*pb && !isValid()) {
+			c_.clear();
+			*pb = false;
+		}
+	}
+	template<class OutputStream>
+	void save(bool *pb, OutputStream& os, int ioMode) const
+	{
+		c_.save(pb, os, ioMode);
+	}
+#ifndef CYBOZU_DONT_USE_EXCEPTION
+	template<class InputStream>
+	void load(InputStream& is, int ioMode = IoSerialize)
+	{
+		bool b;
+		load(&b, is, ioMode);
+		if (!b) throw cybozu::Exception("CompressedGT:load");
+	}
+	template<class OutputStream>
+	void save(OutputStream& os, int ioMode = IoSerialize) const
+	{
+		bool b;
+		save(&b, os, ioMode);
+		if (!b) throw cybozu::Exception("CompressedGT:save");
+	}
+#endif
+#ifndef CYBOZU_DONT_USE_STRING
+	friend std::istream& operator>>(std::istream& is, CompressedGT& self)
+	{
+		self.load(is, fp::detectIoMode(Fp::BaseFp::getIoMode(), is));
+		return is;
+	}
+	friend std::ostream& operator<<(std::ostream& os, const CompressedGT& self)
+	{
+		self.save(os, fp::detectIoMode(Fp::BaseFp::getIoMode(), os));
+		return os;
+	}
+#endif
+};
+
+/*
+	fixed-base exponentiation of GT
+	y = u_0 + u_1 L + u_2 L^2 + u_3 L^3 (GLV2::split) where x^L = Frobenius(x)
+	x^y = prod_{j=0}^{3} (x_j)^(u_j) where x_j = Frobenius^j(x)
+	|u_j| < 2^(a h) is divided into h teeth of a bits (comb method)
+	tbl_[j][d] = prod_{i : bit i of d is 1} x_j^(2^(i a)) for d in [0, 2^h)
+	pow costs (a - 1) cyclotomic squarings and 4a multiplications
+	memory : 4 * 2^h Fp12
+*/
+class FixedBasePowGT {
+	Fp12 x_;
+	size_t h_;
+	size_t a_;
+	mcl::Array<Fp12> tbl_;
+	static bool getBit(const Unit *x, size_t n, size_t pos)
+	{
+		const size_t q = pos / UnitBitSize;
+		if (q >= n) return false;
+		return (x[q] >> (pos % UnitBitSize)) & 1;
+	}
+public:
+	FixedBasePowGT() : h_(0), a_(0) {}
+	/*
+		x must be in GT
+		h : num of teeth (the table has 4 * 2^h elements)
+	*/
+	void init(bool *pb, const Fp12& x, size_t h = 8)
+	{
+		if (h == 0 || h > 16) {
+			*pb = false;
+			return;
+		}
+		const size_t tblN = size_t(1) << h;
+		*pb = tbl_.resize(tblN * local::GLV2::splitN);
+		if (!*pb) return;
+		x_ = x;
+		h_ = h;
+		a_ = (local::GLV2::getSplitMaxBitSize() + h - 1) / h;
+		Fp12 *tbl = tbl_.data();
+		tbl[0] = 1;
+		Fp12 t = x;
+		for (size_t i = 0; i < h; i++) {
+			if (i > 0) {
+				for (size_t k = 0; k < a_; k++) local::fasterSqr(t, t);
+			}
+			const size_t d = size_t(1) << i;
+			tbl[d] = t;
+			for (size_t k = 1; k < d; k++) {
+				Fp12::mul(tbl[d + k], tbl[k], t);
+			}
+		}
+		for (size_t j = 1; j < size_t(local::GLV2::splitN); j++) {
+			for (size_t d = 0; d < tblN; d++) {
+				local::GLV2::mulLambda(tbl[j * tblN + d], tbl[(j - 1) * tblN + d]);
+			}
+		}
+	}
+#ifndef CYBOZU_DONT_USE_EXCEPTION
+	void init(const Fp12& x, size_t h = 8)
+	{
+		bool b;
+		init(&b, x, h);
+		if (!b) throw cybozu::Exception("FixedBasePowGT:init") << h;
+	}
+#endif
+	const Fp12& getBase() const { return x_; }
+	size_t getTeethNum() const { return h_; }
+	// z = x^y
+	void pow(Fp12& z, const Fr& y) const
+	{
+		const int splitN = local::GLV2::splitN;
+		const size_t un = local::GLV2::splitUnitN;
+		Unit u[splitN][un], ya[un];
+		bool isNeg[splitN];
+		y.getUnitArray(ya);
+		local::GLV2::splitUnit(isNeg, u, ya, Fr::getUnitSize());
+		for (int j = 0; j < splitN; j++) {
+			if (fp::BitIterator<Unit>(u[j], un).getBitSize() > a_ * h_) {
+				// not reached for valid parameters
+				Fp12::pow(z, x_, y);
+				return;
+			}
+		}
+		const size_t tblN = size_t(1) << h_;
+		Fp12 out = 1;
+		for (size_t k = 0; k < a_; k++) {
+			const size_t pos = a_ - 1 - k;
+			if (k > 0) local::fasterSqr(out, out);
+			for (int j = 0; j < splitN; j++) {
+				size_t d = 0;
+				for (size_t i = 0; i < h_; i++) {
+					d |= size_t(getBit(u[j], un, i * a_ + pos)) << i;
+				}
+				if (d == 0) continue;
+				const Fp12& v = tbl_[j * tblN + d];
+				if (isNeg[j]) {
+					Fp12 w;
+					Fp12::unitaryInv(w, v);
+					out *= w;
+				} else {
+					out *= v;
+				}
+			}
+		}
+		z = out;
+	}
+	// x^y = x^(y mod r) because x is in GT
+	void pow(Fp12& z, const mpz_class& y) const
+	{
+		const mpz_class& r = Fr::getOp().mp;
+		mpz_class t = y % r;
+		if (t < 0) t += r;
+		Fr f;
+		bool b;
+		f.setMpz(&b, t);
+		assert(b); (void)b;
+		pow(z, f);
+	}
+};
+
+namespace local {
+
+template<class G> struct GLVSelector;
+template<> struct GLVSelector<G1> { typedef GLV1 GLV; };
+template<> struct GLVSelector<G2> { typedef GLV2 GLV; };
+
+} // mcl::bn::local
+
+/*
+	z = sum_{i=0}^{n-1} xVec[i] yVec[i] for fixed xVec[] (G = G1 or G2)
+	yVec[i] is split into splitN sub-scalars by GLV and each sub-scalar into winN signed c-bit digits
+	the table has 2^(c w) L^j xVec[i] (L is the endomorphism) for all i, j and w,
+	so mulVec adds n * splitN * winN points into 2^(c-1) buckets without any doubling
+	the buckets are allocated by init/load and reused by mulVec
+	the table is saved/loaded in affine coordinates (ioMode is ignored)
+	and is valid only for the same curve
+*/
+template<class G>
+class FixedBaseMSM : public fp::Serializable<FixedBaseMSM<G> > {
+	typedef typename local::GLVSelector<G>::GLV GLV;
+	static const int splitN = GLV::splitN;
+	size_t n_;
+	size_t c_;
+	size_t winN_;
+	// tbl_[(j * winN_ + w) * n_ + i] = 2^(c_ w) L^j xVec[i]
+	mcl::Array<G> tbl_;
+	// bucket_[v - 1] for the digit v = 1, ..., 2^(c_-1)
+	mcl::Array<G> bucket_;
+	static size_t getMaxBitSize()
+	{
+		return GLV::getSplitMaxBitSize();
+	}
+	// the top digit may have a carry
+	static size_t getWinN(size_t c)
+	{
+		return getMaxBitSize() / c + 1;
+	}
+	static size_t getBucketN(size_t c)
+	{
+		return size_t(1) << (c - 1);
+	}
+	static void writeUint32(bool *pb, uint8_t *buf, size_t v)
+	{
+		if (v > 0xffffffff) {
+			*pb = false;
+			return;
+		}
+		for (int i = 0; i < 4; i++) buf[i] = uint8_t(v >> (i * 8));
+	}
+	static size_t readUint32(const uint8_t *buf)
+	{
+		size_t v = 0;
+		for (int i = 0; i < 4; i++) v |= size_t(buf[i]) << (i * 8);
+		return v;
+	}
+	/*
+		return the number of points of the table for n bases and winN windows
+		return 0 if n is out of range or the table size overflows
+	*/
+	static size_t getTblSize(size_t n, size_t winN)
+	{
+		if (n == 0 || n > maxBaseN || winN == 0) return 0;
+		const size_t maxTblN = ~size_t(0) / sizeof(G);
+		if (n > maxTblN / splitN / winN) return 0;
+		return n * splitN * winN;
+	}
+public:
+	// the max number of bases
+	static const size_t maxBaseN = size_t(1) << 28;
+	FixedBaseMSM() : n_(0), c_(0), winN_(0) {}
+	/*
+		n : the number of bases (1 <= n <= maxBaseN)
+		c : window size (1 <= c <= 20) which is automatically chosen if c = 0
+		the table has n * splitN * (floor(maxBit / c) + 1) points and there are 2^(c-1) buckets
+		*pb = false if c is out of range or malloc fails
+	*/
+	void init(bool *pb, const G *xVec, size_t n, size_t c = 0)
+	{
+		n_ = 0;
+		c_ = 0;
+		winN_ = 0;
+		if (c == 0) {
+			size_t minCost = ~size_t(0);
+			for (size_t i = 2; i <= 20; i++) {
+				const size_t cost = n * splitN * getWinN(i) + getBucketN(i) * 2;
+				if (cost < minCost) {
+					minCost = cost;
+					c = i;
+				}
+			}
+		}
+		if (c == 0 || c > 20) {
+			*pb = false;
+			return;
+		}
+		const size_t winN = getWinN(c);
+		const size_t tblN = getTblSize(n, winN);
+		if (tblN == 0) {
+			*pb = false;
+			return;
+		}
+		*pb = tbl_.resize(tblN) && bucket_.resize(getBucketN(c));
+		if (!*pb) return;
+		G *tbl = tbl_.data();
+		G::normalizeVec(tbl, xVec, n);
+		for (size_t w = 1; w < winN; w++) {
+			G *t = tbl + w * n;
+			const G *prev = t - n;
+			for (size_t i = 0; i < n; i++) {
+				G::dbl(t[i], prev[i]);
+				for (size_t k = 1; k < c; k++) G::dbl(t[i], t[i]);
+			}
+			G::normalizeVec(t, t, n);
+		}
+		const size_t m = winN * n;
+		for (int j = 1; j < splitN; j++) {
+			G *t = tbl + j * m;
+			const G *prev = t - m;
+			for (size_t i = 0; i < m; i++) {
+				GLV::mulLambda(t[i], prev[i]);
+			}
+		}
+		n_ = n;
+		c_ = c;
+		winN_ = winN;
+	}
+#ifndef CYBOZU_DONT_USE_EXCEPTION
+	void init(const G *xVec, size_t n, size_t c = 0)
+	{
+		bool b;
+		init(&b, xVec, n, c);
+		if (!b) throw cybozu::Exception("FixedBaseMSM:init") << n << c;
+	}
+#endif
+	size_t getBaseNum() const { return n_; }
+	size_t getWindowSize() const { return c_; }
+	/*
+		z = sum_{i=0}^{n-1} xVec[i] yVec[i] for n <= getBaseNum()
+		mulVec uses the buckets of this object, so do not call it for the same object in parallel
+	*/
+	void mulVec(G& z, const Fr *yVec, size_t n)
+	{
+		assert(n <= n_);
+		z.clear();
+		if (n == 0) return;
+		const size_t bucketN = getBucketN(c_);
+		const size_t maxBit = c_ * winN_ - 1;
+		const Unit mask = (Unit(1) << c_) - 1;
+		const G *tbl = tbl_.data();
+		G *bucket = bucket_.data();
+		for (size_t i = 0; i < bucketN; i++) bucket[i].clear();
+		const size_t yn = Fr::getUnitSize();
+		Unit u[splitN][GLV::splitUnitN], y[GLV::splitUnitN];
+		bool isNeg[splitN];
+		for (size_t i = 0; i < n; i++) {
+			yVec[i].getUnitArray(y);
+			GLV::splitUnit(isNeg, u, y, yn);
+			bool fit = true;
+			for (int j = 0; j < splitN; j++) {
+				if (fp::BitIterator<Unit>(u[j], GLV::splitUnitN).getBitSize() > maxBit) fit = false;
+			}
+			if (!fit) {
+				// not reached for valid parameters
+				G t;
+				G::mul(t, tbl[i], yVec[i]);
+				z += t;
+				continue;
+			}
+			for (int j = 0; j < splitN; j++) {
+				const G *t = tbl + j * winN_ * n_ + i;
+				Unit carry = 0;
+				for (size_t w = 0; w < winN_; w++) {
+					// signed digit v in [-2^(c-1) + 1, 2^(c-1)]
+					Unit v = (fp::getUnitAt(u[j], GLV::splitUnitN, c_ * w) & mask) + carry;
+					bool neg = isNeg[j];
+					if (v > bucketN) {
+						v = mask + 1 - v;
+						neg = !neg;
+						carry = 1;
+					} else {
+						carry = 0;
+					}
+					if (v == 0) continue;
+					if (neg) {
+						bucket[v - 1] -= t[w * n_];
+					} else {
+						bucket[v - 1] += t[w * n_];
+					}
+				}
+			}
+		}
+		G sum, win;
+		sum.clear();
+		win.clear();
+		for (size_t i = 0; i < bucketN; i++) {
+			sum += bucket[bucketN - 1 - i];
+			win += sum;
+		}
+		z += win;
+	}
+	template<class InputStream>
+	void load(bool *pb, InputStream& is, int /*ioMode*/ = IoSerialize)
+	{
+		n_ = 0;
+		c_ = 0;
+		winN_ = 0;
+		uint8_t buf[16];
+		cybozu::read(pb, buf, sizeof(buf), is);
+		if (!*pb) return;
+		const size_t n = readUint32(buf);
+		const size_t c = readUint32(buf + 4);
+		const size_t winN = readUint32(buf + 8);
+		if (readUint32(buf + 12) != size_t(splitN) || c == 0 || c > 20 || winN != getWinN(c)) {
+			*pb = false;
+			return;
+		}
+		const size_t tblN = getTblSize(n, winN);
+		if (tblN == 0) {
+			*pb = false;
+			return;
+		}
+		*pb = tbl_.resize(tblN) && bucket_.resize(getBucketN(c));
+		if (!*pb) return;
+		G *tbl = tbl_.data();
+		for (size_t i = 0; i < tbl_.size(); i++) {
+			tbl[i].load(pb, is, IoEcAffineSerialize);
+			if (!*pb) return;
+		}
+		n_ = n;
+		c_ = c;
+		winN_ = winN;
+	}
+	template<class OutputStream>
+	void save(bool *pb, OutputStream& os, int /*ioMode*/ = IoSerialize) const
+	{
+		uint8_t buf[16];
+		*pb = true;
+		writeUint32(pb, buf, n_);
+		writeUint32(pb, buf + 4, c_);
+		writeUint32(pb, buf + 8, winN_);
+		writeUint32(pb, buf + 12, splitN);
+		if (!*pb) return;
+		cybozu::write(pb, os, buf, sizeof(buf));
+		if (!*pb) return;
+		const G *tbl = tbl_.data();
+		for (size_t i = 0; i < tbl_.size(); i++) {
+			tbl[i].save(pb, os, IoEcAffineSerialize);
+			if (!*pb) return;
+		}
+	}
+#ifndef CYBOZU_DONT_USE_EXCEPTION
+	template<class InputStream>
+	void load(InputStream& is, int ioMode = IoSerialize)
+	{
+		bool b;
+		load(&b, is, ioMode);
+		if (!b) throw cybozu::Exception("FixedBaseMSM:load");
+	}
+	template<class OutputStream>
+	void save(OutputStream& os, int ioMode = IoSerialize) const
+	{
+		bool b;
+		save(&b, os, ioMode);
+		if (!b) throw cybozu::Exception("FixedBaseMSM:save");
+	}
+#endif
+};
+
+// fixed-base multiplication with GLV
+typedef fp::FixedBaseMul<G1, local::GLV1> FixedBaseMulG1;
+typedef fp::FixedBaseMul<G2, local::GLV2> FixedBaseMulG2;
+
 inline void millerLoop(Fp12& f, const G1& P_, const G2& Q_)
 {
 	G1 P(P_);
@@ -1671,6 +2594,116 @@ void precomputeG2(bool *pb, Array& Qcoeff, const G2& Q)
 	precomputeG2(Qcoeff.data(), Q);
 }
 
+/*
+	binary format of precomputed G2 (Qcoeff) to save it to a file and mmap it
+	PrecomputedG2Header (64 bytes) + Fp6 Qcoeff[precomputedQcoeffSize]
+	Qcoeff is stored in the internal representation of Fp (Montgomery form if Fp::isMont()),
+	so the data is valid only for the same curve, Fp representation and MCL_MAX_FP_BIT_SIZE
+	@note all integers are stored in the native byte order
+*/
+struct PrecomputedG2Header {
+	static const uint32_t MAGIC = 0x5132636d; // "mc2Q" in little endian
+	static const uint32_t VERSION = 1;
+	uint32_t magic;
+	uint32_t version;
+	uint32_t curveType;
+	uint32_t isMont;
+	uint32_t unitBitSize;
+	uint32_t fpBitSize;
+	uint32_t sizeofFp6;
+	uint32_t n; // precomputedQcoeffSize
+	uint64_t pHash; // hash of p
+	uint8_t reserved[24];
+	void set()
+	{
+		memset(this, 0, sizeof(*this));
+		magic = MAGIC;
+		version = VERSION;
+		curveType = uint32_t(BN::param.cp.curveType);
+		isMont = Fp::isMont() ? 1 : 0;
+		unitBitSize = uint32_t(MCL_UNIT_BIT_SIZE);
+		fpBitSize = uint32_t(Fp::getBitSize());
+		sizeofFp6 = uint32_t(sizeof(Fp6));
+		n = uint32_t(BN::param.precomputedQcoeffSize);
+		pHash = cybozu::hash64(Fp::getOp().p, Fp::getUnitSize());
+	}
+	bool isValid() const
+	{
+		PrecomputedG2Header h;
+		h.set();
+		return memcmp(this, &h, sizeof(h)) == 0;
+	}
+};
+
+/*
+	return byte size of serialized precomputed G2
+*/
+inline size_t getPrecomputedG2SerializeSize()
+{
+	return sizeof(PrecomputedG2Header) + BN::param.precomputedQcoeffSize * sizeof(Fp6);
+}
+/*
+	write header and Qcoeff to buf
+	return written byte size or 0 if maxBufSize is too small
+*/
+inline size_t serializePrecomputedG2(void *buf, size_t maxBufSize, const Fp6 *Qcoeff)
+{
+	const size_t size = getPrecomputedG2SerializeSize();
+	if (maxBufSize < size) return 0;
+	PrecomputedG2Header h;
+	h.set();
+	uint8_t *p = (uint8_t*)buf;
+	memcpy(p, &h, sizeof(h));
+	memcpy(p + sizeof(h), Qcoeff, size - sizeof(h));
+	return size;
+}
+/*
+	return Qcoeff in buf without copying if buf is a valid serialized precomputed G2
+	return NULL if the header does not match the current setting, an element is out of range
+	or buf is not aligned for Fp6
+	the returned pointer can be passed to precomputedMillerLoop while buf is alive
+*/
+inline const Fp6 *getPrecomputedG2FromBuffer(const void *buf, size_t bufSize)
+{
+	if (bufSize < getPrecomputedG2SerializeSize()) return 0;
+	if (((uintptr_t)buf % sizeof(Unit)) != 0) return 0;
+	const PrecomputedG2Header *h = (const PrecomputedG2Header*)buf;
+	if (!h->isValid()) return 0;
+	const Fp6 *Qcoeff = (const Fp6*)(h + 1);
+	const Fp *x = Qcoeff[0].getFp0();
+	for (size_t i = 0; i < BN::param.precomputedQcoeffSize * 6; i++) {
+		if (!x[i].isValid()) return 0;
+	}
+	return Qcoeff;
+}
+/*
+	copy serialized precomputed G2 in buf to Qcoeff
+	return read byte size or 0 if error
+*/
+inline size_t deserializePrecomputedG2(Fp6 *Qcoeff, const void *buf, size_t bufSize)
+{
+	const size_t size = getPrecomputedG2SerializeSize();
+	if (bufSize < size) return 0;
+	PrecomputedG2Header h;
+	memcpy(&h, buf, sizeof(h));
+	if (!h.isValid()) return 0;
+	memcpy((void*)Qcoeff, (const uint8_t*)buf + sizeof(h), size - sizeof(h));
+	const Fp *x = Qcoeff[0].getFp0();
+	for (size_t i = 0; i < BN::param.precomputedQcoeffSize * 6; i++) {
+		if (!x[i].isValid()) return 0;
+	}
+	return size;
+}
+#ifndef CYBOZU_DONT_USE_EXCEPTION
+inline void deserializePrecomputedG2(std::vector<Fp6>& Qcoeff, const void *buf, size_t bufSize)
+{
+	Qcoeff.resize(BN::param.precomputedQcoeffSize);
+	if (deserializePrecomputedG2(Qcoeff.data(), buf, bufSize) == 0) {
+		throw cybozu::Exception("deserializePrecomputedG2");
+	}
+}
+#endif
+
 inline void precomputedMillerLoop(Fp12& f, const G1& P_, const Fp6* Qcoeff)
 {
 	G1 P(P_);
@@ -2021,6 +3054,192 @@ inline void millerLoopVecMT(Fp12& f, const G1* Pvec, const G2* Qvec, size_t n, s
 #endif
 }
 
+/*
+	check prod_i e(P_i, Q_i) == 1 with only one finalExp
+	(P, Q) are buffered and maxPendingN pairs are computed at once by millerLoopVec
+	(P, Qcoeff) are computed by precomputedMillerLoop(2) at once
+	add functions and merge may be called from multiple threads at the same time
+	the Miller loops run out of the lock and only the multiplication of the result is serialized
+*/
+class PairingProductChecker {
+public:
+	static const size_t maxPendingN = 16;
+private:
+	Fp12 f_;
+	G1 P_[maxPendingN];
+	G2 Q_[maxPendingN];
+	size_t n_;
+	int lock_;
+	void lock()
+	{
+		int n = 1;
+		while (cybozu::AtomicCompareExchange(&lock_, 1, 0) != 0) {
+			for (int i = 0; i < n; i++) cybozu::cpuPause();
+			if (n < 1024) n *= 2;
+		}
+	}
+	void unlock()
+	{
+		cybozu::AtomicRelease(&lock_);
+	}
+	void mulMillerLoop(const Fp12& e)
+	{
+		lock();
+		f_ *= e;
+		unlock();
+	}
+	// move pending pairs to (Pvec, Qvec) and return the num
+	size_t takePending(G1 *Pvec, G2 *Qvec)
+	{
+		lock();
+		const size_t n = n_;
+		for (size_t i = 0; i < n; i++) {
+			Pvec[i] = P_[i];
+			Qvec[i] = Q_[i];
+		}
+		n_ = 0;
+		unlock();
+		return n;
+	}
+	void flush()
+	{
+		G1 Pvec[maxPendingN];
+		G2 Qvec[maxPendingN];
+		const size_t n = takePending(Pvec, Qvec);
+		if (n == 0) return;
+		Fp12 e;
+		millerLoopVec(e, Pvec, Qvec, n);
+		mulMillerLoop(e);
+	}
+public:
+	PairingProductChecker()
+	{
+		clear();
+	}
+	PairingProductChecker(const PairingProductChecker& rhs)
+		: f_(rhs.f_)
+		, n_(rhs.n_)
+		, lock_(0)
+	{
+		for (size_t i = 0; i < n_; i++) {
+			P_[i] = rhs.P_[i];
+			Q_[i] = rhs.Q_[i];
+		}
+	}
+	PairingProductChecker& operator=(const PairingProductChecker& rhs)
+	{
+		if (this == &rhs) return *this;
+		clear();
+		merge(rhs);
+		return *this;
+	}
+	// not thread safe
+	void clear()
+	{
+		f_ = 1;
+		n_ = 0;
+		lock_ = 0;
+	}
+	// multiply e(P, Q)
+	void add(const G1& P, const G2& Q)
+	{
+		if (P.isZero() || Q.isZero()) return;
+		G1 Pvec[maxPendingN];
+		G2 Qvec[maxPendingN];
+		lock();
+		P_[n_] = P;
+		Q_[n_] = Q;
+		n_++;
+		if (n_ < maxPendingN) {
+			unlock();
+			return;
+		}
+		for (size_t i = 0; i < maxPendingN; i++) {
+			Pvec[i] = P_[i];
+			Qvec[i] = Q_[i];
+		}
+		n_ = 0;
+		unlock();
+		Fp12 e;
+		millerLoopVec(e, Pvec, Qvec, maxPendingN);
+		mulMillerLoop(e);
+	}
+	// multiply prod_{i=0}^{n-1} e(Pvec[i], Qvec[i])
+	void addVec(const G1 *Pvec, const G2 *Qvec, size_t n)
+	{
+		if (n == 0) return;
+		Fp12 e;
+		millerLoopVec(e, Pvec, Qvec, n);
+		mulMillerLoop(e);
+	}
+	// multi thread version of addVec
+	void addVecMT(const G1 *Pvec, const G2 *Qvec, size_t n, size_t cpuN = 0)
+	{
+		if (n == 0) return;
+		Fp12 e;
+		millerLoopVecMT(e, Pvec, Qvec, n, cpuN);
+		mulMillerLoop(e);
+	}
+	// multiply e(P, Q) where Qcoeff is precomputed by precomputeG2(Qcoeff, Q)
+	void addPrecomputed(const G1& P, const Fp6 *Qcoeff)
+	{
+		if (P.isZero()) return;
+		Fp12 e;
+		precomputedMillerLoop(e, P, Qcoeff);
+		mulMillerLoop(e);
+	}
+	// multiply e(P1, Q1) e(P2, Q2)
+	void addPrecomputed2(const G1& P1, const Fp6 *Q1coeff, const G1& P2, const Fp6 *Q2coeff)
+	{
+		if (P1.isZero()) {
+			addPrecomputed(P2, Q2coeff);
+			return;
+		}
+		if (P2.isZero()) {
+			addPrecomputed(P1, Q1coeff);
+			return;
+		}
+		Fp12 e;
+		precomputedMillerLoop2(e, P1, Q1coeff, P2, Q2coeff);
+		mulMillerLoop(e);
+	}
+#ifndef CYBOZU_DONT_USE_EXCEPTION
+	void addPrecomputed(const G1& P, const std::vector<Fp6>& Qcoeff)
+	{
+		addPrecomputed(P, Qcoeff.data());
+	}
+	void addPrecomputed2(const G1& P1, const std::vector<Fp6>& Q1coeff, const G1& P2, const std::vector<Fp6>& Q2coeff)
+	{
+		addPrecomputed2(P1, Q1coeff.data(), P2, Q2coeff.data());
+	}
+#endif
+	// multiply all pairs accumulated in rhs (rhs must not be modified at the same time)
+	void merge(const PairingProductChecker& rhs)
+	{
+		if (this == &rhs) return;
+		for (size_t i = 0; i < rhs.n_; i++) {
+			add(rhs.P_[i], rhs.Q_[i]);
+		}
+		mulMillerLoop(rhs.f_);
+	}
+	// f = prod of Miller loops of all pairs
+	void getMillerLoop(Fp12& f)
+	{
+		flush();
+		lock();
+		f = f_;
+		unlock();
+	}
+	// return true if prod_i e(P_i, Q_i) == 1
+	bool check()
+	{
+		Fp12 f;
+		getMillerLoop(f);
+		finalExp(f, f);
+		return f.isOne();
+	}
+};
+
 inline bool setMapToMode(int mode)
 {
 	return BN::nonConstParam.mapTo.setMapToMode(mode);
@@ -2200,7 +3419,12 @@ inline void init(bool *pb, const mcl::CurveParam& cp = mcl::BN254, fp::Mode mode
 	if (!*pb) return;
 	G1::setMulVecGLV(mcl::ec::mulVecGLVT<local::GLV1, G1, Fr>);
 	G2::setMulVecGLV(mcl::ec::mulVecGLVT<local::GLV2, G2, Fr>);
+	G1::setMulVecGLVwork(mcl::ec::mulVecGLVworkT<local::GLV1, G1>, mcl::ec::getMulVecGLVworkSizeT<local::GLV1, G1>);
+	G2::setMulVecGLVwork(mcl::ec::mulVecGLVworkT<local::GLV2, G2>, mcl::ec::getMulVecGLVworkSizeT<local::GLV2, G2>);
+	G1::setMulEachGLV(mcl::ec::mulEachGLVT<local::GLV1, G1>);
+	G2::setMulEachGLV(mcl::ec::mulEachGLVT<local::GLV2, G2>);
 	Fp12::setPowVecGLV(local::powVecGLV);
+	Fp12::setPowVecGLVwork(local::powVecGLVwork, local::getPowVecGLVworkSize);
 	G1::setCompressedExpression();
 	G2::setCompressedExpression();
 	verifyOrderG1(false);
@@ -2241,7 +3465,12 @@ inline void initG1only(bool *pb, const mcl::EcParam& para)
 {
 	G1::setMulVecGLV(0);
 	G2::setMulVecGLV(0);
+	G1::setMulVecGLVwork(0, 0);
+	G2::setMulVecGLVwork(0, 0);
+	G1::setMulEachGLV(0);
+	G2::setMulEachGLV(0);
 	Fp12::setPowVecGLV(0);
+	Fp12::setPowVecGLVwork(0, 0);
 	BN::nonConstParam.initG1only(pb, para);
 	if (!*pb) return;
 	G1::setCompressedExpression();
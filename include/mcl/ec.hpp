@@ -22,6 +22,7 @@
 namespace mcl {
 
 template<class _Fp> class Fp2T;
+template<class _Fp> class EcT;
 
 namespace local {
 
@@ -44,7 +45,8 @@ namespace ec {
 enum Mode {
 	Jacobi = 0,
 	Proj = 1,
-	Affine
+	Affine,
+	ProjComplete // Proj with the complete formulas of addCTProj/dblCTProj (a = 0 only)
 };
 
 enum ModeCoeffA {
@@ -53,6 +55,12 @@ enum ModeCoeffA {
 	GenericA
 };
 
+// algorithm of mulVec for large n
+enum MulVecMode {
+	MulVecJacobi = 0, // buckets in Jacobi/Proj coordinates
+	MulVecBatchAffine = 1 // signed-digit buckets in affine coordinates with batch inversion
+};
+
 namespace local {
 
 /*
@@ -81,7 +89,7 @@ bool get_a_flag(const mcl::Fp2T<F>& x)
 	w : window size
 */
 template<class GLV, class G>
-void mulGLV_CT(G& Q, const G& P, const void *yVec, fp::getMpzAtType getMpzAt)
+void mulGLV_CT(G& Q, const G& P, const void *yVec, fp::getUnitAtType getUnitAt)
 {
 	const size_t w = 4;
 	typedef typename GLV::Fr F;
@@ -89,16 +97,11 @@ void mulGLV_CT(G& Q, const G& P, const void *yVec, fp::getMpzAtType getMpzAt)
 	const size_t tblSize = 1 << w;
 	G tbl[splitN][tblSize];
 	bool negTbl[splitN];
-	mpz_class u[splitN], y;
-	getMpzAt(y, yVec, 0);
-	GLV::split(u, y);
+	Unit u[splitN][GLV::splitUnitN], y[maxUnitSize];
+	bint::clearN(y, maxUnitSize);
+	getUnitAt(y, yVec, 0);
+	GLV::splitUnit(negTbl, u, y, maxUnitSize);
 	for (int i = 0; i < splitN; i++) {
-		if (u[i] < 0) {
-			gmp::neg(u[i], u[i]);
-			negTbl[i] = true;
-		} else {
-			negTbl[i] = false;
-		}
 		tbl[i][0].clear();
 	}
 	tbl[0][1] = P;
@@ -123,7 +126,7 @@ void mulGLV_CT(G& Q, const G& P, const void *yVec, fp::getMpzAtType getMpzAt)
 		size_t maxBitSize = 0;
 		fp::BitIterator<Unit> itr[splitN];
 		for (int i = 0; i < splitN; i++) {
-			itr[i].init(gmp::getUnit(u[i]), gmp::getUnitSize(u[i]));
+			itr[i].init(u[i], GLV::splitUnitN);
 			size_t bitSize = itr[i].getBitSize();
 			if (bitSize > maxBitSize) maxBitSize = bitSize;
 		}
@@ -149,16 +152,6 @@ void mulGLV_CT(G& Q, const G& P, const void *yVec, fp::getMpzAtType getMpzAt)
 	}
 }
 
-// AsArrayOfFp[i] gets P[i].z
-template<class E>
-struct AsArrayOfFp {
-	typedef typename E::Fp Fp;
-	const E* P;
-	AsArrayOfFp(const E* P) : P(P) {}
-	const Fp& operator[](size_t i) const { return P[i].z; }
-	void operator+=(size_t n) { P += n; }
-};
-
 template<class E>
 void _normalizeJacobi(E& Q, const E& P, typename E::Fp& inv)
 {
@@ -188,6 +181,7 @@ void _normalize(E& Q, const E& P, typename E::Fp& inv)
 		_normalizeJacobi(Q, P, inv);
 		break;
 	case ec::Proj:
+	case ec::ProjComplete:
 		_normalizeProj(Q, P, inv);
 		break;
 	default:
@@ -196,26 +190,67 @@ void _normalize(E& Q, const E& P, typename E::Fp& inv)
 	}
 }
 
+// byte size of the prefix products of normalizeVecT to keep them in L1
+const size_t normalizeVecCacheSize = 16 * 1024;
+
+// the num of points whose z are inverted together in normalizeVecT (even)
+template<class F>
+size_t getNormalizeVecChunkN()
+{
+	size_t N = normalizeVecCacheSize / sizeof(F);
+	if (N < 64) N = 64;
+	if (N > 1024) N = 1024;
+	return N & ~size_t(1);
+}
+
 /*
 	Q[i] = normalie(P[i]) for i = 0, ..., n-1
-	AsArray : Pz[i] to access like as F[i] in invVecT
-	N : alloc size
+	P[i] may be zero or normalized
+	Eout, Ein : Q[i] and P[i] return the i-th point
+	N : num of points per inversion (0 : getNormalizeVecChunkN)
+	the prefix products (or the values) of z not in {0, 1} and their indices are kept in the 1st pass,
+	so the 2nd pass touches only the points to be normalized
 */
-template<class F, class Eout, class Ein, class AsArrayOfFp>
-void normalizeVecT(Eout& Q, Ein& P, size_t n, size_t N = 256)
+template<class F, class Eout, class Ein>
+void normalizeVecT(Eout& Q, Ein& P, size_t n, size_t N = 0)
 {
-	F *inv = (F*)CYBOZU_ALLOCA(sizeof(F) * N);
+	if (N == 0) N = getNormalizeVecChunkN<F>();
+	// z are inverted by F::invVec if it is faster than the prefix products
+	const bool useInvVec = F::isInvVecFast();
+	F *t = (F*)CYBOZU_ALLOCA(sizeof(F) * N);
+	uint32_t *idx = (uint32_t*)CYBOZU_ALLOCA(sizeof(uint32_t) * N);
 	bool PisEqualToQ = &P[0] == &Q[0];
 	for (;;) {
 		size_t doneN = (n < N) ? n : N;
-		AsArrayOfFp Pz(P);
-		invVecT<F>(inv, Pz, doneN, N);
+		size_t pos = 0;
 		for (size_t i = 0; i < doneN; i++) {
-			if (P[i].z.isZero() || P[i].z.isOne()) {
+			const F& z = P[i].z;
+			if (z.isZero() || z.isOne()) {
 				if (!PisEqualToQ) Q[i] = P[i];
+				continue;
+			}
+			if (pos == 0 || useInvVec) {
+				t[pos] = z;
 			} else {
-				local::_normalize(Q[i], P[i], inv[i]);
+				F::mul(t[pos], t[pos - 1], z);
 			}
+			idx[pos++] = uint32_t(i);
+		}
+		if (useInvVec) {
+			if (pos > 0) F::invVec(t, t, pos);
+			for (size_t j = 0; j < pos; j++) {
+				local::_normalize(Q[idx[j]], P[idx[j]], t[j]);
+			}
+		} else if (pos > 0) {
+			F inv, r;
+			F::inv(inv, t[pos - 1]);
+			while (--pos > 0) {
+				const size_t i = idx[pos];
+				F::mul(r, inv, t[pos - 1]);
+				inv *= P[i].z;
+				local::_normalize(Q[i], P[i], r);
+			}
+			local::_normalize(Q[idx[0]], P[idx[0]], inv);
 		}
 		n -= doneN;
 		if (n == 0) return;
@@ -237,13 +272,12 @@ void normalizeJacobi(E& P)
 
 /*
 	Q[i] = normalie(P[i]) for i = 0, ..., n-1
-	AsArray : Pz[i] to access like as F[i] in invVecT
-	N : alloc size
+	Q may be equal to P
 */
 template<class E>
 void normalizeVec(E *Q, const E *P, size_t n)
 {
-	local::normalizeVecT<typename E::Fp, E*, const E*, local::AsArrayOfFp<E> >(Q, P, n);
+	local::normalizeVecT<typename E::Fp, E*, const E*>(Q, P, n);
 }
 
 // (x/z^2, y/z^3)
@@ -501,6 +535,40 @@ void addCTProj(E& R, const E& P, const E& Q)
 	F::add(R.z, z3, t0);
 }
 
+/*
+	accept R == P
+	Algorithm 9 of https://eprint.iacr.org/2015/1060 (a = 0)
+	(x, y, z) is zero <=> x = 0, y = 1, z = 0
+*/
+template<class E>
+void dblCTProj(E& R, const E& P)
+{
+	typedef typename E::Fp F;
+	assert(E::a_ == 0);
+	F b3;
+	F::add(b3, E::b_, E::b_);
+	b3 += E::b_;
+	F t0, t1, t2, t3, x3, y3, z3;
+	F::mul(t3, P.x, P.y);
+	F::sqr(t0, P.y);
+	F::add(z3, t0, t0);
+	F::add(z3, z3, z3);
+	F::add(z3, z3, z3);
+	F::mul(t1, P.y, P.z);
+	F::sqr(t2, P.z);
+	t2 *= b3;
+	F::mul(x3, t2, z3);
+	F::add(y3, t0, t2);
+	F::mul(R.z, t1, z3);
+	F::add(t1, t2, t2);
+	t2 += t1;
+	t0 -= t2;
+	y3 *= t0;
+	F::add(R.y, x3, y3);
+	F::mul(t1, t0, t3);
+	F::add(R.x, t1, t1);
+}
+
 template<class E>
 void normalizeProj(E& P)
 {
@@ -772,7 +840,8 @@ void tryAndIncMapTo(E& P, const typename E::Fp& t)
 	for (;;) {
 		F y;
 		E::getWeierstrass(y, x);
-		if (F::squareRoot(y, y)) {
+		// the Legendre symbol is cheaper than squareRoot of a non-square
+		if (F::isSquare(y) && F::squareRoot(y, y)) {
 			bool b;
 			P.set(&b, x, y, false);
 			assert(b);
@@ -802,49 +871,30 @@ inline size_t argminForMulVec(size_t n)
 	// you can decrease this value but this algorithm is slow if n < 256
 	#define MCL_MAX_N_TO_USE_STACK_FOR_MUL_VEC 1024
 #endif
+// byte size of the workspace used by mulVecCoreWork for n points
+template<class G>
+size_t getMulVecCoreWorkSize(size_t yUnitSize, size_t n)
+{
+	const size_t c = argminForMulVec(n);
+	const size_t maxBitSize = sizeof(Unit) * yUnitSize * 8;
+	const size_t winN = maxBitSize / c + 1;
+	return sizeof(G) * (((size_t(1) << c) - 1) + winN);
+}
 /*
 	z = sum_{i=0}^{n-1} xVec[i] * yVec[i]
 	yVec[i] means yVec[i*next:(i+1)*next+yUnitSize]
-	return numbers of done, which may be smaller than n if malloc fails
+	work must have getMulVecCoreWorkSize<G>(yUnitSize, n) bytes
 	@note xVec may be normlized
-	fast for n >= 256
 */
 template<class G>
-size_t mulVecCore(G& z, G *xVec, const Unit *yVec, size_t yUnitSize, size_t next, size_t n, bool doNormalize = true)
+void mulVecCoreWork(G& z, G *xVec, const Unit *yVec, size_t yUnitSize, size_t next, size_t n, bool doNormalize, void *work)
 {
-	if (n == 0) {
-		z.clear();
-		return 0;
-	}
-	if (n == 1) {
-		G::mulArray(z, xVec[0], yVec, yUnitSize);
-		return 1;
-	}
-
-	size_t c, tblN;
-	G *tbl_ = 0; // malloc is used if tbl_ != 0
-	G *tbl = 0;
-
-	// if n is large then try to use malloc
-	if (n > MCL_MAX_N_TO_USE_STACK_FOR_MUL_VEC) {
-		c = argminForMulVec(n);
-		tblN = (1 << c) - 1;
-		tbl_ = (G*)malloc(sizeof(G) * tblN);
-		if (tbl_) {
-			tbl = tbl_;
-			goto main;
-		}
-	}
-	// n is small or malloc fails so use stack
-	if (n > MCL_MAX_N_TO_USE_STACK_FOR_MUL_VEC) n = MCL_MAX_N_TO_USE_STACK_FOR_MUL_VEC;
-	c = argminForMulVec(n);
-	tblN = (1 << c) - 1;
-	tbl = (G*)CYBOZU_ALLOCA(sizeof(G) * tblN);
-	// keep tbl_ = 0
-main:
+	const size_t c = argminForMulVec(n);
+	const size_t tblN = (size_t(1) << c) - 1;
 	const size_t maxBitSize = sizeof(Unit) * yUnitSize * 8;
 	const size_t winN = maxBitSize / c + 1;
-	G *win = (G*)CYBOZU_ALLOCA(sizeof(G) * winN);
+	G *tbl = (G*)work;
+	G *win = tbl + tblN;
 
 	// about 10% faster
 	if (doNormalize) G::normalizeVec(xVec, xVec, n);
@@ -874,7 +924,41 @@ main:
 		}
 		z += win[winN - 1 - w];
 	}
-	if (tbl_) free(tbl_);
+}
+/*
+	z = sum_{i=0}^{n-1} xVec[i] * yVec[i]
+	yVec[i] means yVec[i*next:(i+1)*next+yUnitSize]
+	return numbers of done, which may be smaller than n if malloc fails
+	@note xVec may be normlized
+	fast for n >= 256
+*/
+template<class G>
+size_t mulVecCore(G& z, G *xVec, const Unit *yVec, size_t yUnitSize, size_t next, size_t n, bool doNormalize = true)
+{
+	if (n == 0) {
+		z.clear();
+		return 0;
+	}
+	if (n == 1) {
+		G::mulArray(z, xVec[0], yVec, yUnitSize);
+		return 1;
+	}
+
+	void *work_ = 0; // malloc is used if work_ != 0
+	void *work = 0;
+
+	// if n is large then try to use malloc
+	if (n > MCL_MAX_N_TO_USE_STACK_FOR_MUL_VEC) {
+		work_ = malloc(getMulVecCoreWorkSize<G>(yUnitSize, n));
+		work = work_;
+	}
+	if (work == 0) {
+		// n is small or malloc fails so use stack
+		if (n > MCL_MAX_N_TO_USE_STACK_FOR_MUL_VEC) n = MCL_MAX_N_TO_USE_STACK_FOR_MUL_VEC;
+		work = CYBOZU_ALLOCA(getMulVecCoreWorkSize<G>(yUnitSize, n));
+	}
+	mulVecCoreWork(z, xVec, yVec, yUnitSize, next, n, doNormalize, work);
+	if (work_) free(work_);
 	return n;
 }
 template<class G>
@@ -892,20 +976,390 @@ void mulVecLong(G& z, G *xVec, const Unit *yVec, size_t yUnitSize, size_t next,
 	} while (done < n);
 }
 
-// for n >= 128
+// return max bit size of yVec[i*next:(i+1)*next+yUnitSize] for i = 0, ..., n-1
+inline size_t getMaxBitSize(const Unit *yVec, size_t yUnitSize, size_t next, size_t n)
+{
+	size_t maxBit = 0;
+	for (size_t i = 0; i < n; i++) {
+		const Unit *y = yVec + next * i;
+		for (size_t j = yUnitSize; j > 0; j--) {
+			if (y[j - 1]) {
+				maxBit = fp::max_(maxBit, (j - 1) * UnitBitSize + cybozu::bsr(y[j - 1]) + 1);
+				break;
+			}
+		}
+	}
+	return maxBit;
+}
+
+/*
+	add P (or -P if isNeg) to the affine bucket B
+	return false if the addition needs a batch inversion, then den = P.x - B.x
+*/
+template<class G>
+bool addAffineToBucket(G& B, const G& P, bool isNeg, typename G::Fp& den)
+{
+	typedef typename G::Fp F;
+	if (B.isZero()) {
+		B = P;
+		if (isNeg) F::neg(B.y, B.y);
+		return true;
+	}
+	F::sub(den, P.x, B.x);
+	if (!den.isZero()) return false;
+	// B = P or B = -P
+	if ((B.y == P.y) != isNeg) {
+		dblAffine(B, B);
+	} else {
+		B.clear();
+	}
+	return true;
+}
+
+/*
+	bucket[batchBucket[k]] += sign(digit[i]) xVec[i] for i = batchPoint[k], k = 0, ..., batchN - 1
+	den[k] = xVec[i].x - bucket[batchBucket[k]].x != 0
+	inv and tmp are F[batchN] and den is broken
+	the multiplications of the batch are independent, so they are done by F::mulEach
+*/
+template<class G, class F>
+void addAffineBatch(G *bucket, const G *xVec, const int *digit, const size_t *batchBucket, const size_t *batchPoint, size_t batchN, F *den, F *inv, F *tmp, uint8_t *pending)
+{
+	if (batchN == 0) return;
+	mcl::local::invVecWork(inv, den, batchN, tmp);
+	for (size_t k = 0; k < batchN; k++) {
+		const G& B = bucket[batchBucket[k]];
+		const G& P = xVec[batchPoint[k]];
+		if (digit[batchPoint[k]] < 0) {
+			F::add(tmp[k], P.y, B.y);
+			F::neg(tmp[k], tmp[k]);
+		} else {
+			F::sub(tmp[k], P.y, B.y);
+		}
+	}
+	// tmp = lambda
+	F::mulEach(tmp, tmp, inv, batchN);
+	F::sqrEach(inv, tmp, batchN);
+	for (size_t k = 0; k < batchN; k++) {
+		G& B = bucket[batchBucket[k]];
+		const G& P = xVec[batchPoint[k]];
+		F x3;
+		F::sub(x3, inv[k], B.x);
+		x3 -= P.x;
+		F::sub(den[k], B.x, x3);
+		B.x = x3;
+	}
+	F::mulEach(den, den, tmp, batchN);
+	for (size_t k = 0; k < batchN; k++) {
+		G& B = bucket[batchBucket[k]];
+		F::sub(B.y, den[k], B.y);
+		pending[batchBucket[k]] = 0;
+	}
+}
+
+/*
+	z = sum_{i=0}^{n-1} xVec[i] * yVec[i]
+	yVec[i] means yVec[i*next:(i+1)*next+yUnitSize]
+	the bucket method with signed digits which uses 2^(c-1) buckets for each c-bit window
+	buckets are kept in affine coordinates and the additions to different buckets
+	share one inversion (batch affine)
+	a point whose bucket is in the current batch is deferred to the next round
+	and the points left after maxRoundN rounds are added in Jacobi coordinates
+	xVec[i] must be normalized
+	return false if malloc fails
+	fast for large n
+*/
+template<class G>
+bool mulVecBatchAffine(G& z, const G *xVec, const Unit *yVec, size_t yUnitSize, size_t next, size_t n)
+{
+	typedef typename G::Fp F;
+	const size_t maxBit = getMaxBitSize(yVec, yUnitSize, next, n);
+	if (maxBit == 0) {
+		z.clear();
+		return true;
+	}
+	const size_t c = fp::min_<size_t>(argminForMulVec(n) + 1, 16);
+	const size_t winN = maxBit / c + 1;
+	const size_t bucketN = size_t(1) << (c - 1);
+	const size_t batchN = fp::min_<size_t>(bucketN, 512);
+	const size_t maxRoundN = 4;
+	const Unit mask = (Unit(1) << c) - 1;
+
+	const size_t GByteSize = sizeof(G) * (bucketN + winN);
+	const size_t FByteSize = sizeof(F) * batchN * 3;
+	const size_t idxByteSize = sizeof(size_t) * (n + batchN * 2);
+	const size_t digitByteSize = sizeof(int) * n;
+	char *buf = (char*)malloc(GByteSize + FByteSize + idxByteSize + digitByteSize + n + bucketN);
+	if (buf == 0) return false;
+	G *bucket = (G*)buf;
+	G *win = bucket + bucketN;
+	F *den = (F*)(buf + GByteSize);
+	F *inv = den + batchN;
+	F *tmp = inv + batchN;
+	size_t *deferred = (size_t*)(buf + GByteSize + FByteSize);
+	size_t *batchBucket = deferred + n;
+	size_t *batchPoint = batchBucket + batchN;
+	int *digit = (int*)(buf + GByteSize + FByteSize + idxByteSize);
+	uint8_t *carry = (uint8_t*)(buf + GByteSize + FByteSize + idxByteSize + digitByteSize);
+	// pending[b] is true if bucket[b] is in the current batch
+	uint8_t *pending = carry + n;
+	memset(carry, 0, n);
+
+	for (size_t w = 0; w < winN; w++) {
+		for (size_t i = 0; i < n; i++) {
+			int v = int(fp::getUnitAt(yVec + next * i, yUnitSize, c * w) & mask) + carry[i];
+			if (v > int(bucketN)) {
+				v -= int(mask) + 1;
+				carry[i] = 1;
+			} else {
+				carry[i] = 0;
+			}
+			digit[i] = xVec[i].isZero() ? 0 : v;
+		}
+		for (size_t i = 0; i < bucketN; i++) {
+			bucket[i].clear();
+		}
+		memset(pending, 0, bucketN);
+		size_t batchSize = 0;
+		size_t deferredN = 0;
+		bool first = true;
+		for (size_t round = 0; ; round++) {
+			const size_t roundN = first ? n : deferredN;
+			size_t nextDeferredN = 0;
+			for (size_t j = 0; j < roundN; j++) {
+				const size_t i = first ? j : deferred[j];
+				const int v = digit[i];
+				if (v == 0) continue;
+				const size_t b = size_t(v > 0 ? v : -v) - 1;
+				if (pending[b]) {
+					// nextDeferredN <= j so deferred[j] is already read
+					deferred[nextDeferredN++] = i;
+					continue;
+				}
+				if (addAffineToBucket(bucket[b], xVec[i], v < 0, den[batchSize])) continue;
+				pending[b] = 1;
+				batchBucket[batchSize] = b;
+				batchPoint[batchSize] = i;
+				batchSize++;
+				if (batchSize == batchN) {
+					addAffineBatch(bucket, xVec, digit, batchBucket, batchPoint, batchSize, den, inv, tmp, pending);
+					batchSize = 0;
+				}
+			}
+			addAffineBatch(bucket, xVec, digit, batchBucket, batchPoint, batchSize, den, inv, tmp, pending);
+			batchSize = 0;
+			first = false;
+			deferredN = nextDeferredN;
+			if (deferredN == 0) break;
+			/*
+				many digits of the same bucket (e.g. equal scalars) need a round for each point
+				so add the rest in Jacobi coordinates after maxRoundN rounds
+			*/
+			if (round + 1 == maxRoundN) {
+				for (size_t j = 0; j < deferredN; j++) {
+					const size_t i = deferred[j];
+					const int v = digit[i];
+					G& B = bucket[size_t(v > 0 ? v : -v) - 1];
+					if (v > 0) {
+						B += xVec[i];
+					} else {
+						B -= xVec[i];
+					}
+				}
+				break;
+			}
+		}
+		G sum;
+		sum.clear();
+		win[w].clear();
+		for (size_t i = 0; i < bucketN; i++) {
+			sum += bucket[bucketN - 1 - i];
+			win[w] += sum;
+		}
+	}
+	z.clear();
+	for (size_t w = 0; w < winN; w++) {
+		for (size_t i = 0; i < c; i++) {
+			G::dbl(z, z);
+		}
+		z += win[winN - 1 - w];
+	}
+	free(buf);
+	return true;
+}
+
+/*
+	split z = sum_{i=0}^{n-1} xVec[i] * yVec[i] into tasks for cpuN threads
+	c : window size
+	winN : num of c-bit windows
+	partN : num of ranges of buckets in a window
+	return the estimated num of additions per thread
+*/
+inline size_t getMulVecMTPartition(size_t& c, size_t& winN, size_t& partN, size_t n, size_t maxBit, size_t cpuN)
+{
+	const size_t c0 = fp::min_<size_t>(argminForMulVec(n), 16);
+	size_t minCost = ~size_t(0);
+	c = winN = partN = 0;
+	for (size_t tc = c0 > 5 ? c0 - 3 : 2; tc <= c0; tc++) {
+		const size_t tWinN = (maxBit + tc - 1) / tc;
+		const size_t tblN = (size_t(1) << tc) - 1;
+		for (size_t tPartN = 1; tPartN <= cpuN && tPartN <= tblN; tPartN++) {
+			// a task adds about n / partN points and 2 tblN / partN buckets and reads n digits
+			const size_t roundN = (tWinN * tPartN + cpuN - 1) / cpuN;
+			const size_t cost = roundN * ((n + 2 * tblN) / tPartN + n / 32);
+			if (cost < minCost) {
+				minCost = cost;
+				c = tc;
+				winN = tWinN;
+				partN = tPartN;
+			}
+		}
+	}
+	return minCost;
+}
+
+/*
+	z = sum_{i=0}^{n-1} xVec[i] * yVec[i] by cpuN threads
+	yVec[i] means yVec[i*next:(i+1)*next+yUnitSize]
+	the digits of yVec are computed once and shared by all threads
+	each task computes the buckets of a window (window parallel)
+	or a range of buckets of a window (bucket parallel) if winN < cpuN
+	a range [lo, hi) of buckets returns sum_{v=lo+1}^{hi} v tbl[v-1]
+	= sum_{k=0}^{hi-lo-1} (k+1) tbl[lo+k] + lo sum_{k} tbl[lo+k]
+	xVec[i] should be normalized
+	return false if malloc fails
+*/
+template<class G>
+bool mulVecWindowMT(G& z, const G *xVec, const Unit *yVec, size_t yUnitSize, size_t next, size_t n, size_t cpuN)
+{
+	const size_t maxBit = getMaxBitSize(yVec, yUnitSize, next, n);
+	if (maxBit == 0) {
+		z.clear();
+		return true;
+	}
+	if (cpuN == 0) cpuN = 1;
+	size_t c, winN, partN;
+	getMulVecMTPartition(c, winN, partN, n, maxBit, cpuN);
+	const size_t tblN = (size_t(1) << c) - 1;
+	const size_t partSize = (tblN + partN - 1) / partN;
+	const size_t taskN = winN * partN;
+	const size_t resultByteSize = sizeof(G) * taskN;
+	uint8_t *buf = (uint8_t*)malloc(resultByteSize + sizeof(uint16_t) * winN * n + taskN);
+	if (buf == 0) return false;
+	G *result = (G*)buf;
+	uint16_t *digit = (uint16_t*)(buf + resultByteSize);
+	const Unit mask = Unit(tblN);
+#ifdef MCL_USE_OMP
+	#pragma omp parallel for num_threads(int(cpuN))
+#endif
+	for (int i = 0; i < int(n); i++) {
+		const Unit *y = yVec + next * i;
+		for (size_t w = 0; w < winN; w++) {
+			digit[w * n + i] = xVec[i].isZero() ? 0 : uint16_t(fp::getUnitAt(y, yUnitSize, c * w) & mask);
+		}
+	}
+	// failed[t] = 1 if malloc fails in the t-th task
+	uint8_t *failed = (uint8_t*)(digit + winN * n);
+#ifdef MCL_USE_OMP
+	#pragma omp parallel for schedule(dynamic) num_threads(int(cpuN))
+#endif
+	for (int t = 0; t < int(taskN); t++) {
+		const size_t w = size_t(t) / partN;
+		const size_t lo = size_t(t) % partN * partSize;
+		const size_t hi = fp::min_(lo + partSize, tblN);
+		G& r = result[t];
+		r.clear();
+		failed[t] = 0;
+		if (lo >= hi) continue;
+		G *tbl = (G*)malloc(sizeof(G) * (hi - lo));
+		if (tbl == 0) {
+			failed[t] = 1;
+			continue;
+		}
+		for (size_t k = 0; k < hi - lo; k++) {
+			tbl[k].clear();
+		}
+		const uint16_t *d = digit + w * n;
+		for (size_t i = 0; i < n; i++) {
+			const size_t v = d[i];
+			if (lo < v && v <= hi) {
+				tbl[v - 1 - lo] += xVec[i];
+			}
+		}
+		G sum;
+		sum.clear();
+		for (size_t k = 0; k < hi - lo; k++) {
+			sum += tbl[hi - lo - 1 - k];
+			r += sum;
+		}
+		free(tbl);
+		if (lo > 0) {
+			G::mul(sum, sum, int64_t(lo));
+			r += sum;
+		}
+	}
+	bool ok = true;
+	for (size_t t = 0; t < taskN; t++) {
+		if (failed[t]) ok = false;
+	}
+	if (ok) {
+		z.clear();
+		for (size_t k = 0; k < winN; k++) {
+			const size_t w = winN - 1 - k;
+			for (size_t i = 0; i < c; i++) {
+				G::dbl(z, z);
+			}
+			for (size_t p = 0; p < partN; p++) {
+				z += result[w * partN + p];
+			}
+		}
+	}
+	free(buf);
+	return ok;
+}
+
+// call mulVecBatchAffine if G is EcT and MulVecBatchAffine is selected
+template<class G>
+bool mulVecBatchAffineIfSelected(G&, const G *, const Unit *, size_t, size_t, size_t)
+{
+	return false;
+}
+template<class Fp>
+bool mulVecBatchAffineIfSelected(EcT<Fp>& z, const EcT<Fp> *xVec, const Unit *yVec, size_t yUnitSize, size_t next, size_t n)
+{
+	if (EcT<Fp>::mulVecMode_ != MulVecBatchAffine) return false;
+	return mulVecBatchAffine(z, xVec, yVec, yUnitSize, next, n);
+}
+
+// byte size of the workspace used by mulVecGLVlarge
 template<class GLV, class G>
-bool mulVecGLVlarge(G& z, const G *xVec, const void *yVec, size_t n, fp::getMpzAtType getMpzAt)
+size_t getMulVecGLVlargeWorkSize(size_t n)
+{
+	const size_t m = GLV::splitN * n;
+	const size_t next = GLV::Fr::getUnitSize();
+	return (sizeof(G) + sizeof(Unit) * next) * m + getMulVecCoreWorkSize<G>(next, m);
+}
+/*
+	for n >= 128
+	use work of getMulVecGLVlargeWorkSize<GLV, G>(n) bytes instead of malloc if work != 0
+	(MulVecBatchAffine mode is not used then)
+	return false if malloc fails
+*/
+template<class GLV, class G>
+bool mulVecGLVlarge(G& z, const G *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt, void *work = 0)
 {
 	const int splitN = GLV::splitN;
 	assert(n > 0);
 	typedef typename GLV::Fr F;
 	typedef mcl::Unit Unit;
 	const size_t next = F::getUnitSize();
-	mpz_class u[splitN], y;
+	Unit u[splitN][GLV::splitUnitN], y[maxUnitSize];
+	bool isNeg[splitN];
+	bint::clearN(y, maxUnitSize);
 
 	const size_t tblByteSize = sizeof(G) * splitN * n;
 	const size_t ypByteSize = sizeof(Unit) * next * splitN * n;
-	G *tbl = (G*)malloc(tblByteSize + ypByteSize);
+	G *tbl = (G*)(work ? work : malloc(tblByteSize + ypByteSize));
 	if (tbl == 0) return false;
 
 	Unit *yp = (Unit *)(tbl + splitN * n);
@@ -917,20 +1371,23 @@ bool mulVecGLVlarge(G& z, const G *xVec, const void *yVec, size_t n, fp::getMpzA
 		}
 	}
 	for (size_t i = 0; i < n; i++) {
-		getMpzAt(y, yVec, i);
-		GLV::split(u, y);
+		getUnitAt(y, yVec, i);
+		GLV::splitUnit(isNeg, u, y, maxUnitSize);
 		for (size_t j = 0; j < splitN; j++) {
 			size_t idx = j * n + i;
-			if (u[j] < 0) {
-				u[j] = -u[j];
+			if (isNeg[j]) {
 				G::neg(tbl[idx], tbl[idx]);
 			}
-			bool b;
-			mcl::gmp::getArray(&b, &yp[idx * next], next, u[j]);
-			assert(b); (void)b;
+			bint::copyN(&yp[idx * next], u[j], next);
 		}
 	}
-	mulVecLong(z, tbl, yp, next, next, n * splitN, false);
+	if (work) {
+		mulVecCoreWork(z, tbl, yp, next, next, n * splitN, false, (char*)work + tblByteSize + ypByteSize);
+		return true;
+	}
+	if (!mulVecBatchAffineIfSelected(z, tbl, yp, next, next, n * splitN)) {
+		mulVecLong(z, tbl, yp, next, next, n * splitN, false);
+	}
 	free(tbl);
 	return true;
 }
@@ -1058,38 +1515,52 @@ bool mulSmallInt(G& z, const G& x, Unit y, bool isNegative)
 	return true;
 }
 
+// byte size of the workspace used by mulVecGLVsmall
+template<class GLV, class G, int w>
+size_t getMulVecGLVsmallWorkSize(size_t n)
+{
+	const int splitN = GLV::splitN;
+	const size_t tblSize = 1 << (w - 2);
+	typedef mcl::FixedArray<int8_t, sizeof(typename GLV::Fr) * 8 / splitN + splitN> NafArray;
+	return (sizeof(G) * tblSize + sizeof(NafArray)) * splitN * n;
+}
 /*
 	z += xVec[i] * yVec[i] for i = 0, ..., min(N, n)
 	splitN = 2(G1) or 4(G2)
 	w : window size
 	for n <= 16
+	use work of getMulVecGLVsmallWorkSize<GLV, G, w>(n) bytes instead of stack if work != 0
 */
 template<class GLV, class G, int w>
-static void mulVecGLVsmall(G& z, const G *xVec, const void* yVec, size_t n, fp::getMpzAtType getMpzAt)
+static void mulVecGLVsmall(G& z, const G *xVec, const void* yVec, size_t n, fp::getUnitAtType getUnitAt, void *work = 0)
 {
 	assert(n <= mcl::fp::maxMulVecNGLV);
 	const int splitN = GLV::splitN;
 	const size_t tblSize = 1 << (w - 2);
 	typedef mcl::FixedArray<int8_t, sizeof(typename GLV::Fr) * 8 / splitN + splitN> NafArray;
-	NafArray (*naf)[splitN] = (NafArray (*)[splitN])CYBOZU_ALLOCA(sizeof(NafArray) * n * splitN);
+	if (work == 0) {
+		const size_t workSize = getMulVecGLVsmallWorkSize<GLV, G, w>(n);
+		work = CYBOZU_ALLOCA(workSize);
+	}
 	// layout tbl[splitN][n][tblSize];
-	G (*tbl)[tblSize] = (G (*)[tblSize])CYBOZU_ALLOCA(sizeof(G) * splitN * n * tblSize);
-	mpz_class u[splitN], y;
+	G (*tbl)[tblSize] = (G (*)[tblSize])work;
+	NafArray (*naf)[splitN] = (NafArray (*)[splitN])(&tbl[0][0] + splitN * n * tblSize);
+	Unit u[splitN][GLV::splitUnitN], y[maxUnitSize];
+	bool isNeg[splitN];
+	bint::clearN(y, maxUnitSize);
 	size_t maxBit = 0;
 
 	for (size_t i = 0; i < n; i++) {
-		getMpzAt(y, yVec, i);
+		getUnitAt(y, yVec, i);
 		if (n == 1) {
-			const Unit *y0 = mcl::gmp::getUnit(y);
-			size_t yn = mcl::gmp::getUnitSize(y);
-			yn = bint::getRealSize(y0, yn);
-			if (yn <= 1 && mulSmallInt(z, xVec[0], *y0, false)) return;
+			const size_t yn = bint::getRealSize(y, maxUnitSize);
+			if (yn <= 1 && mulSmallInt(z, xVec[0], yn ? y[0] : 0, false)) return;
 		}
-		GLV::split(u, y);
+		GLV::splitUnit(isNeg, u, y, maxUnitSize);
 
 		for (int j = 0; j < splitN; j++) {
 			bool b;
-			gmp::getNAFwidth(&b, naf[i][j], u[j], w);
+			fp::getNAFwidth(&b, naf[i][j], u[j], GLV::splitUnitN, isNeg[j], w);
 			assert(b); (void)b;
 			if (naf[i][j].size() > maxBit) maxBit = naf[i][j].size();
 		}
@@ -1126,22 +1597,122 @@ static void mulVecGLVsmall(G& z, const G *xVec, const void* yVec, size_t n, fp::
 
 // return false if malloc fails or n is not in a target range
 template<class GLV, class G, class F>
-bool mulVecGLVT(G& z, const G *xVec, const void *yVec, size_t n, fp::getMpzAtType getMpzAt, fp::getUnitAtType /*getUnitAt*/, bool constTime = false)
+bool mulVecGLVT(G& z, const G *xVec, const void *yVec, size_t n, fp::getMpzAtType /*getMpzAt*/, fp::getUnitAtType getUnitAt, bool constTime = false)
 {
 	if (n == 1 && constTime) {
-		local::mulGLV_CT<GLV, G>(z, xVec[0], yVec, getMpzAt);
+		local::mulGLV_CT<GLV, G>(z, xVec[0], yVec, getUnitAt);
 		return true;
 	}
 	if (n <= mcl::fp::maxMulVecNGLV) {
-		mulVecGLVsmall<GLV, G, 5>(z, xVec, yVec, n, getMpzAt);
+		mulVecGLVsmall<GLV, G, 5>(z, xVec, yVec, n, getUnitAt);
 		return true;
 	}
 	if (n >= 128) {
-		return mulVecGLVlarge<GLV, G>(z, xVec, yVec, n, getMpzAt);
+		return mulVecGLVlarge<GLV, G>(z, xVec, yVec, n, getUnitAt);
 	}
 	return false;
 }
 
+/*
+	byte size of the workspace for mulVecGLVworkT
+	return 0 if n == 0 or maxMulVecNGLV < n < 128
+	because mulVec for such n uses only the stack (mulVecN) and needs no workspace
+	the workspace is used as arrays of G and Unit, so it must be aligned to sizeof(Unit)
+	(memory returned by malloc is enough)
+*/
+template<class GLV, class G>
+size_t getMulVecGLVworkSizeT(size_t n)
+{
+	if (n == 0) return 0;
+	if (n <= mcl::fp::maxMulVecNGLV) return getMulVecGLVsmallWorkSize<GLV, G, 5>(n);
+	if (n >= 128) return getMulVecGLVlargeWorkSize<GLV, G>(n);
+	return 0;
+}
+/*
+	same as mulVecGLVT but use work instead of malloc and alloca
+	return false if workSize < getMulVecGLVworkSizeT<GLV, G>(n), work is not aligned to sizeof(Unit)
+	or n is not in a target range
+*/
+template<class GLV, class G>
+bool mulVecGLVworkT(G& z, const G *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt, void *work, size_t workSize)
+{
+	const size_t requiredSize = getMulVecGLVworkSizeT<GLV, G>(n);
+	if (requiredSize == 0 || work == 0 || workSize < requiredSize) return false;
+	if (size_t(work) % sizeof(Unit) != 0) return false;
+	if (n <= mcl::fp::maxMulVecNGLV) {
+		mulVecGLVsmall<GLV, G, 5>(z, xVec, yVec, n, getUnitAt, work);
+		return true;
+	}
+	return mulVecGLVlarge<GLV, G>(z, xVec, yVec, n, getUnitAt, work);
+}
+
+/*
+	zVec[i] = xVec[i] * yVec[i] for i = 0, ..., n-1
+	the GLV ladders of maxMulEachN points run in lock-step and
+	their tables and results are normalized by one inversion
+	zVec may be equal to xVec
+*/
+template<class GLV, class G>
+void mulEachGLVT(G *zVec, const G *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt)
+{
+	const int w = 5;
+	const int splitN = GLV::splitN;
+	const size_t tblSize = 1 << (w - 2);
+	const size_t maxN = mcl::fp::maxMulEachN;
+	typedef mcl::FixedArray<int8_t, sizeof(typename GLV::Fr) * 8 / splitN + splitN> NafArray;
+	const size_t workSize = getMulVecGLVsmallWorkSize<GLV, G, w>(maxN);
+	void *work = CYBOZU_ALLOCA(workSize);
+	Unit u[splitN][GLV::splitUnitN], y[maxUnitSize];
+	bool isNeg[splitN];
+	bint::clearN(y, maxUnitSize);
+	for (size_t pos = 0; pos < n; pos += maxN) {
+		const size_t m = fp::min_(n - pos, maxN);
+		G *z = zVec + pos;
+		const G *x = xVec + pos;
+		// layout tbl[splitN][m][tblSize];
+		G (*tbl)[tblSize] = (G (*)[tblSize])work;
+		NafArray (*naf)[splitN] = (NafArray (*)[splitN])(&tbl[0][0] + splitN * m * tblSize);
+		size_t maxBit = 0;
+		for (size_t i = 0; i < m; i++) {
+			getUnitAt(y, yVec, pos + i);
+			GLV::splitUnit(isNeg, u, y, maxUnitSize);
+			for (int j = 0; j < splitN; j++) {
+				bool b;
+				fp::getNAFwidth(&b, naf[i][j], u[j], GLV::splitUnitN, isNeg[j], w);
+				assert(b); (void)b;
+				if (naf[i][j].size() > maxBit) maxBit = naf[i][j].size();
+			}
+			G P2;
+			G::dbl(P2, x[i]);
+			tbl[i][0] = x[i];
+			for (size_t j = 1; j < tblSize; j++) {
+				G::add(tbl[i][j], tbl[i][j - 1], P2);
+			}
+		}
+		G::normalizeVec(&tbl[0][0], &tbl[0][0], m * tblSize);
+		for (int k = 1; k < splitN; k++) {
+			for (size_t i = 0; i < m; i++) {
+				for (size_t j = 0; j < tblSize; j++) {
+					GLV::mulLambda(tbl[k * m + i][j], tbl[(k - 1) * m + i][j]);
+				}
+			}
+		}
+		for (size_t i = 0; i < m; i++) {
+			z[i].clear();
+		}
+		for (size_t i = 0; i < maxBit; i++) {
+			const size_t bit = maxBit - 1 - i;
+			for (size_t j = 0; j < m; j++) {
+				G::dbl(z[j], z[j]);
+				for (int k = 0; k < splitN; k++) {
+					mcl::local::addTbl(z[j], tbl[k * m + j], naf[j][k], bit);
+				}
+			}
+		}
+		G::normalizeVec(z, z, m);
+	}
+}
+
 } // mcl::ec
 
 /*
@@ -1160,6 +1731,7 @@ public:
 	static Fp b_;
 	static int specialA_;
 	static int ioMode_;
+	static int mulVecMode_;
 	/*
 		order_ is the order of G2 which is the subgroup of EcT<Fp2>.
 		check the order of the elements if verifyOrder_ is true
@@ -1167,7 +1739,11 @@ public:
 	static bool verifyOrder_;
 	static mpz_class order_;
 	static bool (*mulVecGLV)(EcT& z, const EcT *xVec, const void *yVec, size_t n, fp::getMpzAtType getMpzAt, fp::getUnitAtType getUnitAt, bool constTime);
+	static bool (*mulVecGLVwork)(EcT& z, const EcT *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt, void *work, size_t workSize);
+	static size_t (*getMulVecGLVworkSize)(size_t n);
+	static void (*mulEachGLV)(EcT *zVec, const EcT *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt);
 	static bool (*isValidOrderFast)(const EcT& x);
+	static fp::EcLanes lanes_;
 	/* default constructor is undefined value */
 	EcT() {}
 	EcT(const Fp& _x, const Fp& _y)
@@ -1191,6 +1767,7 @@ public:
 			ec::normalizeJacobi(*this);
 			break;
 		case ec::Proj:
+		case ec::ProjComplete:
 			ec::normalizeProj(*this);
 			break;
 		}
@@ -1215,6 +1792,8 @@ public:
 	{
 		a_ = a;
 		b_ = b;
+		// the complete formulas of ProjComplete require a = 0
+		if (mode == ec::ProjComplete && !a_.isZero()) mode = ec::Proj;
 		if (a_.isZero()) {
 			specialA_ = ec::Zero;
 		} else if (a_ == -3) {
@@ -1226,10 +1805,26 @@ public:
 		verifyOrder_ = false;
 		order_ = 0;
 		mulVecGLV = 0;
+		mulVecGLVwork = 0;
+		getMulVecGLVworkSize = 0;
+		mulEachGLV = 0;
 		isValidOrderFast = 0;
 		mode_ = mode;
+		mulVecMode_ = ec::MulVecJacobi;
+		lanes_.n = 0;
+		if (specialA_ == ec::Zero && mode != ec::Affine && sizeof(Fp) == sizeof(typename Fp::BaseFp)) {
+			fp::initEcLanes(lanes_, Fp::BaseFp::getOp(), b_.getUnit(), sizeof(Fp) / sizeof(Unit), mode == ec::Jacobi);
+		}
 	}
+	// true if addEach, dblEach and mulEach use 8 lanes of AVX-512 IFMA
+	static inline bool isLanesAvailable() { return lanes_.n > 0; }
 	static inline int getMode() { return mode_; }
+	/*
+		select the algorithm of mulVec for large n
+		mode = ec::MulVecJacobi or ec::MulVecBatchAffine
+	*/
+	static inline void setMulVecMode(int mode) { mulVecMode_ = mode; }
+	static inline int getMulVecMode() { return mulVecMode_; }
 	/*
 		verify the order of *this is equal to order if order != 0
 		in constructor, set, setStr, operator<<().
@@ -1252,6 +1847,19 @@ public:
 	{
 		mulVecGLV = f;
 	}
+	/*
+		f : mulVecGLV with a workspace
+		g : return the byte size of the workspace for f
+	*/
+	static void setMulVecGLVwork(bool f(EcT& z, const EcT *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt, void *work, size_t workSize), size_t g(size_t n))
+	{
+		mulVecGLVwork = f;
+		getMulVecGLVworkSize = g;
+	}
+	static void setMulEachGLV(void f(EcT *zVec, const EcT *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt))
+	{
+		mulEachGLV = f;
+	}
 	static inline void init(bool *pb, const char *astr, const char *bstr, int mode = ec::Jacobi)
 	{
 		Fp a, b;
@@ -1278,6 +1886,7 @@ public:
 			if (!ec::isValidJacobi(*this)) return false;
 			break;
 		case ec::Proj:
+		case ec::ProjComplete:
 			if (!ec::isValidProj(*this)) return false;
 			break;
 		case ec::Affine:
@@ -1303,7 +1912,11 @@ public:
 	void clear()
 	{
 		x.clear();
-		y.clear();
+		if (mode_ == ec::ProjComplete) {
+			y = 1;
+		} else {
+			y.clear();
+		}
 		z.clear();
 	}
 	static inline void dbl(EcT& R, const EcT& P)
@@ -1315,6 +1928,9 @@ public:
 		case ec::Proj:
 			ec::dblProj(R, P);
 			break;
+		case ec::ProjComplete:
+			ec::dblCTProj(R, P);
+			break;
 		case ec::Affine:
 			ec::dblAffine(R, P);
 			break;
@@ -1329,6 +1945,9 @@ public:
 		case ec::Proj:
 			ec::addProj(R, P, Q);
 			break;
+		case ec::ProjComplete:
+			ec::addCTProj(R, P, Q);
+			break;
 		case ec::Affine:
 			ec::addAffine(R, P, Q);
 			break;
@@ -1566,7 +2185,7 @@ public:
 			y.load(pb, is, IoSerialize);
 			if (!*pb) return;
 			if (x.isZero() && y.isZero()) {
-				z.clear();
+				clear();
 				return;
 			}
 			goto verifyValidAffine;
@@ -1740,6 +2359,7 @@ public:
 		case ec::Jacobi:
 			return ec::isEqualJacobi(*this, rhs);
 		case ec::Proj:
+		case ec::ProjComplete:
 			return ec::isEqualProj(*this, rhs);
 		case ec::Affine:
 		default:
@@ -1919,41 +2539,272 @@ public:
 		}
 		z = r;
 	}
+	/*
+		byte size of the workspace for mulVec(z, xVec, yVec, n, work, workSize)
+		return 0 if mulVec with n points does not need it (e.g. maxMulVecNGLV < n < 128)
+		work must be aligned to sizeof(Unit)
+	*/
+	static inline size_t getMulVecWorkSize(size_t n)
+	{
+		return getMulVecGLVworkSize ? getMulVecGLVworkSize(n) : 0;
+	}
+	/*
+		same as mulVec but use work instead of malloc and alloca if workSize >= getMulVecWorkSize(n)
+		otherwise work is ignored
+	*/
+	template<class tag, size_t maxBitSize, template<class _tag, size_t _maxBitSize>class FpT>
+	static inline void mulVec(EcT& z, EcT *xVec, const FpT<tag, maxBitSize> *yVec, size_t n, void *work, size_t workSize)
+	{
+		typedef FpT<tag, maxBitSize> F;
+		if (mulVecGLVwork && mulVecGLVwork(z, xVec, yVec, n, fp::getUnitAtT<F>, work, workSize)) {
+			return;
+		}
+		mulVec(z, xVec, yVec, n);
+	}
+	/*
+		use ec::mulVecWindowMT if it is estimated to be faster than
+		splitting xVec into cpuN slices, which repeats all windows in each thread
+		return false if it is not used
+		@note xVec may be normalized
+	*/
+	template<class F>
+	static bool mulVecWindowMTIfFaster(EcT& z, EcT *xVec, const F *yVec, size_t n, size_t cpuN)
+	{
+		const size_t yUnitSize = F::getUnitSize();
+		const size_t bitSize = F::getBitSize();
+		const size_t m = (n + cpuN - 1) / cpuN;
+		const size_t c1 = ec::argminForMulVec(m);
+		const size_t sliceCost = (bitSize + c1 - 1) / c1 * (m + 2 * ((size_t(1) << c1) - 1));
+		size_t c, winN, partN;
+		if (ec::getMulVecMTPartition(c, winN, partN, n, bitSize, cpuN) >= sliceCost) return false;
+		Unit *y = (Unit*)malloc(sizeof(Unit) * yUnitSize * n);
+		if (y == 0) return false;
+		for (size_t i = 0; i < n; i++) {
+			yVec[i].getUnitArray(y + yUnitSize * i);
+		}
+		normalizeVec(xVec, xVec, n);
+		bool ok = ec::mulVecWindowMT(z, xVec, y, yUnitSize, yUnitSize, n, cpuN);
+		free(y);
+		return ok;
+	}
+	// the num of threads used by mulVecMT
+	static inline size_t getMulVecMTcpuN(size_t n, size_t cpuN)
+	{
+#ifdef MCL_USE_OMP
+		const size_t minN = mcl::fp::maxMulVecN;
+		if (cpuN == 0) {
+			cpuN = omp_get_num_procs();
+			if (n < minN * cpuN) {
+				cpuN = (n + minN - 1) / minN;
+			}
+		}
+		if (cpuN <= 1 || n <= cpuN) return 1;
+		return cpuN;
+#else
+		(void)n;
+		(void)cpuN;
+		return 1;
+#endif
+	}
 	// multi thread version of mulVec
 	// the num of thread is automatically detected if cpuN = 0
 	template<class tag, size_t maxBitSize, template<class _tag, size_t _maxBitSize>class FpT>
 	static inline void mulVecMT(EcT& z, EcT *xVec, const FpT<tag, maxBitSize> *yVec, size_t n, size_t cpuN = 0)
 	{
+		cpuN = getMulVecMTcpuN(n, cpuN);
+		if (cpuN == 1) {
+			mulVec(z, xVec, yVec, n);
+			return;
+		}
+		if (mulVecWindowMTIfFaster(z, xVec, yVec, n, cpuN)) return;
+		EcT *zs = (EcT*)CYBOZU_ALLOCA(sizeof(EcT) * cpuN);
+		size_t q = n / cpuN;
+		size_t r = n % cpuN;
 #ifdef MCL_USE_OMP
-	const size_t minN = mcl::fp::maxMulVecN;
-	if (cpuN == 0) {
-		cpuN = omp_get_num_procs();
-		if (n < minN * cpuN) {
-			cpuN = (n + minN - 1) / minN;
+		#pragma omp parallel for
+#endif
+		for (size_t i = 0; i < cpuN; i++) {
+			size_t adj = q * i + fp::min_(i, r);
+			mulVec(zs[i], xVec + adj, yVec + adj, q + (i < r));
+		}
+		z.clear();
+		for (size_t i = 0; i < cpuN; i++) {
+			z += zs[i];
 		}
 	}
-	if (cpuN <= 1 || n <= cpuN) {
-		mulVec(z, xVec, yVec, n);
-		return;
+	// byte size of the workspace for each thread of mulVecMT
+	static inline size_t getMulVecMTWorkSizePerThread(size_t n, size_t cpuN)
+	{
+		const size_t q = n / cpuN;
+		return fp::max_(getMulVecWorkSize(q), getMulVecWorkSize(q + 1));
 	}
-	EcT *zs = (EcT*)CYBOZU_ALLOCA(sizeof(EcT) * cpuN);
-	size_t q = n / cpuN;
-	size_t r = n % cpuN;
-	#pragma omp parallel for
-	for (size_t i = 0; i < cpuN; i++) {
-		size_t adj = q * i + fp::min_(i, r);
-		mulVec(zs[i], xVec + adj, yVec + adj, q + (i < r));
+	/*
+		byte size of the workspace for mulVecMT(z, xVec, yVec, n, cpuN, work, workSize)
+		use the same cpuN as mulVecMT
+	*/
+	static inline size_t getMulVecMTWorkSize(size_t n, size_t cpuN = 0)
+	{
+		cpuN = getMulVecMTcpuN(n, cpuN);
+		if (cpuN == 1) return getMulVecWorkSize(n);
+		return getMulVecMTWorkSizePerThread(n, cpuN) * cpuN;
 	}
-	z.clear();
-//	#pragma omp declare reduction(red:EcT:omp_out *= omp_in) initializer(omp_priv = omp_orig)
-//	#pragma omp parallel for reduction(red:z)
-	for (size_t i = 0; i < cpuN; i++) {
-		z += zs[i];
+	/*
+		same as mulVecMT but each thread uses its own part of work instead of malloc and alloca
+		if workSize >= getMulVecMTWorkSize(n, cpuN), otherwise work is ignored
+	*/
+	template<class tag, size_t maxBitSize, template<class _tag, size_t _maxBitSize>class FpT>
+	static inline void mulVecMT(EcT& z, EcT *xVec, const FpT<tag, maxBitSize> *yVec, size_t n, size_t cpuN, void *work, size_t workSize)
+	{
+		cpuN = getMulVecMTcpuN(n, cpuN);
+		if (cpuN == 1) {
+			mulVec(z, xVec, yVec, n, work, workSize);
+			return;
+		}
+		const size_t perSize = getMulVecMTWorkSizePerThread(n, cpuN);
+		if (workSize < perSize * cpuN) {
+			mulVecMT(z, xVec, yVec, n, cpuN);
+			return;
+		}
+		EcT *zs = (EcT*)CYBOZU_ALLOCA(sizeof(EcT) * cpuN);
+		size_t q = n / cpuN;
+		size_t r = n % cpuN;
+#ifdef MCL_USE_OMP
+		#pragma omp parallel for
+#endif
+		for (size_t i = 0; i < cpuN; i++) {
+			size_t adj = q * i + fp::min_(i, r);
+			mulVec(zs[i], xVec + adj, yVec + adj, q + (i < r), (char*)work + perSize * i, perSize);
+		}
+		z.clear();
+		for (size_t i = 0; i < cpuN; i++) {
+			z += zs[i];
+		}
+	}
+	/*
+		zVec[i] = xVec[i] + yVec[i] for i = 0, ..., n-1 (not normalized)
+		zVec may be equal to xVec or yVec
+	*/
+	static inline void addEach(EcT *zVec, const EcT *xVec, const EcT *yVec, size_t n)
+	{
+		if (lanes_.n > 0) {
+			fp::addEachLanes(lanes_, zVec, xVec, yVec, n);
+			return;
+		}
+		for (size_t i = 0; i < n; i++) {
+			add(zVec[i], xVec[i], yVec[i]);
+		}
+	}
+	/*
+		zVec[i] = xVec[i] * 2 for i = 0, ..., n-1 (not normalized)
+		zVec may be equal to xVec
+	*/
+	static inline void dblEach(EcT *zVec, const EcT *xVec, size_t n)
+	{
+		if (lanes_.n > 0) {
+			fp::dblEachLanes(lanes_, zVec, xVec, n);
+			return;
+		}
+		for (size_t i = 0; i < n; i++) {
+			dbl(zVec[i], xVec[i]);
+		}
 	}
+	/*
+		zVec[i] = xVec[i] * yVec[i] for i = 0, ..., n-1
+		zVec is normalized and may be equal to xVec
+		not constant time
+	*/
+	template<class tag, size_t maxBitSize, template<class _tag, size_t _maxBitSize>class FpT>
+	static inline void mulEach(EcT *zVec, const EcT *xVec, const FpT<tag, maxBitSize> *yVec, size_t n)
+	{
+		typedef FpT<tag, maxBitSize> F;
+		if (lanes_.n > 0) {
+			fp::mulEachLanes(lanes_, zVec, xVec, yVec, n, fp::getUnitAtT<F>);
+			normalizeVec(zVec, zVec, n);
+			return;
+		}
+		if (mulEachGLV) {
+			mulEachGLV(zVec, xVec, yVec, n, fp::getUnitAtT<F>);
+			return;
+		}
+		for (size_t i = 0; i < n; i++) {
+			mul(zVec[i], xVec[i], yVec[i]);
+		}
+		normalizeVec(zVec, zVec, n);
+	}
+	// the num of threads used by mulEachMT
+	static inline size_t getMulEachMTcpuN(size_t n, size_t cpuN)
+	{
+#ifdef MCL_USE_OMP
+		if (cpuN == 0) {
+			cpuN = omp_get_num_procs();
+		}
+		if (cpuN > n) cpuN = n;
+		if (cpuN <= 1) return 1;
+		return cpuN;
 #else
+		(void)n;
 		(void)cpuN;
-		mulVec(z, xVec, yVec, n);
+		return 1;
+#endif
+	}
+	// multi thread version of mulEach
+	// the num of thread is automatically detected if cpuN = 0
+	template<class tag, size_t maxBitSize, template<class _tag, size_t _maxBitSize>class FpT>
+	static inline void mulEachMT(EcT *zVec, const EcT *xVec, const FpT<tag, maxBitSize> *yVec, size_t n, size_t cpuN = 0)
+	{
+		cpuN = getMulEachMTcpuN(n, cpuN);
+		if (cpuN == 1) {
+			mulEach(zVec, xVec, yVec, n);
+			return;
+		}
+		size_t q = n / cpuN;
+		size_t r = n % cpuN;
+#ifdef MCL_USE_OMP
+		#pragma omp parallel for
 #endif
+		for (size_t i = 0; i < cpuN; i++) {
+			size_t adj = q * i + fp::min_(i, r);
+			mulEach(zVec + adj, xVec + adj, yVec + adj, q + (i < r));
+		}
+	}
+	// the num of threads used by normalizeVecMT
+	static inline size_t getNormalizeVecMTcpuN(size_t n, size_t cpuN)
+	{
+#ifdef MCL_USE_OMP
+		// each thread has at least one inversion chunk of normalizeVec
+		const size_t minN = ec::local::getNormalizeVecChunkN<Fp>();
+		if (cpuN == 0) {
+			cpuN = omp_get_num_procs();
+			if (n < minN * cpuN) {
+				cpuN = (n + minN - 1) / minN;
+			}
+		}
+		if (cpuN <= 1 || n <= cpuN) return 1;
+		return cpuN;
+#else
+		(void)n;
+		(void)cpuN;
+		return 1;
+#endif
+	}
+	// multi thread version of normalizeVec
+	// the num of thread is automatically detected if cpuN = 0
+	static inline void normalizeVecMT(EcT *y, const EcT *x, size_t n, size_t cpuN = 0)
+	{
+		cpuN = getNormalizeVecMTcpuN(n, cpuN);
+		if (cpuN == 1) {
+			normalizeVec(y, x, n);
+			return;
+		}
+		size_t q = n / cpuN;
+		size_t r = n % cpuN;
+#ifdef MCL_USE_OMP
+		#pragma omp parallel for
+#endif
+		for (size_t i = 0; i < cpuN; i++) {
+			size_t adj = q * i + fp::min_(i, r);
+			normalizeVec(y + adj, x + adj, q + (i < r));
+		}
 	}
 #ifndef CYBOZU_DONT_USE_EXCEPTION
 	static inline void init(const std::string& astr, const std::string& bstr, int mode = ec::Jacobi)
@@ -2006,11 +2857,159 @@ template<class Fp> Fp EcT<Fp>::a_;
 template<class Fp> Fp EcT<Fp>::b_;
 template<class Fp> int EcT<Fp>::specialA_;
 template<class Fp> int EcT<Fp>::ioMode_;
+template<class Fp> int EcT<Fp>::mulVecMode_;
 template<class Fp> bool EcT<Fp>::verifyOrder_;
 template<class Fp> mpz_class EcT<Fp>::order_;
 template<class Fp> bool (*EcT<Fp>::mulVecGLV)(EcT& z, const EcT *xVec, const void *yVec, size_t n, fp::getMpzAtType getMpzAt, fp::getUnitAtType getUnitAt, bool constTime);
+template<class Fp> bool (*EcT<Fp>::mulVecGLVwork)(EcT& z, const EcT *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt, void *work, size_t workSize);
+template<class Fp> size_t (*EcT<Fp>::getMulVecGLVworkSize)(size_t n);
+template<class Fp> void (*EcT<Fp>::mulEachGLV)(EcT *zVec, const EcT *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt);
 template<class Fp> bool (*EcT<Fp>::isValidOrderFast)(const EcT& x);
 template<class Fp> int EcT<Fp>::mode_;
+template<class Fp> fp::EcLanes EcT<Fp>::lanes_;
+
+namespace local {
+
+/*
+	GLV split of x in [0, r) on Unit arrays without mpz_class
+	u[i] = (i == 0 ? x : 0) - sum_j t[j] B[j][i], t[j] = (x v[j]) >> rBitSize
+	it gives the same u[] as GLV::split on mpz_class
+	N : max unit size of Fr
+	u[] is computed in two's complement modulo 2^(UnitBitSize * W)
+*/
+template<int splitN, size_t N>
+struct GLVSplitUnitT {
+	static const size_t W = N + 1;
+	Unit v[splitN][W]; // abs(v[j])
+	size_t vn[splitN];
+	bool vNeg[splitN];
+	Unit B[splitN][splitN][W]; // B[j][i] in two's complement
+	size_t rUnitN;
+	bool enabled;
+	// return false if the constants are too large
+	bool init(const mpz_class *_v, const mpz_class (*_B)[splitN], size_t rBitSize)
+	{
+		enabled = false;
+		if (rBitSize % UnitBitSize) return false;
+		rUnitN = rBitSize / UnitBitSize;
+		bool b;
+		for (int j = 0; j < splitN; j++) {
+			vNeg[j] = _v[j] < 0;
+			mpz_class t = vNeg[j] ? -_v[j] : _v[j];
+			gmp::getArray(&b, v[j], W, t);
+			if (!b) return false;
+			vn[j] = bint::getRealSize(v[j], W);
+			for (int i = 0; i < splitN; i++) {
+				const bool isNeg = _B[j][i] < 0;
+				t = isNeg ? -_B[j][i] : _B[j][i];
+				gmp::getArray(&b, B[j][i], W, t);
+				if (!b || B[j][i][W - 1]) return false;
+				if (isNeg) neg(B[j][i]);
+			}
+		}
+		enabled = true;
+		return true;
+	}
+	static void neg(Unit *x)
+	{
+		for (size_t i = 0; i < W; i++) x[i] = ~x[i];
+		bint::addUnit(x, W, 1);
+	}
+	// u[i] = abs(u_i), isNeg[i] = u_i < 0
+	void split(bool isNeg[splitN], Unit u[splitN][N], const Unit *x, size_t xn) const
+	{
+		assert(enabled && xn <= N);
+		Unit acc[splitN][W];
+		for (int i = 0; i < splitN; i++) {
+			bint::clearN(acc[i], W);
+		}
+		xn = bint::getRealSize(x, xn);
+		bint::copyN(acc[0], x, xn);
+		for (int j = 0; j < splitN; j++) {
+			if (xn == 0 || vn[j] == 0) continue;
+			Unit xv[N + W];
+			const size_t xvn = xn + vn[j];
+			bint::mulNM(xv, x, xn, v[j], vn[j]);
+			// q = abs(t[j]), t[j] = (x v[j]) >> rBitSize as mpz_class
+			Unit q[N + W + 1];
+			size_t qn = 0;
+			if (xvn > rUnitN) {
+				qn = xvn - rUnitN;
+				bint::copyN(q, xv + rUnitN, qn);
+			}
+			q[qn++] = 0;
+#ifndef MCL_USE_VINT
+			// shift of GMP rounds toward -infinity (Vint rounds toward zero)
+			if (vNeg[j] && !bint::isZeroN(xv, fp::min_(rUnitN, xvn))) {
+				bint::addUnit(q, qn, 1);
+			}
+#endif
+			qn = bint::getRealSize(q, qn);
+			if (qn == 0) continue;
+			for (int i = 0; i < splitN; i++) {
+				// u_i -= t[j] B[j][i]
+				Unit prod[N + W + 1 + W];
+				bint::mulNM(prod, q, qn, B[j][i], W);
+				if (vNeg[j]) {
+					bint::addN(acc[i], acc[i], prod, W);
+				} else {
+					bint::subN(acc[i], acc[i], prod, W);
+				}
+			}
+		}
+		for (int i = 0; i < splitN; i++) {
+			isNeg[i] = (acc[i][W - 1] >> (UnitBitSize - 1)) != 0;
+			if (isNeg[i]) neg(acc[i]);
+			assert(acc[i][W - 1] == 0);
+			bint::copyN(u[i], acc[i], N);
+		}
+	}
+};
+
+/*
+	y[0:N] = x[0:xn] mod r where r is the order of Fr
+	return the real size of y
+*/
+template<class Fr, size_t N>
+size_t modForSplit(Unit y[N], const Unit *x, size_t xn)
+{
+	const fp::Op& op = Fr::getOp();
+	xn = bint::getRealSize(x, xn);
+	if (xn < op.N || (xn == op.N && bint::cmpLtN(x, op.p, xn))) {
+		bint::copyN(y, x, xn);
+		return xn;
+	}
+	Unit t[maxUnitSize];
+	assert(xn <= maxUnitSize);
+	bint::copyN(t, x, xn);
+	xn = bint::div(0, 0, t, xn, op.p, op.N);
+	xn = bint::getRealSize(t, xn);
+	bint::copyN(y, t, xn);
+	return xn;
+}
+
+/*
+	split x[0:xn] by GLV::split on mpz_class
+	for parameters which GLVSplitUnitT does not support
+*/
+template<class GLV, size_t N>
+void splitByMpz(bool isNeg[], Unit u[][N], const Unit *x, size_t xn)
+{
+	mpz_class t, mu[GLV::splitN];
+	bool b;
+	gmp::setArray(&b, t, x, xn);
+	assert(b);
+	GLV::split(mu, t);
+	for (int i = 0; i < GLV::splitN; i++) {
+		isNeg[i] = mu[i] < 0;
+		if (isNeg[i]) mu[i] = -mu[i];
+		gmp::getArray(&b, u[i], N, mu[i]);
+		assert(b);
+	}
+	(void)b;
+}
+
+} // mcl::local
 
 // r = the order of Ec
 template<class Ec, class _Fr>
@@ -2023,6 +3022,8 @@ struct GLV1T {
 	static size_t rBitSize;
 	static mpz_class v0, v1;
 	static mpz_class B[2][2];
+	static const size_t splitUnitN = _Fr::maxSize;
+	static local::GLVSplitUnitT<2, splitUnitN> splitUnit_;
 public:
 #ifndef CYBOZU_DONT_USE_STRING
 	static void dump(const mpz_class& x)
@@ -2061,6 +3062,37 @@ public:
 		a = x - (t * B[0][0] + b * B[1][0]);
 		b = - (t * B[0][1] + b * B[1][1]);
 	}
+	// upper bound of the bit size of |u[j]| for split
+	static size_t getSplitMaxBitSize()
+	{
+		mpz_class s = 0;
+		for (int i = 0; i < splitN; i++) {
+			for (int j = 0; j < splitN; j++) {
+				s += B[i][j] < 0 ? -B[i][j] : B[i][j];
+			}
+		}
+		return gmp::getBitSize(s) + 1;
+	}
+	/*
+		same as split for x[0:xn] without mpz_class
+		u[i] = abs(u_i), isNeg[i] = u_i < 0
+	*/
+	static void splitUnit(bool isNeg[2], Unit u[2][splitUnitN], const Unit *x, size_t xn)
+	{
+		Unit t[splitUnitN];
+		xn = local::modForSplit<Fr, splitUnitN>(t, x, xn);
+		if (splitUnit_.enabled) {
+			splitUnit_.split(isNeg, u, t, xn);
+		} else {
+			local::splitByMpz<GLV1, splitUnitN>(isNeg, u, t, xn);
+		}
+	}
+	// call this after setting v0, v1, B
+	static void initSplitUnit()
+	{
+		const mpz_class v[2] = { v0, v1 };
+		splitUnit_.init(v, B, rBitSize);
+	}
 	/*
 		initForBN() is defined in bn.hpp
 	*/
@@ -2082,6 +3114,7 @@ public:
 		const mpz_class& r = Fr::getOp().mp;
 		v0 = ((B[1][1]) << rBitSize) / r;
 		v1 = ((-B[0][1]) << rBitSize) / r;
+		initSplitUnit();
 	}
 };
 
@@ -2091,6 +3124,7 @@ template<class Ec, class Fr> size_t GLV1T<Ec, Fr>::rBitSize;
 template<class Ec, class Fr> mpz_class GLV1T<Ec, Fr>::v0;
 template<class Ec, class Fr> mpz_class GLV1T<Ec, Fr>::v1;
 template<class Ec, class Fr> mpz_class GLV1T<Ec, Fr>::B[2][2];
+template<class Ec, class Fr> local::GLVSplitUnitT<2, GLV1T<Ec, Fr>::splitUnitN> GLV1T<Ec, Fr>::splitUnit_;
 
 /*
 	Ec : elliptic curve
@@ -2124,8 +3158,12 @@ void initCurve(bool *pb, int curveType, Ec *P = 0, mcl::fp::Mode mode = fp::FP_A
 		typedef GLV1T<Ec, Zn> GLV1;
 		GLV1::initForSecp256k1();
 		Ec::setMulVecGLV(mcl::ec::mulVecGLVT<GLV1, Ec, Zn>);
+		Ec::setMulVecGLVwork(mcl::ec::mulVecGLVworkT<GLV1, Ec>, mcl::ec::getMulVecGLVworkSizeT<GLV1, Ec>);
+		Ec::setMulEachGLV(mcl::ec::mulEachGLVT<GLV1, Ec>);
 	} else {
 		Ec::setMulVecGLV(0);
+		Ec::setMulVecGLVwork(0, 0);
+		Ec::setMulEachGLV(0);
 	}
 }
 
@@ -24,6 +24,8 @@ namespace local {
 	#define MCLSHE_WIN_SIZE 10
 #endif
 static const size_t winSize = MCLSHE_WIN_SIZE;
+// the num of blocks of FixedBaseMul for Param::Pbase and PrecomputedPublicKey
+static const size_t pubBaseBlockN = 7;
 
 struct FpTag;
 struct ZnTag;
@@ -33,12 +35,13 @@ struct ZnTag;
 typedef mcl::FpT<local::FpTag, 256> Fp;
 typedef mcl::FpT<local::ZnTag, 256> Zn;
 typedef mcl::EcT<Fp> Ec;
+typedef mcl::fp::FixedBaseMul<Ec, mcl::GLV1T<Ec, Zn> > FixedBaseMul;
 
 namespace local {
 
 struct Param {
 	Ec P;
-	mcl::fp::WindowMethod<Ec> Pbase;
+	FixedBaseMul Pbase;
 	size_t bitSize;
 	int serializeMode;
 };
@@ -123,7 +126,7 @@ inline void init(bool *pb)
 	mcl::initCurve<Ec, Zn>(pb, MCL_SECP256K1, &p.P);
 	if (!*pb) return;
 	p.bitSize = 256;
-	p.Pbase.init(pb, p.P, p.bitSize, local::winSize);
+	p.Pbase.init(pb, p.P, p.bitSize, local::winSize, local::pubBaseBlockN);
 	// isValid() checks the order
 	Ec::setOrder(Zn::getOp().mp);
 	Fp::setETHserialization(true);
@@ -250,10 +253,10 @@ public:
 };
 
 struct PrecomputedPublicKey {
-	mcl::fp::WindowMethod<Ec> pubBase_;
+	FixedBaseMul pubBase_;
 	void init(bool *pb, const PublicKey& pub)
 	{
-		pubBase_.init(pb, pub, param.bitSize, local::winSize);
+		pubBase_.init(pb, pub, param.bitSize, local::winSize, local::pubBaseBlockN);
 	}
 #ifndef CYBOZU_DONT_USE_EXCEPTION
 	void init(const PublicKey& pub)
@@ -267,7 +270,7 @@ struct PrecomputedPublicKey {
 
 inline void getPublicKey(PublicKey& pub, const SecretKey& sec)
 {
-	Ec::mul(pub, param.P, sec);
+	param.Pbase.mul(pub, sec);
 	pub.normalize();
 }
 
@@ -411,7 +414,8 @@ inline void sign(Signature& sig, const SecretKey& sec, const void *msg, size_t m
 		Zn::mul(s, r, sec);
 		s += z;
 		if (s.isZero()) continue;
-		s /= k;
+		Zn::inv(k, k, true); // k is secret
+		s *= k;
 		normalizeSignature(sig);
 		return;
 	}
@@ -182,10 +182,10 @@ struct ElgamalT {
 		Ec g;
 		Ec h;
 		bool enableWindowMethod_;
-		fp::WindowMethod<Ec> wm_g;
-		fp::WindowMethod<Ec> wm_h;
+		fp::FixedBaseMul<Ec> wm_g;
+		fp::FixedBaseMul<Ec> wm_h;
 		template<class N>
-		void mulDispatch(Ec& z, const Ec& x, const N& n, const fp::WindowMethod<Ec>& pw) const
+		void mulDispatch(Ec& z, const Ec& x, const N& n, const fp::FixedBaseMul<Ec>& pw) const
 		{
 			if (enableWindowMethod_) {
 				pw.mul(z, n);
@@ -203,10 +203,15 @@ struct ElgamalT {
 			, enableWindowMethod_(false)
 		{
 		}
+		/*
+			Lim-Lee comb with one doubling per mul
+			the table has about half of the points of the window method with winSize
+		*/
 		void enableWindowMethod(size_t winSize = 10)
 		{
-			wm_g.init(g, bitSize, winSize);
-			wm_h.init(h, bitSize, winSize);
+			const size_t v = (bitSize + winSize * 2 - 1) / (winSize * 2);
+			wm_g.init(g, bitSize, winSize, v);
+			wm_h.init(h, bitSize, winSize, v);
 			enableWindowMethod_ = true;
 		}
 		const Ec& getG() const { return g; }
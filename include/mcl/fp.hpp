@@ -27,6 +27,7 @@
 #include <cybozu/hash.hpp>
 #include <cybozu/stream.hpp>
 #include <mcl/op.hpp>
+#include <mcl/fp_inline.hpp>
 #include <mcl/util.hpp>
 #include <mcl/operator.hpp>
 #include <mcl/conversion.hpp>
@@ -54,6 +55,20 @@ inline Mode StrToMode(const std::string& s)
 
 bool isEnableJIT(); // 1st call is not threadsafe
 
+/*
+	8-lane operations of points on y^2 = x^3 + b over Fp by AVX-512 IFMA
+	points are EcT<Fp> in Jacobi (isJacobi = true) or Proj coordinates
+	initEcLanes returns false if the CPU or p is not supported
+	the others must be called after initEcLanes returns true
+*/
+bool initEcLanes(EcLanes& lanes, const Op& op, const Unit *b, size_t fpUnitN, bool isJacobi);
+// zVec[i] = xVec[i] + yVec[i]
+void addEachLanes(const EcLanes& lanes, void *zVec, const void *xVec, const void *yVec, size_t n);
+// zVec[i] = xVec[i] * 2
+void dblEachLanes(const EcLanes& lanes, void *zVec, const void *xVec, size_t n);
+// zVec[i] = xVec[i] * yVec[i]
+void mulEachLanes(const EcLanes& lanes, void *zVec, const void *xVec, const void *yVec, size_t n, getUnitAtType getUnitAt);
+
 uint32_t sha256(void *out, uint32_t maxOutSize, const void *msg, uint32_t msgSize);
 uint32_t sha512(void *out, uint32_t maxOutSize, const void *msg, uint32_t msgSize);
 
@@ -90,6 +105,8 @@ private:
 	template<class Fp> friend class FpDblT;
 	template<class Fp> friend class Fp2T;
 	template<class Fp> friend struct Fp6T;
+	template<class Fp> friend struct Fp12T;
+	typedef fp::InlineFpT<fp::InlineModT<tag> > InlineFp;
 #ifdef MCL_XBYAK_DIRECT_CALL
 	static inline void addA(Unit *z, const Unit *x, const Unit *y)
 	{
@@ -132,8 +149,101 @@ private:
 		op_.fp_subPre(z, xy, pv);
 		op_.fp_sub(z, z, op_.p, op_.p);
 	}
+	/*
+		p - 1 = 2^r q for odd q and s = g^q for a non-residue g (see SquareRoot)
+		sqrtTbl[(b << w) + c] = s^(-c 2^b) for b in [0, r), c in [0, 2^w) and w = sqrtW
+	*/
+	static inline void initSquareRoot(bool *pb)
+	{
+		const int r = op_.sq.getR();
+		const int w = r < 4 ? r : 4;
+		const size_t W = size_t(1) << w;
+		gmp::getArray(pb, op_.sqrtExp, op_.N, (op_.sq.getQ() - 1) / 2);
+		if (!*pb) return;
+		op_.sqrtW = w;
+		*pb = op_.sqrtTbl.resize(maxSize * W * r);
+		if (!*pb) return;
+		FpT *tbl = reinterpret_cast<FpT*>(op_.sqrtTbl.data());
+		FpT sInv;
+		sInv.setMpz(pb, op_.sq.getS());
+		if (!*pb) return;
+		inv(sInv, sInv);
+		tbl[0] = 1;
+		for (size_t c = 1; c < W; c++) {
+			mul(tbl[c], tbl[c - 1], sInv);
+		}
+		for (size_t i = W; i < W * r; i++) {
+			sqr(tbl[i], tbl[i - W]);
+		}
+	}
+	/*
+		u = x^((q - 1) / 2), v = x u = x^((q + 1) / 2) and d = v u = x^q = s^k
+		x is a square iff k is even, and then sqrt(x) = v s^(-k/2), 1/sqrt(x) = u s^(-k/2)
+		k is found by the windowed discrete logarithm of Sarkar (https://eprint.iacr.org/2020/1407)
+		with w-bit digits k_i ; the digit k_i is the index of (d s^(-(k mod 2^(w i))))^(2^(r - w(i + 1)))
+		in the table of s^(-c 2^(r - w))
+	*/
+	static inline bool squareRootSub(FpT& y, const FpT& x, bool isInv)
+	{
+		if (x.isZero()) {
+			if (isInv) return false;
+			y.clear();
+			return true;
+		}
+		FpT u, v, d;
+		Operator::powArray(u, x, op_.sqrtExp, op_.N);
+		mul(v, x, u);
+		mul(d, v, u);
+		const int r = op_.sq.getR();
+		if (r == 1) {
+			// d = x^((p - 1) / 2)
+			if (!d.isOne()) return false;
+			y = isInv ? u : v;
+			return true;
+		}
+		const int w = op_.sqrtW;
+		const int W = 1 << w;
+		const int n = (r + w - 1) / w;
+		const FpT *tbl = reinterpret_cast<const FpT*>(op_.sqrtTbl.data());
+		FpT *dPow = (FpT*)CYBOZU_ALLOCA(sizeof(FpT) * n);
+		int *k = (int*)CYBOZU_ALLOCA(sizeof(int) * n);
+		// dPow[i] = d^(2^e(i)) for e(i) = max(r - w(i + 1), 0)
+		for (int i = n - 1, m = 0; i >= 0; i--) {
+			const int e = fp::max_(r - w * (i + 1), 0);
+			for (; m < e; m++) sqr(d, d);
+			dPow[i] = d;
+		}
+		const FpT *h = tbl + (r - w) * W;
+		for (int i = 0; i < n; i++) {
+			const int e = fp::max_(r - w * (i + 1), 0);
+			FpT z = dPow[i];
+			for (int j = 0; j < i; j++) {
+				if (k[j]) z *= tbl[(w * j + e) * W + k[j]];
+			}
+			int c = 0;
+			while (c < W && z != h[c]) c++;
+			if (c == W) return false; // not reached
+			// the top digit has r - w i bits
+			k[i] = ((W - c) & (W - 1)) >> (w - fp::min_(w, r - w * i));
+		}
+		if (k[0] & 1) return false;
+		FpT t = tbl[k[0] >> 1];
+		for (int j = 1; j < n; j++) {
+			if (k[j]) t *= tbl[(w * j - 1) * W + k[j]];
+		}
+		mul(y, isInv ? u : v, t);
+		return true;
+	}
 public:
 	typedef FpT<tag, maxBitSize> BaseFp;
+	// true if add, sub, neg, mul2, copy and clear are inline functions of fp::InlineFpT (see fp_inline.hpp)
+	static const bool useInline = fp::InlineModT<tag>::N > 0;
+	// true if mul and sqr are also inline (see MCL_FP_INLINE_MUL in fp_inline.hpp)
+#ifdef MCL_FP_INLINE_MUL
+	static const bool useInlineMul = useInline;
+#else
+	static const bool useInlineMul = false;
+#endif
 	// return pointer to array v_[]
 	const Unit *getUnit() const { return v_; }
 	FpT* getFp0() { return this; }
@@ -142,6 +252,8 @@ public:
 	static inline size_t getBitSize() { return op_.bitSize; }
 	static inline size_t getByteSize() { return (op_.bitSize + 7) / 8; }
 	static inline const fp::Op& getOp() { return op_; }
+	// the mode selected by init (the result of the measurement for fp::FP_TUNE)
+	static inline fp::Mode getMode() { return op_.mode; }
 	static inline fp::Op& getOpNonConst() { return op_; }
 	void dump() const
 	{
@@ -160,6 +272,10 @@ public:
 		return;
 #endif
 		if (!*pb) return;
+		if (useInline && !InlineFp::isSame(op_)) {
+			*pb = false;
+			return;
+		}
 		{ // set oneRep
 			FpT& one = *reinterpret_cast<FpT*>(op_.oneRep);
 			one.clear();
@@ -197,7 +313,7 @@ public:
 			op_.fp_mul9A_ = mul9A;
 		}
 #endif
-		*pb = true;
+		initSquareRoot(pb);
 	}
 	static inline void init(bool *pb, const mpz_class& p, fp::Mode mode = fp::FP_AUTO)
 	{
@@ -229,30 +345,60 @@ public:
 		getBlock(b);
 		return (b.p[0] & 1) == 1;
 	}
+	/*
+		y = sqrt(x) and return true if x is a square
+		y = x^((p + 1) / 4) if p = 3 mod 4
+	*/
 	static inline bool squareRoot(FpT& y, const FpT& x)
 	{
-		if (isMont()) return op_.sq.get(y, x);
-		mpz_class mx, my;
-		bool b = false;
-		x.getMpz(&b, mx);
-		if (!b) return false;
-		b = op_.sq.get(my, mx);
-		if (!b) return false;
-		y.setMpz(&b, my);
-		return b;
+		return squareRootSub(y, x, false);
+	}
+	/*
+		y = 1 / sqrt(x) by one exponentiation and return true if x is a non-zero square
+		sqrt(x) = x y
+	*/
+	static inline bool invSquareRoot(FpT& y, const FpT& x)
+	{
+		return squareRootSub(y, x, true);
+	}
+	/*
+		return the Legendre symbol (x|p) in {0, 1, -1} by a binary gcd without exponentiation
+		(xR|p) = (x|p) for the Montgomery representation because R = 2^(UnitBitSize N) is a square
+	*/
+	static inline int legendre(const FpT& x)
+	{
+		assert(op_.fp_legendre);
+		return op_.fp_legendre(x.v_, op_);
+	}
+	// x is a square (including 0)
+	static inline bool isSquare(const FpT& x)
+	{
+		return legendre(x) >= 0;
 	}
 	FpT() {}
 	FpT(const FpT& x)
 	{
+		if (useInline) {
+			bint::copyT<InlineFp::N>(v_, x.v_);
+			return;
+		}
 		op_.fp_copy(v_, x.v_);
 	}
 	FpT& operator=(const FpT& x)
 	{
+		if (useInline) {
+			bint::copyT<InlineFp::N>(v_, x.v_);
+			return *this;
+		}
 		op_.fp_copy(v_, x.v_);
 		return *this;
 	}
 	void clear()
 	{
+		if (useInline) {
+			bint::clearT<InlineFp::N>(v_);
+			return;
+		}
 		op_.fp_clear(v_);
 	}
 	FpT(int64_t x) { operator=(x); }
@@ -565,6 +711,10 @@ public:
 	}
 	static void add(FpT& z, const FpT& x, const FpT& y)
 	{
+		if (useInline) {
+			InlineFp::add(z.v_, x.v_, y.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		op_.fp_addA_(z.v_, x.v_, y.v_);
 #else
@@ -573,6 +723,10 @@ public:
 	}
 	static void sub(FpT& z, const FpT& x, const FpT& y)
 	{
+		if (useInline) {
+			InlineFp::sub(z.v_, x.v_, y.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		op_.fp_subA_(z.v_, x.v_, y.v_);
 #else
@@ -581,6 +735,10 @@ public:
 	}
 	static void neg(FpT& y, const FpT& x)
 	{
+		if (useInline) {
+			InlineFp::neg(y.v_, x.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		op_.fp_negA_(y.v_, x.v_);
 #else
@@ -589,6 +747,10 @@ public:
 	}
 	static void mul(FpT& z, const FpT& x, const FpT& y)
 	{
+		if (useInlineMul) {
+			InlineFp::mul(z.v_, x.v_, y.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		op_.fp_mulA_(z.v_, x.v_, y.v_);
 #else
@@ -597,14 +759,45 @@ public:
 	}
 	static void sqr(FpT& y, const FpT& x)
 	{
+		if (useInlineMul) {
+			InlineFp::sqr(y.v_, x.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		op_.fp_sqrA_(y.v_, x.v_);
 #else
 		op_.fp_sqr(y.v_, x.v_, op_.p);
 #endif
 	}
+	// z[i] = x[i] * y[i] for i = 0, ..., n - 1 (z may be equal to x or y)
+	static void mulEach(FpT *z, const FpT *x, const FpT *y, size_t n)
+	{
+		if (op_.fp_mulVec) {
+			op_.fp_mulVec(z->v_, x->v_, y->v_, n, maxSize, op_);
+			return;
+		}
+		for (size_t i = 0; i < n; i++) {
+			mul(z[i], x[i], y[i]);
+		}
+	}
+	static void sqrEach(FpT *y, const FpT *x, size_t n)
+	{
+		if (op_.fp_mulVec) {
+			op_.fp_mulVec(y->v_, x->v_, x->v_, n, maxSize, op_);
+			return;
+		}
+		for (size_t i = 0; i < n; i++) {
+			sqr(y[i], x[i]);
+		}
+	}
+	// true if mulEach multiplies 8 elements together
+	static bool isMulEachFast() { return op_.fp_mulVec != 0; }
 	static void mul2(FpT& y, const FpT& x)
 	{
+		if (useInline) {
+			InlineFp::add(y.v_, x.v_, x.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		op_.fp_mul2A_(y.v_, x.v_);
 #else
@@ -631,8 +824,16 @@ public:
 		if (mulSmallUnit(z, x, y)) return;
 		op_.fp_mulUnit(z.v_, x.v_, y, op_.p);
 	}
-	static inline void inv(FpT& y, const FpT& x)
+	/*
+		y = 1 / x
+		constTime : the running time does not depend on x (safegcd), and y = 0 if x = 0
+	*/
+	static inline void inv(FpT& y, const FpT& x, bool constTime = false)
 	{
+		if (constTime) {
+			op_.fp_invCT(y.v_, x.v_, op_);
+			return;
+		}
 		assert(!x.isZero());
 		op_.fp_invOp(y.v_, x.v_, op_);
 	}
@@ -653,7 +854,7 @@ public:
 		divBy2(y, x); // QQQ : optimize later
 		divBy2(y, y);
 	}
-	bool isZero() const { return op_.fp_isZero(v_); }
+	bool isZero() const { return useInline ? bint::isZeroT<InlineFp::N>(v_) : op_.fp_isZero(v_); }
 	bool isOne() const { return bint::cmpEqN(v_, op_.oneRep, op_.N); }
 	static const inline FpT& one() { return *reinterpret_cast<const FpT*>(op_.oneRep); }
 	/*
@@ -0,0 +1,340 @@
+#pragma once
+/**
+	@file
+	@brief inline Montgomery arithmetic for a modulus fixed at compile time
+	@author MITSUNARI Shigeo(@herumi)
+	@license modified new BSD license
+	http://opensource.org/licenses/BSD-3-Clause
+*/
+#include <mcl/op.hpp>
+#include <mcl/bint.hpp>
+#include <mcl/curve_type.h>
+
+/*
+	define MCL_FP_INLINE_MUL to use InlineFpT::mul, sqr, mulPre and mod in FpT and FpDblT
+	they are slower than the JIT code (mulx, adox) and the asm of bint on x64,
+	so only add, sub, neg, copy and clear are inline by default
+	Fp2 and the higher towers always use the functions in Op
+*/
+
+// carry chains by _addcarry_u64 and _subborrow_u64
+#if MCL_SIZEOF_UNIT == 8 && (defined(__x86_64__) || defined(_M_X64))
+	#define MCL_FP_INLINE_USE_ADDCARRY
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <x86intrin.h>
+	#endif
+#endif
+
+namespace mcl { namespace fp {
+
+/*
+	specialize InlineModT<tag> to make FpT<tag, maxBitSize> use InlineFpT<InlineModT<tag> >
+	instead of the function pointers in Op (see FpT::useInline)
+	N : num of Unit of p (N = 0 : not used)
+	p(i) : i-th Unit of p
+	rp : -p^(-1) mod 2^UnitBitSize
+	p must be less than 2^(UnitBitSize * N - 1)
+	FpT::init fails if the modulus is different from p
+*/
+template<class tag>
+struct InlineModT {
+	static const size_t N = 0;
+	static Unit p(size_t) { return 0; }
+	static const Unit rp = 0;
+};
+
+#if MCL_SIZEOF_UNIT == 8
+
+struct InlineModBN254p {
+	static const size_t N = 4;
+	static Unit p(size_t i)
+	{
+		static const Unit tbl[N] = {
+			0xa700000000000013, 0x6121000000000013, 0xba344d8000000008, 0x2523648240000001,
+		};
+		return tbl[i];
+	}
+	static const Unit rp = 0x08435e50d79435e5;
+};
+
+struct InlineModBN254r {
+	static const size_t N = 4;
+	static Unit p(size_t i)
+	{
+		static const Unit tbl[N] = {
+			0xa10000000000000d, 0xff9f800000000010, 0xba344d8000000007, 0x2523648240000001,
+		};
+		return tbl[i];
+	}
+	static const Unit rp = 0xea3b13b13b13b13b;
+};
+
+struct InlineModBLS12_381p {
+	static const size_t N = 6;
+	static Unit p(size_t i)
+	{
+		static const Unit tbl[N] = {
+			0xb9feffffffffaaab, 0x1eabfffeb153ffff, 0x6730d2a0f6b0f624,
+			0x64774b84f38512bf, 0x4b1ba7b6434bacd7, 0x1a0111ea397fe69a,
+		};
+		return tbl[i];
+	}
+	static const Unit rp = 0x89f3fffcfffcfffd;
+};
+
+struct InlineModBLS12_381r {
+	static const size_t N = 4;
+	static Unit p(size_t i)
+	{
+		static const Unit tbl[N] = {
+			0xffffffff00000001, 0x53bda402fffe5bfe, 0x3339d80809a1d805, 0x73eda753299d7d48,
+		};
+		return tbl[i];
+	}
+	static const Unit rp = 0xfffffffeffffffff;
+};
+
+// moduli of Fp and Fr of a pairing curve for MCL_FP_INLINE_CURVE (see bn.hpp)
+template<int curveType>
+struct InlineCurveT;
+
+template<>
+struct InlineCurveT<MCL_BN254> {
+	typedef InlineModBN254p Fp;
+	typedef InlineModBN254r Fr;
+};
+
+template<>
+struct InlineCurveT<MCL_BLS12_381> {
+	typedef InlineModBLS12_381p Fp;
+	typedef InlineModBLS12_381r Fr;
+};
+
+#endif // MCL_SIZEOF_UNIT == 8
+
+namespace local {
+
+// z = x + y + c and return carry
+inline Unit addUnitc(Unit *z, Unit x, Unit y, Unit c)
+{
+#ifdef MCL_FP_INLINE_USE_ADDCARRY
+	unsigned long long t;
+	Unit ret = _addcarry_u64((unsigned char)c, x, y, &t);
+	*z = t;
+	return ret;
+#else
+	Unit s = x + y;
+	Unit c1 = s < x;
+	*z = s + c;
+	return c1 | (*z < s);
+#endif
+}
+
+// z = x - y - c and return borrow
+inline Unit subUnitc(Unit *z, Unit x, Unit y, Unit c)
+{
+#ifdef MCL_FP_INLINE_USE_ADDCARRY
+	unsigned long long t;
+	Unit ret = _subborrow_u64((unsigned char)c, x, y, &t);
+	*z = t;
+	return ret;
+#else
+	Unit s = x - y;
+	Unit c1 = x < y;
+	*z = s - c;
+	return c1 | (s < c);
+#endif
+}
+
+// [ret:z] = x * y + a + c
+inline Unit mulAddUnitc(Unit *z, Unit x, Unit y, Unit a, Unit c)
+{
+#ifdef MCL_DEFINED_UINT128_T
+	bint::uint128_t v = bint::uint128_t(x) * y + a + c;
+	*z = Unit(v);
+	return Unit(v >> 64);
+#else
+	Unit H;
+	Unit L = bint::mulUnit1(&H, x, y);
+	H += addUnitc(&L, L, a, 0);
+	H += addUnitc(z, L, c, 0);
+	return H;
+#endif
+}
+
+} // mcl::fp::local
+
+/*
+	Montgomery arithmetic mod M::p with R = 2^(UnitBitSize * N)
+	all loops have constant trip counts, so the compiler can unroll them
+	and keep the values in registers
+*/
+template<class M>
+struct InlineFpT {
+	// N = 1 for InlineModT of an unspecialized tag to avoid zero-size arrays (not called)
+	static const size_t N = M::N ? M::N : 1;
+	// true if op was initialized by the same modulus with Montgomery
+	static bool isSame(const Op& op)
+	{
+		if (M::N == 0 || !op.isMont || op.N != N || op.rp != M::rp) return false;
+		for (size_t i = 0; i < N; i++) {
+			if (op.p[i] != M::p(i)) return false;
+		}
+		return true;
+	}
+	/*
+		z[N] = t if t < p else t - p for t = [top:t[N]] < 2p
+		p is added back by mask instead of selecting t, which keeps the values in registers
+	*/
+	static inline void finalSub(Unit *z, const Unit *t, Unit top)
+	{
+		Unit c = 0;
+		for (size_t i = 0; i < N; i++) {
+			c = local::subUnitc(&z[i], t[i], M::p(i), c);
+		}
+		const Unit mask = -Unit(c & ~top & 1);
+		Unit pm[N];
+		for (size_t i = 0; i < N; i++) {
+			pm[i] = M::p(i) & mask;
+		}
+		c = 0;
+		for (size_t i = 0; i < N; i++) {
+			c = local::addUnitc(&z[i], z[i], pm[i], c);
+		}
+	}
+	static inline void add(Unit *z, const Unit *x, const Unit *y)
+	{
+		Unit t[N];
+		Unit c = 0;
+		for (size_t i = 0; i < N; i++) {
+			c = local::addUnitc(&t[i], x[i], y[i], c);
+		}
+		finalSub(z, t, 0);
+	}
+	static inline void sub(Unit *z, const Unit *x, const Unit *y)
+	{
+		Unit t[N];
+		Unit c = 0;
+		for (size_t i = 0; i < N; i++) {
+			c = local::subUnitc(&t[i], x[i], y[i], c);
+		}
+		const Unit mask = -c;
+		c = 0;
+		for (size_t i = 0; i < N; i++) {
+			c = local::addUnitc(&z[i], t[i], M::p(i) & mask, c);
+		}
+	}
+	static inline void neg(Unit *y, const Unit *x)
+	{
+		Unit t[N];
+		Unit c = 0;
+		Unit nz = 0;
+		for (size_t i = 0; i < N; i++) {
+			nz |= x[i];
+			c = local::subUnitc(&t[i], M::p(i), x[i], c);
+		}
+		const Unit mask = -Unit(nz != 0);
+		for (size_t i = 0; i < N; i++) {
+			y[i] = t[i] & mask;
+		}
+	}
+	// z[N * 2] = x[N] * y[N]
+	static inline void mulPre(Unit *z, const Unit *x, const Unit *y)
+	{
+		Unit t[N * 2];
+		for (size_t i = 0; i < N * 2; i++) t[i] = 0;
+		for (size_t i = 0; i < N; i++) {
+			Unit c = 0;
+			for (size_t j = 0; j < N; j++) {
+				c = local::mulAddUnitc(&t[i + j], x[j], y[i], t[i + j], c);
+			}
+			t[i + N] = c;
+		}
+		for (size_t i = 0; i < N * 2; i++) z[i] = t[i];
+	}
+	// z[N] = xy[N * 2] / R mod p for xy < pR
+	static inline void mod(Unit *z, const Unit *xy)
+	{
+		Unit t[N * 2];
+		for (size_t i = 0; i < N * 2; i++) t[i] = xy[i];
+		Unit top = 0;
+		for (size_t i = 0; i < N; i++) {
+			const Unit q = t[i] * M::rp;
+			Unit c = 0;
+			for (size_t j = 0; j < N; j++) {
+				c = local::mulAddUnitc(&t[i + j], q, M::p(j), t[i + j], c);
+			}
+			c = local::addUnitc(&t[i + N], t[i + N], c, top);
+			top = c;
+		}
+		finalSub(z, t + N, top);
+	}
+	// t[N + 2] += x[N] * y and the carry out is ignored
+	static inline void mulUnitAdd(Unit *t, const Unit *x, Unit y)
+	{
+		Unit L[N], H[N];
+		for (size_t j = 0; j < N; j++) {
+			L[j] = bint::mulUnit1(&H[j], x[j], y);
+		}
+		Unit c = 0;
+		for (size_t j = 0; j < N; j++) {
+			c = local::addUnitc(&t[j], t[j], L[j], c);
+		}
+		c = local::addUnitc(&t[N], t[N], 0, c);
+		t[N + 1] += c;
+		c = 0;
+		for (size_t j = 0; j < N; j++) {
+			c = local::addUnitc(&t[j + 1], t[j + 1], H[j], c);
+		}
+		t[N + 1] += c;
+	}
+	/*
+		z[N] = x[N] * y[N] / R mod p (CIOS)
+		the low and high halves of the products are added by two carry chains
+	*/
+	static inline void mul(Unit *z, const Unit *x, const Unit *y)
+	{
+		Unit t[N + 2];
+		for (size_t i = 0; i < N + 2; i++) t[i] = 0;
+		Unit pp[N];
+		for (size_t i = 0; i < N; i++) pp[i] = M::p(i);
+		for (size_t i = 0; i < N; i++) {
+			mulUnitAdd(t, x, y[i]);
+			mulUnitAdd(t, pp, t[0] * M::rp);
+			// t[0] = 0 and t < 2p after the shift
+			for (size_t j = 0; j < N + 1; j++) t[j] = t[j + 1];
+			t[N + 1] = 0;
+		}
+		finalSub(z, t, 0);
+	}
+	static inline void sqr(Unit *y, const Unit *x)
+	{
+		mul(y, x, x);
+	}
+	// z[N * 2] = x + y where the upper half is reduced mod p
+	static inline void dblAdd(Unit *z, const Unit *x, const Unit *y)
+	{
+		Unit c = 0;
+		for (size_t i = 0; i < N * 2; i++) {
+			c = local::addUnitc(&z[i], x[i], y[i], c);
+		}
+		finalSub(z + N, z + N, 0);
+	}
+	// z[N * 2] = x - y where the upper half is reduced mod p
+	static inline void dblSub(Unit *z, const Unit *x, const Unit *y)
+	{
+		Unit c = 0;
+		for (size_t i = 0; i < N * 2; i++) {
+			c = local::subUnitc(&z[i], x[i], y[i], c);
+		}
+		const Unit mask = -c;
+		c = 0;
+		for (size_t i = 0; i < N; i++) {
+			c = local::addUnitc(&z[N + i], z[N + i], M::p(i) & mask, c);
+		}
+	}
+};
+
+} } // mcl::fp
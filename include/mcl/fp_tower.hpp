@@ -7,17 +7,22 @@
 	http://opensource.org/licenses/BSD-3-Clause
 */
 #include <mcl/fp.hpp>
+#ifdef MCL_USE_OMP
+#include <omp.h>
+#endif
 
 namespace mcl {
 
 template<class Fp> struct Fp12T;
 template<class Fp> class BNT;
 template<class Fp> struct Fp2DblT;
+template<class Fp> struct Fp6DblT;
 
 template<class Fp>
 class FpDblT : public fp::Serializable<FpDblT<Fp> > {
 	Unit v_[Fp::maxSize * 2];
 	friend struct Fp2DblT<Fp>;
+	friend struct Fp6DblT<Fp>;
 public:
 	static size_t getUnitSize() { return Fp::op_.N * 2; }
 	const Unit *getUnit() const { return v_; }
@@ -110,6 +115,10 @@ public:
 	}
 	static inline void add(FpDblT& z, const FpDblT& x, const FpDblT& y)
 	{
+		if (Fp::useInline) {
+			Fp::InlineFp::dblAdd(z.v_, x.v_, y.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		Fp::op_.fpDbl_addA_(z.v_, x.v_, y.v_);
 #else
@@ -118,6 +127,10 @@ public:
 	}
 	static inline void sub(FpDblT& z, const FpDblT& x, const FpDblT& y)
 	{
+		if (Fp::useInline) {
+			Fp::InlineFp::dblSub(z.v_, x.v_, y.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		Fp::op_.fpDbl_subA_(z.v_, x.v_, y.v_);
 #else
@@ -126,6 +139,10 @@ public:
 	}
 	static inline void mod(Fp& z, const FpDblT& xy)
 	{
+		if (Fp::useInlineMul) {
+			Fp::InlineFp::mod(z.v_, xy.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		Fp::op_.fpDbl_modA_(z.v_, xy.v_);
 #else
@@ -142,8 +159,22 @@ public:
 	/*
 		mul(z, x, y) = mulPre(xy, x, y) + mod(z, xy)
 	*/
-	static void mulPre(FpDblT& xy, const Fp& x, const Fp& y) { Fp::op_.fpDbl_mulPre(xy.v_, x.v_, y.v_); }
-	static void sqrPre(FpDblT& xx, const Fp& x) { Fp::op_.fpDbl_sqrPre(xx.v_, x.v_); }
+	static void mulPre(FpDblT& xy, const Fp& x, const Fp& y)
+	{
+		if (Fp::useInlineMul) {
+			Fp::InlineFp::mulPre(xy.v_, x.v_, y.v_);
+			return;
+		}
+		Fp::op_.fpDbl_mulPre(xy.v_, x.v_, y.v_);
+	}
+	static void sqrPre(FpDblT& xx, const Fp& x)
+	{
+		if (Fp::useInlineMul) {
+			Fp::InlineFp::mulPre(xx.v_, x.v_, x.v_);
+			return;
+		}
+		Fp::op_.fpDbl_sqrPre(xx.v_, x.v_);
+	}
 	static void mulUnit(FpDblT& z, const FpDblT& x, Unit y)
 	{
 		if (mulSmallUnit(z, x, y)) return;
@@ -219,6 +250,10 @@ public:
 	}
 	static void add(Fp2T& z, const Fp2T& x, const Fp2T& y)
 	{
+		if (Fp::useInline) {
+			addA(z.a.v_, x.a.v_, y.a.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		Fp::op_.fp2_addA_(z.a.v_, x.a.v_, y.a.v_);
 #else
@@ -227,6 +262,10 @@ public:
 	}
 	static void sub(Fp2T& z, const Fp2T& x, const Fp2T& y)
 	{
+		if (Fp::useInline) {
+			subA(z.a.v_, x.a.v_, y.a.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		Fp::op_.fp2_subA_(z.a.v_, x.a.v_, y.a.v_);
 #else
@@ -235,6 +274,10 @@ public:
 	}
 	static void neg(Fp2T& y, const Fp2T& x)
 	{
+		if (Fp::useInline) {
+			negA(y.a.v_, x.a.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		Fp::op_.fp2_negA_(y.a.v_, x.a.v_);
 #else
@@ -259,6 +302,10 @@ public:
 	}
 	static void mul2(Fp2T& y, const Fp2T& x)
 	{
+		if (Fp::useInline) {
+			mul2A(y.a.v_, x.a.v_);
+			return;
+		}
 #ifdef MCL_XBYAK_DIRECT_CALL
 		Fp::op_.fp2_mul2A_(y.a.v_, x.a.v_);
 #else
@@ -272,19 +319,49 @@ public:
 	/*
 		x = a + bi
 		1 / x = (a - bi) / (a^2 + b^2)
+		constTime : use the constant-time Fp::inv (also for Fp6T::inv and Fp12T::inv)
 	*/
-	static void inv(Fp2T& y, const Fp2T& x)
+	static void inv(Fp2T& y, const Fp2T& x, bool constTime = false)
 	{
-		assert(!x.isZero());
+		assert(constTime || !x.isZero());
 		const Fp& a = x.a;
 		const Fp& b = x.b;
 		Fp r;
 		norm(r, x);
-		Fp::inv(r, r); // r = 1 / (a^2 + b^2)
+		Fp::inv(r, r, constTime); // r = 1 / (a^2 + b^2)
 		Fp::mul(y.a, a, r);
 		Fp::mul(y.b, b, r);
 		Fp::neg(y.b, y.b);
 	}
+	/*
+		y[i] = 1/x[i] for x[i] != 0 else 0
+		return num of x[i] not in {0, 1}
+		the norms a^2 + b^2 are inverted by Fp::invVec
+	*/
+	static size_t invVec(Fp2T *y, const Fp2T *x, size_t n)
+	{
+		const size_t N = 256;
+		Fp r[N];
+		size_t retNum = 0;
+		while (n > 0) {
+			const size_t m = fp::min_(n, N);
+			for (size_t i = 0; i < m; i++) {
+				if (!(x[i].isZero() || x[i].isOne())) retNum++;
+				norm(r[i], x[i]);
+			}
+			Fp::invVec(r, r, m);
+			for (size_t i = 0; i < m; i++) {
+				Fp::mul(y[i].a, x[i].a, r[i]);
+				Fp::mul(y[i].b, x[i].b, r[i]);
+				Fp::neg(y[i].b, y[i].b);
+			}
+			x += m;
+			y += m;
+			n -= m;
+		}
+		return retNum;
+	}
+	static bool isInvVecFast() { return true; }
 	static void addPre(Fp2T& z, const Fp2T& x, const Fp2T& y)
 	{
 		Fp::addPre(z.a, x.a, y.a);
@@ -376,24 +453,35 @@ public:
 			}
 			return true;
 		}
-		Fp::sqr(t1, x.a);
-		Fp::sqr(t2, x.b);
-		t1 += t2; // c^2 + d^2
+		norm(t1, x); // c^2 + d^2
 		if (!Fp::squareRoot(t1, t1)) return false;
 		Fp::add(t2, x.a, t1);
 		Fp::divBy2(t2, t2);
-		if (!Fp::squareRoot(t2, t2)) {
+		// select the sign of sqrt(c^2 + d^2) by the Legendre symbol instead of a failed exponentiation
+		if (Fp::legendre(t2) <= 0) {
 			Fp::sub(t2, x.a, t1);
 			Fp::divBy2(t2, t2);
-			bool b = Fp::squareRoot(t2, t2);
-			assert(b); (void)b;
 		}
-		y.a = t2;
-		t2 += t2;
-		Fp::inv(t2, t2);
-		Fp::mul(y.b, x.b, t2);
+		// a = A sqrt(1/A) and b = d / 2a = d sqrt(1/A) / 2 without inversion
+		Fp r;
+		bool b = Fp::invSquareRoot(r, t2);
+		assert(b); (void)b;
+		Fp::mul(y.b, x.b, r);
+		Fp::divBy2(y.b, y.b);
+		Fp::mul(y.a, t2, r);
 		return true;
 	}
+	// the quadratic character of x ; x is a square iff the norm a^2 + b^2 is a square in Fp
+	static inline int legendre(const Fp2T& x)
+	{
+		Fp t;
+		norm(t, x);
+		return Fp::legendre(t);
+	}
+	static inline bool isSquare(const Fp2T& x)
+	{
+		return legendre(x) >= 0;
+	}
 	// y = a^2 + b^2
 	static void inline norm(Fp& y, const Fp2T& x)
 	{
@@ -756,8 +844,6 @@ template<class Fp> Fp2T<Fp> Fp2T<Fp>::g[Fp2T<Fp>::gN];
 template<class Fp> Fp2T<Fp> Fp2T<Fp>::g2[Fp2T<Fp>::gN];
 template<class Fp> Fp2T<Fp> Fp2T<Fp>::g3[Fp2T<Fp>::gN];
 
-template<class Fp>
-struct Fp6DblT;
 /*
 	Fp6T = Fp2[v] / (v^3 - xi)
 	x = a + b v + c v^2
@@ -897,7 +983,7 @@ struct Fp6T : public fp::Serializable<Fp6T<_Fp>,
 		q = c^3 xi^2 + b(b^2 - 3ac)xi + a^3
 		  = (a^2 - bc xi)a + ((c^2 xi - ab)c + (b^2 - ac)b) xi
 	*/
-	static void inv(Fp6T& y, const Fp6T& x)
+	static void inv(Fp6T& y, const Fp6T& x, bool constTime = false)
 	{
 		const Fp2& a = x.a;
 		const Fp2& b = x.b;
@@ -930,7 +1016,7 @@ struct Fp6T : public fp::Serializable<Fp6T<_Fp>,
 		Fp2Dbl::add(T, T, T2);
 		Fp2 q;
 		Fp2Dbl::mod(q, T);
-		Fp2::inv(q, q);
+		Fp2::inv(q, q, constTime);
 
 		Fp2::mul(y.a, p.a, q);
 		Fp2::mul(y.b, p.b, q);
@@ -1057,10 +1143,17 @@ struct Fp6DblT {
 		Fp2Dbl::mod(y.b, x.b);
 		Fp2Dbl::mod(y.c, x.c);
 	}
+	// mulPreT<true> generated by FpGenerator
+	static void mulPreA(Fp6DblT& z, const Fp6& x, const Fp6& y)
+	{
+		Fp::getOp().fp6Dbl_mulPreA_(z.a.a.v_, x.a.getUnit(), y.a.getUnit());
+	}
 	static void init()
 	{
 		const mcl::fp::Op& op = Fp::getOp();
-		if (op.isLtQuad) {
+		if (op.fp6Dbl_mulPreA_) {
+			mulPre = mulPreA;
+		} else if (op.isLtQuad) {
 			mulPre = mulPreT<true>;
 		} else {
 			mulPre = mulPreT<false>;
@@ -1166,6 +1259,10 @@ struct Fp12T : public fp::Serializable<Fp12T<Fp>,
 	*/
 	static void mul(Fp12T& z, const Fp12T& x, const Fp12T& y)
 	{
+		if (Fp::op_.fp12_mulA_) {
+			Fp::op_.fp12_mulA_(z.a.a.a.v_, x.a.a.a.v_, y.a.a.a.v_);
+			return;
+		}
 		// 4.7Kclk -> 4.55Kclk
 		const Fp6& a = x.a;
 		const Fp6& b = x.b;
@@ -1206,7 +1303,7 @@ struct Fp12T : public fp::Serializable<Fp12T<Fp>,
 		x = a + bw, w^2 = v
 		y = 1/x = (a - bw) / (a^2 - b^2v)
 	*/
-	static void inv(Fp12T& y, const Fp12T& x)
+	static void inv(Fp12T& y, const Fp12T& x, bool constTime = false)
 	{
 		const Fp6& a = x.a;
 		const Fp6& b = x.b;
@@ -1219,7 +1316,7 @@ struct Fp12T : public fp::Serializable<Fp12T<Fp>,
 		Fp2Dbl::sub(AA.c, AA.c, BB.b); // a^2 - b^2 v
 		Fp6 t;
 		Fp6Dbl::mod(t, AA);
-		Fp6::inv(t, t);
+		Fp6::inv(t, t, constTime);
 		Fp6::mul(y.a, x.a, t);
 		Fp6::mul(y.b, x.b, t);
 		Fp6::neg(y.b, y.b);
@@ -1364,6 +1461,111 @@ struct Fp12T : public fp::Serializable<Fp12T<Fp>,
 			z *= t;
 		}
 	}
+	/*
+		f : powVecGLV with a workspace
+		g : return the byte size of the workspace for f
+	*/
+	static void setPowVecGLVwork(bool f(Fp12T& z, const Fp12T *xVec, const void *yVec, size_t n, fp::getUnitAtType getUnitAt, void *work, size_t workSize), size_t g(size_t n))
+	{
+		BaseClass::powVecGLVwork = f;
+		BaseClass::getPowVecGLVworkSize = g;
+	}
+	/*
+		byte size of the workspace for powVec(z, xVec, yVec, n, work, workSize)
+		return 0 if powVec with n elements does not need it (e.g. maxMulVecNGLV < n < 128)
+		work must be aligned to sizeof(Unit)
+	*/
+	static inline size_t getPowVecWorkSize(size_t n)
+	{
+		return BaseClass::getPowVecGLVworkSize ? BaseClass::getPowVecGLVworkSize(n) : 0;
+	}
+	/*
+		same as powVec but use work instead of malloc and alloca if workSize >= getPowVecWorkSize(n)
+		otherwise work is ignored
+	*/
+	template<class tag, size_t maxBitSize, template<class _tag, size_t _maxBitSize>class FpT>
+	static inline void powVec(Fp12T& z, const Fp12T *xVec, const FpT<tag, maxBitSize> *yVec, size_t n, void *work, size_t workSize)
+	{
+		typedef FpT<tag, maxBitSize> F;
+		if (BaseClass::powVecGLVwork && BaseClass::powVecGLVwork(z, xVec, yVec, n, fp::getUnitAtT<F>, work, workSize)) {
+			return;
+		}
+		powVec(z, xVec, yVec, n);
+	}
+	// the num of threads used by powVecMT
+	static inline size_t getPowVecMTcpuN(size_t n, size_t cpuN)
+	{
+#ifdef MCL_USE_OMP
+		const size_t minN = mcl::fp::maxMulVecN;
+		if (cpuN == 0) {
+			cpuN = omp_get_num_procs();
+			if (n < minN * cpuN) {
+				cpuN = (n + minN - 1) / minN;
+			}
+		}
+		if (cpuN <= 1 || n <= cpuN) return 1;
+		return cpuN;
+#else
+		(void)n;
+		(void)cpuN;
+		return 1;
+#endif
+	}
+	// multi thread version of powVec
+	// the num of thread is automatically detected if cpuN = 0
+	template<class tag, size_t maxBitSize, template<class _tag, size_t _maxBitSize>class FpT>
+	static inline void powVecMT(Fp12T& z, const Fp12T *xVec, const FpT<tag, maxBitSize> *yVec, size_t n, size_t cpuN = 0)
+	{
+		powVecMT(z, xVec, yVec, n, cpuN, 0, 0);
+	}
+	// byte size of the workspace for each thread of powVecMT
+	static inline size_t getPowVecMTWorkSizePerThread(size_t n, size_t cpuN)
+	{
+		const size_t q = n / cpuN;
+		return fp::max_(getPowVecWorkSize(q), getPowVecWorkSize(q + 1));
+	}
+	/*
+		byte size of the workspace for powVecMT(z, xVec, yVec, n, cpuN, work, workSize)
+		use the same cpuN as powVecMT
+	*/
+	static inline size_t getPowVecMTWorkSize(size_t n, size_t cpuN = 0)
+	{
+		cpuN = getPowVecMTcpuN(n, cpuN);
+		if (cpuN == 1) return getPowVecWorkSize(n);
+		return getPowVecMTWorkSizePerThread(n, cpuN) * cpuN;
+	}
+	/*
+		same as powVecMT but each thread uses its own part of work instead of malloc and alloca
+		if workSize >= getPowVecMTWorkSize(n, cpuN), otherwise work is ignored
+	*/
+	template<class tag, size_t maxBitSize, template<class _tag, size_t _maxBitSize>class FpT>
+	static inline void powVecMT(Fp12T& z, const Fp12T *xVec, const FpT<tag, maxBitSize> *yVec, size_t n, size_t cpuN, void *work, size_t workSize)
+	{
+		cpuN = getPowVecMTcpuN(n, cpuN);
+		if (cpuN == 1) {
+			powVec(z, xVec, yVec, n, work, workSize);
+			return;
+		}
+		size_t perSize = getPowVecMTWorkSizePerThread(n, cpuN);
+		if (workSize < perSize * cpuN) {
+			work = 0;
+			perSize = 0;
+		}
+		Fp12T *zs = (Fp12T*)CYBOZU_ALLOCA(sizeof(Fp12T) * cpuN);
+		size_t q = n / cpuN;
+		size_t r = n % cpuN;
+#ifdef MCL_USE_OMP
+		#pragma omp parallel for
+#endif
+		for (size_t i = 0; i < cpuN; i++) {
+			size_t adj = q * i + fp::min_(i, r);
+			powVec(zs[i], xVec + adj, yVec + adj, q + (i < r), (char*)work + perSize * i, perSize);
+		}
+		z = zs[0];
+		for (size_t i = 1; i < cpuN; i++) {
+			z *= zs[i];
+		}
+	}
 private:
 	template<class G, class Vec>
 	static void mulTbl(G& Q, const G *tbl, const Vec& naf, size_t i)
@@ -758,6 +758,10 @@ class SquareRoot {
 public:
 	SquareRoot() { clear(); }
 	bool isPrecomputed() const { return isPrecomputed_; }
+	// p - 1 = 2^r q for odd q and s = g^q for a quadratic non-residue g (valid after set)
+	int getR() const { return r; }
+	const mpz_class& getQ() const { return q; }
+	const mpz_class& getS() const { return s; }
 	void clear()
 	{
 		isPrecomputed_ = false;
@@ -18,6 +18,7 @@
 #endif
 #include <mcl/lagrange.hpp>
 #include <mcl/ecparam.hpp>
+#include <new>
 using namespace mcl::bn;
 
 static Fr *cast(mclBnFr *p) { return reinterpret_cast<Fr*>(p); }
@@ -35,6 +36,8 @@ static const Fp12 *cast(const mclBnGT *p) { return reinterpret_cast<const Fp12*>
 static Fp6 *cast(uint64_t *p) { return reinterpret_cast<Fp6*>(p); }
 static const Fp6 *cast(const uint64_t *p) { return reinterpret_cast<const Fp6*>(p); }
 
+static PairingProductChecker *cast(mclBnPairingProductChecker *p) { return reinterpret_cast<PairingProductChecker*>(p); }
+
 static Fp2 *cast(mclBnFp2 *p) { return reinterpret_cast<Fp2*>(p); }
 static const Fp2 *cast(const mclBnFp2 *p) { return reinterpret_cast<const Fp2*>(p); }
 
@@ -635,6 +638,14 @@ void mclBnGT_powVec(mclBnGT *z, const mclBnGT *x, const mclBnFr *y, mclSize n)
 {
 	GT::powVec(*cast(z), cast(x), cast(y), n);
 }
+void mclBnG1_mulEach(mclBnG1 *z, const mclBnG1 *x, const mclBnFr *y, mclSize n)
+{
+	G1::mulEach(cast(z), cast(x), cast(y), n);
+}
+void mclBnG2_mulEach(mclBnG2 *z, const mclBnG2 *x, const mclBnFr *y, mclSize n)
+{
+	G2::mulEach(cast(z), cast(x), cast(y), n);
+}
 
 void mclBn_pairing(mclBnGT *z, const mclBnG1 *x, const mclBnG2 *y)
 {
@@ -644,6 +655,10 @@ void mclBn_finalExp(mclBnGT *y, const mclBnGT *x)
 {
 	finalExp(*cast(y), *cast(x));
 }
+void mclBn_finalExpVec(mclBnGT *y, const mclBnGT *x, mclSize n)
+{
+	finalExpVec(cast(y), cast(x), n);
+}
 void mclBn_millerLoop(mclBnGT *z, const mclBnG1 *x, const mclBnG2 *y)
 {
 	millerLoop(*cast(z), *cast(x), *cast(y));
@@ -664,6 +679,70 @@ void mclBnG2_mulVecMT(mclBnG2 *z, mclBnG2 *x, const mclBnFr *y, mclSize n, mclSi
 {
 	G2::mulVecMT(*cast(z), cast(x), cast(y), n, cpuN);
 }
+void mclBnGT_powVecMT(mclBnGT *z, const mclBnGT *x, const mclBnFr *y, mclSize n, mclSize cpuN)
+{
+	GT::powVecMT(*cast(z), cast(x), cast(y), n, cpuN);
+}
+void mclBn_finalExpVecMT(mclBnGT *y, const mclBnGT *x, mclSize n, mclSize cpuN)
+{
+	finalExpVecMT(cast(y), cast(x), n, cpuN);
+}
+void mclBnG1_mulEachMT(mclBnG1 *z, const mclBnG1 *x, const mclBnFr *y, mclSize n, mclSize cpuN)
+{
+	G1::mulEachMT(cast(z), cast(x), cast(y), n, cpuN);
+}
+void mclBnG2_mulEachMT(mclBnG2 *z, const mclBnG2 *x, const mclBnFr *y, mclSize n, mclSize cpuN)
+{
+	G2::mulEachMT(cast(z), cast(x), cast(y), n, cpuN);
+}
+mclSize mclBnG1_getMulVecWorkSize(mclSize n)
+{
+	return G1::getMulVecWorkSize(n);
+}
+mclSize mclBnG2_getMulVecWorkSize(mclSize n)
+{
+	return G2::getMulVecWorkSize(n);
+}
+mclSize mclBnGT_getPowVecWorkSize(mclSize n)
+{
+	return GT::getPowVecWorkSize(n);
+}
+void mclBnG1_mulVecWork(mclBnG1 *z, mclBnG1 *x, const mclBnFr *y, mclSize n, void *work, mclSize workSize)
+{
+	G1::mulVec(*cast(z), cast(x), cast(y), n, work, workSize);
+}
+void mclBnG2_mulVecWork(mclBnG2 *z, mclBnG2 *x, const mclBnFr *y, mclSize n, void *work, mclSize workSize)
+{
+	G2::mulVec(*cast(z), cast(x), cast(y), n, work, workSize);
+}
+void mclBnGT_powVecWork(mclBnGT *z, const mclBnGT *x, const mclBnFr *y, mclSize n, void *work, mclSize workSize)
+{
+	GT::powVec(*cast(z), cast(x), cast(y), n, work, workSize);
+}
+mclSize mclBnG1_getMulVecMTWorkSize(mclSize n, mclSize cpuN)
+{
+	return G1::getMulVecMTWorkSize(n, cpuN);
+}
+mclSize mclBnG2_getMulVecMTWorkSize(mclSize n, mclSize cpuN)
+{
+	return G2::getMulVecMTWorkSize(n, cpuN);
+}
+mclSize mclBnGT_getPowVecMTWorkSize(mclSize n, mclSize cpuN)
+{
+	return GT::getPowVecMTWorkSize(n, cpuN);
+}
+void mclBnG1_mulVecMTWork(mclBnG1 *z, mclBnG1 *x, const mclBnFr *y, mclSize n, mclSize cpuN, void *work, mclSize workSize)
+{
+	G1::mulVecMT(*cast(z), cast(x), cast(y), n, cpuN, work, workSize);
+}
+void mclBnG2_mulVecMTWork(mclBnG2 *z, mclBnG2 *x, const mclBnFr *y, mclSize n, mclSize cpuN, void *work, mclSize workSize)
+{
+	G2::mulVecMT(*cast(z), cast(x), cast(y), n, cpuN, work, workSize);
+}
+void mclBnGT_powVecMTWork(mclBnGT *z, const mclBnGT *x, const mclBnFr *y, mclSize n, mclSize cpuN, void *work, mclSize workSize)
+{
+	GT::powVecMT(*cast(z), cast(x), cast(y), n, cpuN, work, workSize);
+}
 int mclBn_getUint64NumToPrecompute(void)
 {
 	return int(BN::param.precomputedQcoeffSize * sizeof(Fp6) / sizeof(uint64_t));
@@ -689,6 +768,58 @@ void mclBn_precomputedMillerLoop2mixed(mclBnGT *f, const mclBnG1 *P1, const mclB
 	precomputedMillerLoop2mixed(*cast(f), *cast(P1), *cast(Q1), *cast(P2), cast(Q2buf));
 }
 
+mclSize mclBn_getPrecomputedG2SerializeSize(void)
+{
+	return (mclSize)getPrecomputedG2SerializeSize();
+}
+
+mclSize mclBn_serializePrecomputedG2(void *buf, mclSize maxBufSize, const uint64_t *Qbuf)
+{
+	return (mclSize)serializePrecomputedG2(buf, maxBufSize, cast(Qbuf));
+}
+
+const uint64_t *mclBn_getPrecomputedG2FromBuffer(const void *buf, mclSize bufSize)
+{
+	return reinterpret_cast<const uint64_t*>(getPrecomputedG2FromBuffer(buf, bufSize));
+}
+
+mclBnPairingProductChecker *mclBnPairingProductChecker_create(void)
+{
+	void *p = malloc(sizeof(PairingProductChecker));
+	if (p == 0) return 0;
+	return reinterpret_cast<mclBnPairingProductChecker*>(new(p) PairingProductChecker());
+}
+void mclBnPairingProductChecker_destroy(mclBnPairingProductChecker *c)
+{
+	if (c == 0) return;
+	cast(c)->~PairingProductChecker();
+	free(c);
+}
+void mclBnPairingProductChecker_clear(mclBnPairingProductChecker *c)
+{
+	cast(c)->clear();
+}
+void mclBnPairingProductChecker_add(mclBnPairingProductChecker *c, const mclBnG1 *P, const mclBnG2 *Q)
+{
+	cast(c)->add(*cast(P), *cast(Q));
+}
+void mclBnPairingProductChecker_addVec(mclBnPairingProductChecker *c, const mclBnG1 *P, const mclBnG2 *Q, mclSize n)
+{
+	cast(c)->addVec(cast(P), cast(Q), n);
+}
+void mclBnPairingProductChecker_addVecMT(mclBnPairingProductChecker *c, const mclBnG1 *P, const mclBnG2 *Q, mclSize n, mclSize cpuN)
+{
+	cast(c)->addVecMT(cast(P), cast(Q), n, cpuN);
+}
+void mclBnPairingProductChecker_addPrecomputed(mclBnPairingProductChecker *c, const mclBnG1 *P, const uint64_t *Qbuf)
+{
+	cast(c)->addPrecomputed(*cast(P), cast(Qbuf));
+}
+int mclBnPairingProductChecker_check(mclBnPairingProductChecker *c)
+{
+	return cast(c)->check();
+}
+
 int mclBn_FrLagrangeInterpolation(mclBnFr *out, const mclBnFr *xVec, const mclBnFr *yVec, mclSize k)
 {
 	bool b;
@@ -38,24 +38,34 @@ void LagrangeInterpolation(bool *pb, G& out, const F *S, const G *vec, size_t k)
 	}
 	/*
 		f(0) = sum_i f(S[i]) delta_{i,S}(0)
+		1/b of N points are computed by F::invVec
 	*/
+	const size_t N = 64;
+	F b[N];
 	G r;
 	r.clear();
-	for (size_t i = 0; i < k; i++) {
-		F b = S[i];
-		for (size_t j = 0; j < k; j++) {
-			if (j != i) {
-				F v = S[j] - S[i];
-				if (v.isZero()) {
-					*pb = false;
-					return;
+	for (size_t pos = 0; pos < k; pos += N) {
+		const size_t m = k - pos < N ? k - pos : N;
+		for (size_t i = 0; i < m; i++) {
+			const F& s = S[pos + i];
+			b[i] = s;
+			for (size_t j = 0; j < k; j++) {
+				if (j != pos + i) {
+					F v = S[j] - s;
+					if (v.isZero()) {
+						*pb = false;
+						return;
+					}
+					b[i] *= v;
 				}
-				b *= v;
 			}
 		}
-		G t;
-		G::mul(t, vec[i], a / b);
-		r += t;
+		F::invVec(b, b, m);
+		for (size_t i = 0; i < m; i++) {
+			G t;
+			G::mul(t, vec[pos + i], a * b[i]);
+			r += t;
+		}
 	}
 	out = r;
 	*pb = true;
@@ -121,6 +121,25 @@ const size_t maxMulVecN = 32; // inner loop of mulVec
 	#define MCL_MAX_MUL_VEC_NGLV 16
 #endif
 const size_t maxMulVecNGLV = MCL_MAX_MUL_VEC_NGLV; // inner loop of mulVec with GLV
+const size_t maxMulEachN = 8; // the num of points processed together in mulEach
+
+/*
+	parameters of 8-lane operations of y^2 = x^3 + b by AVX-512 IFMA (see fp.hpp)
+	n = 0 if they are not available
+*/
+struct EcLanes {
+	static const size_t maxN = 8; // max num of 52-bit limbs
+	size_t n; // num of 52-bit limbs of p
+	size_t opN; // Op::N
+	size_t fpUnitN; // sizeof(Fp) / sizeof(Unit)
+	bool isJacobi;
+	uint64_t rp; // -p^(-1) mod 2^52
+	uint64_t p[maxN];
+	uint64_t b3[maxN]; // 3b
+	uint64_t one[maxN];
+	uint64_t toLanes[maxN]; // from Montgomery form of Op
+	uint64_t fromLanes[maxN]; // to Montgomery form of Op
+};
 
 struct FpGenerator;
 struct Op;
@@ -133,6 +152,7 @@ typedef void (*void2uOp)(Unit*, const Unit*, const Op&);
 typedef void (*void3u)(Unit*, const Unit*, const Unit*);
 typedef void (*void4u)(Unit*, const Unit*, const Unit*, const Unit*);
 typedef int (*int2u)(Unit*, const Unit*);
+typedef int (*int1uOp)(const Unit*, const Op&);
 
 typedef Unit (*u1uII)(Unit*, Unit, Unit);
 typedef Unit (*u3u)(Unit*, const Unit*, const Unit*);
@@ -159,7 +179,13 @@ enum Mode {
 	FP_GMP_MONT,
 	FP_LLVM,
 	FP_LLVM_MONT,
-	FP_XBYAK
+	FP_XBYAK,
+	/*
+		select the fastest of FP_XBYAK, FP_LLVM_MONT and FP_GMP_MONT available on the CPU by measuring them
+		the result for p and the CPU is cached in the file of the environment variable MCL_TUNE_FILE if it is set
+		(secure_getenv is used on glibc)
+	*/
+	FP_TUNE
 };
 
 enum PrimeMode {
@@ -193,6 +219,14 @@ struct Op {
 	Unit one[maxUnitSize];
 	Unit R2[maxUnitSize];
 	Unit R3[maxUnitSize];
+	/*
+		for FpT::squareRoot (set by FpT::init)
+		sqrtExp = (q - 1) / 2 for p - 1 = 2^r q (r = sq.getR())
+		sqrtTbl : s^(-c 2^b) for b in [0, r) and c in [0, 2^sqrtW) as FpT (see FpT::initSquareRoot)
+	*/
+	Unit sqrtExp[maxUnitSize];
+	int sqrtW;
+	mcl::Array<Unit> sqrtTbl;
 #ifdef MCL_USE_XBYAK
 	FpGenerator *fg;
 #endif
@@ -218,6 +252,8 @@ struct Op {
 	void3u fp2Dbl_mulPreA_;
 	void2u fp2Dbl_sqrPreA_;
 	void2u fp2Dbl_mul_xiA_;
+	void3u fp6Dbl_mulPreA_;
+	void3u fp12_mulA_;
 	size_t maxN;
 	size_t N;
 	size_t bitSize;
@@ -232,7 +268,14 @@ struct Op {
 	void3u fp_sqr;
 	void3u fp_mul2;
 	void2uOp fp_invOp;
+	void2uOp fp_invCT; // constant-time fp_invOp (safegcd)
+	int1uOp fp_legendre; // Legendre symbol (x|p) for odd p (0 if p is even)
 	void2uIu fp_mulUnit; // fp_mulUnitPre
+	/*
+		z[i] = x[i] * y[i] for i = 0, ..., n - 1 where the i-th element is [i * next, i * next + N)
+		8 elements are multiplied together by AVX-512 IFMA (0 if not available)
+	*/
+	void (*fp_mulVec)(Unit *z, const Unit *x, const Unit *y, size_t n, size_t next, const Op& op);
 
 	void3u fpDbl_mulPre;
 	void2u fpDbl_sqrPre;
@@ -255,6 +298,7 @@ struct Op {
 	void2u fp2_mul_xiA_;
 	uint32_t (*hash)(void *out, uint32_t maxOutSize, const void *msg, uint32_t msgSize);
 
+	Mode mode; // the mode selected by init
 	PrimeMode primeMode;
 	bool isFullBit; // true if bitSize % unitSize == 0
 	bool isLtQuad; // true if (bitSize % unitSize) <= unitSize - 2
@@ -263,6 +307,9 @@ struct Op {
 
 	Op()
 	{
+#ifdef MCL_USE_XBYAK
+		fg = 0;
+#endif
 		clear();
 	}
 	~Op()
@@ -306,9 +353,12 @@ struct Op {
 		fp2Dbl_mulPreA_ = 0;
 		fp2Dbl_sqrPreA_ = 0;
 		fp2Dbl_mul_xiA_ = 0;
+		fp6Dbl_mulPreA_ = 0;
+		fp12_mulA_ = 0;
 		maxN = 0;
 		N = 0;
 		bitSize = 0;
+		sqrtW = 0;
 		fp_isZero = 0;
 		fp_clear = 0;
 		fp_copy = 0;
@@ -320,7 +370,10 @@ struct Op {
 		fp_sqr = 0;
 		fp_mul2 = 0;
 		fp_invOp = 0;
+		fp_invCT = 0;
+		fp_legendre = 0;
 		fp_mulUnit = 0;
+		fp_mulVec = 0;
 
 		fpDbl_mulPre = 0;
 		fpDbl_sqrPre = 0;
@@ -340,6 +393,7 @@ struct Op {
 		fp2_mul_xiA_ = 0;
 		hash = 0;
 
+		mode = FP_AUTO;
 		primeMode = PM_GENERIC;
 		isFullBit = false;
 		isLtQuad = false;
@@ -8,6 +8,9 @@
 */
 #include <mcl/op.hpp>
 #include <mcl/util.hpp>
+#ifdef MCL_USE_OMP
+#include <omp.h>
+#endif
 #ifdef _MSC_VER
 	#ifndef MCL_FORCE_INLINE
 		#define MCL_FORCE_INLINE __forceinline
@@ -32,9 +35,85 @@ struct AsConstArray {
 	void operator+=(size_t i) { p += i; }
 };
 
+// max byte size of the work area of Operator::invVec
+const size_t invVecWorkByteSize = 16 * 1024;
+
+// the num of interleaved products of invVecWorkLanes
+const size_t invVecLaneN = 8;
+
+/*
+	invVecWork by invVecLaneN interleaved products for T::mulEach
+	the j-th element not in {0, 1} belongs to the (j % invVecLaneN)-th product
+	t[j] = t[j - invVecLaneN] * x[idx[j]], so the products are extended by mulEach of invVecLaneN elements
+*/
+template<class Tout, class Tin, class T>
+size_t invVecWorkLanes(Tout& y, Tin& x, size_t n, T *t)
+{
+	const size_t L = invVecLaneN;
+	uint32_t *idx = (uint32_t*)CYBOZU_ALLOCA(sizeof(uint32_t) * n);
+	bool x_is_equal_y = &x[0] == &y[0];
+	size_t m = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (x[i].isZero() || x[i].isOne()) {
+			if (!x_is_equal_y) y[i] = x[i];
+			continue;
+		}
+		t[m] = x[i];
+		idx[m++] = uint32_t(i);
+	}
+	for (size_t j = L; j < m; j += L) {
+		T::mulEach(t + j, t + j - L, t + j, fp::min_(m - j, L));
+	}
+	if (m == 0) return 0;
+	// inv[k] = 1 / (the last t of the k-th product)
+	const size_t lastN = m - (m - 1) / L * L;
+	const size_t pN = fp::min_(m, L);
+	T inv[L], c[L];
+	for (size_t k = 0; k < pN; k++) {
+		inv[k] = t[k < lastN ? m - lastN + k : m - lastN - L + k];
+	}
+	c[0] = inv[0];
+	for (size_t k = 1; k < pN; k++) {
+		T::mul(c[k], c[k - 1], inv[k]);
+	}
+	T r;
+	T::inv(r, c[pN - 1]);
+	for (size_t k = pN - 1; k > 0; k--) {
+		T::mul(c[k], r, c[k - 1]);
+		r *= inv[k];
+	}
+	c[0] = r;
+	for (size_t k = 0; k < pN; k++) {
+		inv[k] = c[k];
+	}
+	// y[idx[j]] = inv[k] * t[j - L] and inv[k] *= x[idx[j]] for j = b L + k
+	for (size_t b = (m - 1) / L; b > 0; b--) {
+		const size_t j = b * L;
+		const size_t bN = fp::min_(m - j, L);
+		for (size_t k = 0; k < bN; k++) {
+			c[k] = x[idx[j + k]];
+		}
+		T::mulEach(t + j - L, inv, t + j - L, bN);
+		T::mulEach(inv, inv, c, bN);
+		for (size_t k = 0; k < bN; k++) {
+			y[idx[j + k]] = t[j - L + k];
+		}
+	}
+	for (size_t k = 0; k < pN; k++) {
+		y[idx[k]] = inv[k];
+	}
+	return m;
+}
+
+// the min num of elements for invVecWorkLanes
+const size_t invVecLanesMinN = 32;
+
 template<class Tout, class Tin, class T>
 size_t invVecWork(Tout& y, Tin& x, size_t n, T *t)
 {
+	if (T::isMulEachFast() && n >= invVecLanesMinN) {
+		return invVecWorkLanes(y, x, n, t);
+	}
 	size_t pos = 0;
 	for (size_t i = 0; i < n; i++) {
 		if (!(x[i].isZero() || x[i].isOne())) {
@@ -186,8 +265,73 @@ struct Operator : public E {
 	{
 		powArray(z, x, gmp::getUnit(y), gmp::getUnitSize(y), y < 0);
 	}
+	/*
+		z[i] = x[i] * y[i] and y[i] = x[i]^2 for i = 0, ..., n - 1
+		T may hide them by batched versions (see FpT::mulEach)
+	*/
+	static void mulEach(T *z, const T *x, const T *y, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			T::mul(z[i], x[i], y[i]);
+		}
+	}
+	static void sqrEach(T *y, const T *x, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			T::sqr(y[i], x[i]);
+		}
+	}
+	// true if mulEach is faster than n calls of mul
+	static bool isMulEachFast() { return false; }
+	/*
+		y[i] = 1/x[i] for x[i] != 0 else 0 by Montgomery's trick
+		return num of x[i] not in {0, 1}
+		y may be equal to x
+		T may hide it by a faster version (see Fp2T::invVec)
+	*/
+	static size_t invVec(T *y, const T *x, size_t n)
+	{
+		// the work area of invVecT is at most invVecWorkByteSize
+		const size_t N = fp::min_(n, fp::max_<size_t>(mcl::local::invVecWorkByteSize / sizeof(T), 16));
+		mcl::local::AsConstArray<T> in(x);
+		return mcl::invVecT<T>(y, in, n, N);
+	}
+	/*
+		multi thread version of invVec
+		the num of thread is automatically detected if cpuN = 0
+	*/
+	static size_t invVecMT(T *y, const T *x, size_t n, size_t cpuN = 0)
+	{
+#ifdef MCL_USE_OMP
+		// each thread has at least one chunk of invVecT
+		const size_t minN = 256;
+		if (cpuN == 0) {
+			cpuN = omp_get_num_procs();
+			if (n < minN * cpuN) {
+				cpuN = (n + minN - 1) / minN;
+			}
+		}
+		if (cpuN > 1 && n > cpuN) {
+			size_t q = n / cpuN;
+			size_t r = n % cpuN;
+			size_t retNum = 0;
+			#pragma omp parallel for reduction(+:retNum)
+			for (size_t i = 0; i < cpuN; i++) {
+				size_t adj = q * i + fp::min_(i, r);
+				retNum += T::invVec(y + adj, x + adj, q + (i < r));
+			}
+			return retNum;
+		}
+#endif
+		(void)cpuN;
+		return T::invVec(y, x, n);
+	}
+	// true if invVec is faster than the prefix products of n - 1 calls of mul
+	static bool isInvVecFast() { return T::isMulEachFast(); }
 protected:
 	static bool (*powVecGLV)(T& z, const T *xVec, const void *yVec, size_t yn, fp::getMpzAtType getMpzAt, fp::getUnitAtType getUnitAt);
+	static bool (*powVecGLVwork)(T& z, const T *xVec, const void *yVec, size_t yn, fp::getUnitAtType getUnitAt, void *work, size_t workSize);
+	static size_t (*getPowVecGLVworkSize)(size_t n);
 	static void powArray(T& z, const T& x, const Unit *y, size_t yn, bool isNegative = false)
 	{
 		while (yn > 0 && y[yn - 1] == 0) {
@@ -232,6 +376,12 @@ protected:
 template<class T, class E>
 bool (*Operator<T, E>::powVecGLV)(T& z, const T *xVec, const void *yVec, size_t yn, fp::getMpzAtType getMpzAt, fp::getUnitAtType getUnitAt);
 
+template<class T, class E>
+bool (*Operator<T, E>::powVecGLVwork)(T& z, const T *xVec, const void *yVec, size_t yn, fp::getUnitAtType getUnitAt, void *work, size_t workSize);
+
+template<class T, class E>
+size_t (*Operator<T, E>::getPowVecGLVworkSize)(size_t n);
+
 /*
 	T must have save and load
 */
@@ -382,16 +382,6 @@ struct CipherAsArrayOfEc {
 	}
 };
 
-// AsArrayOfFp[i] gets P[i].z
-template<class C>
-struct AsArrayOfFp {
-	typedef typename C::G::Fp Fp;
-	C& c;
-	AsArrayOfFp(C& c) : c(c) {}
-	const Fp& operator[](size_t i) const { return c[i].z; }
-	void operator+=(size_t n) { c += n; }
-};
-
 
 } // mcl::she::local
 
@@ -411,7 +401,8 @@ struct SHET {
 	static std::vector<Fp6> Qcoeff_;
 	static local::HashTable<G1> PhashTbl_;
 	static local::HashTable<G2> QhashTbl_;
-	static mcl::fp::WindowMethod<G2> Qwm_;
+	static FixedBaseMulG1 PbaseMul_; // for xP in PublicKey
+	static FixedBaseMulG2 QbaseMul_; // for yQ in PublicKey
 	typedef local::InterfaceForHashTable<GT, false> GTasEC;
 	static local::HashTable<GT, false> ePQhashTbl_;
 	static bool useDecG1ViaGT_;
@@ -703,6 +694,8 @@ public:
 		hashAndMapToG2(Q_, "0");
 		pairing(ePQ_, P_, Q_);
 		precomputeG2(Qcoeff_, Q_);
+		PbaseMul_.init(P_, Fr::getBitSize());
+		QbaseMul_.init(Q_, Fr::getBitSize());
 		setRangeForDLP(hashSize);
 		useDecG1ViaGT_ = false;
 		useDecG2ViaGT_ = false;
@@ -1517,8 +1510,12 @@ public:
 		};
 		void set(const Fr& x, const Fr& y)
 		{
-			G1::mul(xP_, P_, x);
-			if (!isG1only_) G2::mul(yQ_, Q_, y);
+			if (isG1only_) {
+				G1::mul(xP_, P_, x);
+				return;
+			}
+			PbaseMul_.mul(xP_, x);
+			QbaseMul_.mul(yQ_, y);
 		}
 		template<class INT>
 		void encG1(CipherTextG1& c, const INT& m) const
@@ -2209,6 +2206,8 @@ template<size_t dummyInpl> std::vector<Fp6> SHET<dummyInpl>::Qcoeff_;
 template<size_t dummyInpl> HashTableG1 SHET<dummyInpl>::PhashTbl_;
 template<size_t dummyInpl> HashTableG2 SHET<dummyInpl>::QhashTbl_;
 template<size_t dummyInpl> HashTableGT SHET<dummyInpl>::ePQhashTbl_;
+template<size_t dummyInpl> FixedBaseMulG1 SHET<dummyInpl>::PbaseMul_;
+template<size_t dummyInpl> FixedBaseMulG2 SHET<dummyInpl>::QbaseMul_;
 template<size_t dummyInpl> bool SHET<dummyInpl>::useDecG1ViaGT_;
 template<size_t dummyInpl> bool SHET<dummyInpl>::useDecG2ViaGT_;
 template<size_t dummyInpl> bool SHET<dummyInpl>::isG1only_;
@@ -2285,7 +2284,7 @@ void normalizeVec(SHE::CipherTextAT<G> *v, size_t n)
 	typedef SHE::CipherTextAT<G> Cipher;
 	typedef local::CipherAsArrayOfEc<Cipher> Array;
 	Array arr(v);
-	ec::local::normalizeVecT<typename G::Fp, Array, Array, local::AsArrayOfFp<Array> >(arr, arr, n * 2);
+	ec::local::normalizeVecT<typename G::Fp, Array, Array>(arr, arr, n * 2);
 }
 
 template<class OutputStream, class G>
@@ -61,6 +61,52 @@ T getUnitAt(const T *x, size_t xN, size_t bitPos)
 	return (x[q] >> r) | (x[q + 1] << (TbitSize - r));
 }
 
+/*
+	same as gmp::getNAFwidth for (isNegative ? -x : x) with x = x[0:xN]
+	v = naf[i]
+	v = 0 or (|v| <= 2^(w-1) - 1 and odd)
+*/
+template<class Vec, class T>
+void getNAFwidth(bool *pb, Vec& naf, const T *x, size_t xN, bool isNegative, size_t w)
+{
+	assert(0 < w && w < sizeof(T) * 8);
+	*pb = true;
+	naf.clear();
+	while (xN > 0 && x[xN - 1] == 0) {
+		xN--;
+	}
+	const size_t bitSize = sizeof(T) * 8 * xN;
+	const int signedMaxW = 1 << (w - 1);
+	const int maxW = signedMaxW * 2;
+	const int maskW = maxW - 1;
+	size_t zeroNum = 0;
+	size_t pos = 0;
+	int carry = 0; // (x >> pos) + carry is the remaining value
+	while (pos < bitSize || carry) {
+		int v = int(getUnitAt(x, xN, pos) & T(maskW)) + carry;
+		if ((v & 1) == 0) {
+			// the current bit + carry is 0 or 2, so carry does not change
+			zeroNum++;
+			pos++;
+			continue;
+		}
+		if (v & signedMaxW) {
+			v -= maxW;
+			carry = 1;
+		} else {
+			carry = 0;
+		}
+		for (size_t i = 0; i < zeroNum; i++) {
+			naf.push(pb, 0);
+			if (!*pb) return;
+		}
+		naf.push(pb, typename Vec::value_type(isNegative ? -v : v));
+		if (!*pb) return;
+		zeroNum = w - 1;
+		pos += w;
+	}
+}
+
 template<class T>
 class BitIterator {
 	const T *x_;
@@ -115,5 +115,206 @@ public:
 	}
 };
 
+namespace local {
+
+// GLV interface of FixedBaseMul for a curve without an endomorphism
+template<class Ec>
+struct NoGLV {
+	static const int splitN = 1;
+	static const size_t splitUnitN = maxUnitSize;
+	static void mulLambda(Ec& Q, const Ec& P) { Q = P; }
+	static size_t getSplitMaxBitSize() { return maxUnitSize * UnitBitSize; }
+	static void splitUnit(bool isNeg[1], Unit u[1][splitUnitN], const Unit *x, size_t xn)
+	{
+		assert(xn <= splitUnitN);
+		isNeg[0] = false;
+		for (size_t i = 0; i < splitUnitN; i++) {
+			u[0][i] = i < xn ? x[i] : 0;
+		}
+	}
+};
+
+} // mcl::fp::local
+
+/*
+	fixed-base multiplication by Lim-Lee comb method
+	a scalar (or each sub-scalar u[j] split by GLV) of maxBit bits is split into
+	h rows of a = v b bits and each row into v blocks of b bits
+	tbl_[k (2^h - 1) + i - 1] = sum_{s ; bit s of i is 1} 2^(s a + k b) P for 0 < i < 2^h
+	z[j] = u[j] P is computed by the comb with b - 1 doublings and v b mixed additions at most
+	and sum_j L^j z[j] by Horner's method (L is the endomorphism of GLV),
+	so all sub-scalars share the table of v (2^h - 1) affine points
+	WindowMethod(P, bitSize, h) is the same as FixedBaseMul<Ec>(P, bitSize, h, ceil(bitSize / h)) with b = 1
+*/
+template<class Ec, class GLV = local::NoGLV<Ec> >
+class FixedBaseMul {
+	static const int splitN = GLV::splitN;
+	Ec P_;
+	size_t h_;
+	size_t v_;
+	size_t a_;
+	size_t b_;
+	mcl::Array<Ec> tbl_;
+	// z = x P_ for the scalars which do not fit the table
+	void mulGeneric(Ec& z, const Unit *y, size_t yn, bool isNegative) const
+	{
+		mpz_class t;
+		bool b;
+		gmp::setArray(&b, t, y, yn);
+		assert(b); (void)b;
+		if (isNegative) t = -t;
+		Ec::mul(z, P_, t);
+	}
+public:
+	FixedBaseMul()
+		: h_(0)
+		, v_(0)
+		, a_(0)
+		, b_(0)
+	{
+	}
+	FixedBaseMul(const Ec& P, size_t bitSize, size_t h = 0, size_t v = 2)
+	{
+		init(P, bitSize, h, v);
+	}
+	/*
+		@param P [in] base point
+		@param bitSize [in] max bit size of scalars (the bit size of sub-scalars is used for GLV)
+		@param h [in] the num of rows (1 <= h <= 16), the table has about 1024 points if h = 0
+		@param v [in] the num of blocks in a row
+	*/
+	void init(bool *pb, const Ec& P, size_t bitSize, size_t h = 0, size_t v = 2)
+	{
+		size_t maxBit = bitSize;
+		maxBit = fp::min_(maxBit, GLV::getSplitMaxBitSize());
+		if (h == 0 && v > 0) {
+			h = 1;
+			while (h < 16 && v << (h + 1) <= 1024) h++;
+		}
+		if (maxBit == 0 || h == 0 || h > 16 || v == 0) {
+			*pb = false;
+			return;
+		}
+		const size_t b = (maxBit + h * v - 1) / (h * v);
+		const size_t a = v * b;
+		const size_t tblN = (size_t(1) << h) - 1;
+		*pb = tbl_.resize(v * tblN);
+		if (!*pb) return;
+		P_ = P;
+		h_ = h;
+		v_ = v;
+		a_ = a;
+		b_ = b;
+		Ec *tbl = tbl_.data();
+		Ec Pk = P; // 2^(k b) P
+		for (size_t k = 0; k < v; k++) {
+			Ec *w = tbl + k * tblN;
+			Ec t = Pk; // 2^(s a + k b) P
+			for (size_t s = 0; s < h; s++) {
+				const size_t d = size_t(1) << s;
+				w[d - 1] = t;
+				for (size_t i = 1; i < d; i++) {
+					Ec::add(w[d + i - 1], w[i - 1], t);
+				}
+				for (size_t i = 0; i < a; i++) {
+					Ec::dbl(t, t);
+				}
+			}
+			for (size_t i = 0; i < b; i++) {
+				Ec::dbl(Pk, Pk);
+			}
+		}
+		Ec::normalizeVec(tbl, tbl, v * tblN);
+	}
+#ifndef CYBOZU_DONT_USE_EXCEPTION
+	void init(const Ec& P, size_t bitSize, size_t h = 0, size_t v = 2)
+	{
+		bool b;
+		init(&b, P, bitSize, h, v);
+		if (!b) throw cybozu::Exception("mcl:FixedBaseMul:init") << bitSize << h << v;
+	}
+#endif
+	size_t getTableSize() const { return tbl_.size(); }
+	/*
+		@param z [out] P multiplied by y
+		@param y [in] exponent
+	*/
+	template<class tag2, size_t maxBitSize2, template<class tag2_, size_t maxBitSize2_> class FpT>
+	void mul(Ec& z, const FpT<tag2, maxBitSize2>& y) const
+	{
+		fp::Block b;
+		y.getBlock(b);
+		mulArray(z, b.p, b.n, false);
+	}
+	void mul(Ec& z, int64_t y) const
+	{
+#if MCL_SIZEOF_UNIT == 8
+		Unit u = fp::abs_(y);
+		mulArray(z, &u, 1, y < 0);
+#else
+		uint64_t ua = fp::abs_(y);
+		Unit u[2] = { uint32_t(ua), uint32_t(ua >> 32) };
+		mulArray(z, u, 2, y < 0);
+#endif
+	}
+	void mul(Ec& z, const mpz_class& y) const
+	{
+		mulArray(z, gmp::getUnit(y), gmp::getUnitSize(y), y < 0);
+	}
+	void mulArray(Ec& z, const Unit *y, size_t yn, bool isNegative) const
+	{
+		while (yn > 0 && y[yn - 1] == 0) {
+			yn--;
+		}
+		if (yn > maxUnitSize) {
+			mulGeneric(z, y, yn, isNegative);
+			return;
+		}
+		const size_t N = GLV::splitUnitN;
+		Unit u[splitN][N];
+		bool isNeg[splitN];
+		GLV::splitUnit(isNeg, u, y, yn);
+		for (int j = 0; j < splitN; j++) {
+			if (BitIterator<Unit>(u[j], N).getBitSize() > h_ * a_) {
+				mulGeneric(z, y, yn, isNegative);
+				return;
+			}
+		}
+		const size_t tblN = (size_t(1) << h_) - 1;
+		const Ec *tbl = tbl_.data();
+		Ec zs[splitN];
+		for (int j = 0; j < splitN; j++) {
+			zs[j].clear();
+		}
+		for (size_t i = 0; i < b_; i++) {
+			const size_t pos = b_ - 1 - i;
+			for (int j = 0; j < splitN; j++) {
+				if (i > 0) Ec::dbl(zs[j], zs[j]);
+				for (size_t k = 0; k < v_; k++) {
+					size_t idx = 0;
+					for (size_t s = 0; s < h_; s++) {
+						idx |= size_t(getUnitAt(u[j], N, s * a_ + k * b_ + pos) & 1) << s;
+					}
+					if (idx == 0) continue;
+					const Ec& Q = tbl[k * tblN + idx - 1];
+					if (isNeg[j]) {
+						Ec::sub(zs[j], zs[j], Q);
+					} else {
+						Ec::add(zs[j], zs[j], Q);
+					}
+				}
+			}
+		}
+		z = zs[splitN - 1];
+		for (int j = splitN - 2; j >= 0; j--) {
+			GLV::mulLambda(z, z);
+			Ec::add(z, z, zs[j]);
+		}
+		if (isNegative) {
+			Ec::neg(z, z);
+		}
+	}
+};
+
 } } // mcl::fp
 
@@ -104,11 +104,13 @@ void KeyCheck(const std::vector<G2>& pk_list, const std::vector<G1>& pi_list, co
 		G2 pk = pk_list[i];
 		G1 pi = pi_list[i];
 		G1 Hpk;
-		Fp12 e1, e2;
 		Hash_pk(Hpk, pk);
-		pairing(e1, pi, Q); // e1 = e(sigma, Q)
-		pairing(e2, Hpk, pk); // e2 = e(Hm, sQ)
-		if(e1 != e2){
+		G1::neg(Hpk, Hpk);
+		// e(pi, Q) == e(Hpk, sQ)
+		PairingProductChecker checker;
+		checker.add(pi, Q);
+		checker.add(Hpk, pk);
+		if(!checker.check()){
 			printf("Error: Proof of possession check is faild.");
 			std::exit(0);
 		}
@@ -125,16 +127,14 @@ void AggKey(G2& pk_agg, const std::vector<G2>& pk_list){
 
 bool Verify(const G1& sigma, const std::string& h, const G2& Q, const G2& pk, const std::string& m)
 {
-	Fp12 e1, e2;
 	G1 Hm;
 	Hash_2(Hm, m + h);
-	pairing(e1, sigma, Q); // e1 = e(sigma, Q)
-	pairing(e2, Hm, pk); // e2 = e(Hm, sQ)
-	// for debug
-	// std::cout << "e1. " << e1 << std::endl;
-	// std::cout << "e2. " << e2 << std::endl;
-
-	return e1 == e2;
+	G1::neg(Hm, Hm);
+	// e(sigma, Q) == e(Hm, sQ) <=> e(sigma, Q) e(-Hm, sQ) == 1
+	PairingProductChecker checker;
+	checker.add(sigma, Q);
+	checker.add(Hm, pk);
+	return checker.check();
 }
 
 int main()
@@ -548,6 +548,67 @@ MCL_DLL_API size_t div(Unit *q, size_t qn, Unit *x, size_t xn, const Unit *y, si
 	}
 }
 
+namespace impl {
+
+// Jacobi symbol (x|y) * t for odd y
+inline int jacobi1(Unit x, Unit y, int t)
+{
+	while (x) {
+		const int s = cybozu::bsf(x);
+		x >>= s;
+		if ((s & 1) && ((y & 7) == 3 || (y & 7) == 5)) t = -t;
+		if (x < y) {
+			if (x & y & 2) t = -t;
+			fp::swap_(x, y);
+		}
+		x -= y;
+	}
+	return y == 1 ? t : 0;
+}
+
+} // impl
+
+/*
+	binary algorithm
+	(x|y) = (2|y)^s (x/2^s|y) and (2|y) = -1 iff y = 3, 5 mod 8
+	(x|y) = (y|x) * (-1 if x = y = 3 mod 4) for odd x and y
+	(x|y) = (x - y|y)
+*/
+MCL_DLL_API int jacobi(const Unit *x, size_t xn, const Unit *y, size_t yn)
+{
+	assert(yn > 0 && (y[0] & 1));
+	const size_t n = fp::max_(xn, yn);
+	Unit *a = (Unit*)CYBOZU_ALLOCA(sizeof(Unit) * n * 2);
+	Unit *b = a + n;
+	copyN(a, x, xn);
+	clearN(a + xn, n - xn);
+	copyN(b, y, yn);
+	clearN(b + yn, n - yn);
+	size_t an = getRealSize(a, n);
+	size_t bn = getRealSize(b, n);
+	int t = 1;
+	while (an > 1 || bn > 1) {
+		if (an == 1 && a[0] == 0) return 0;
+		size_t s = 0;
+		while (a[s / UnitBitSize] == 0) s += UnitBitSize;
+		s += cybozu::bsf(a[s / UnitBitSize]);
+		if (s) {
+			an = getRealSize(a, shiftRight(a, a, s, an));
+			if ((s & 1) && ((b[0] & 7) == 3 || (b[0] & 7) == 5)) t = -t;
+		}
+		if (an < bn || (an == bn && cmpLtN(a, b, an))) {
+			if (a[0] & b[0] & 2) t = -t;
+			fp::swap_(a, b);
+			fp::swap_(an, bn);
+		}
+		// an >= bn and a >= b
+		Unit c = subN(a, a, b, bn);
+		if (an > bn) subUnit(a + bn, an - bn, c);
+		an = getRealSize(a, an);
+	}
+	return impl::jacobi1(a[0], b[0], t);
+}
+
 #include "bint_switch.hpp"
 
 MCL_DLL_API void mulNM(Unit *z, const Unit *x, size_t xn, const Unit *y, size_t yn)
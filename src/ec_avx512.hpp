@@ -0,0 +1,595 @@
+#pragma once
+/**
+	@file
+	@brief 8-lane Fp multiplication and point operations of y^2 = x^3 + b by AVX-512 IFMA
+	@author MITSUNARI Shigeo(@herumi)
+	@license modified new BSD license
+	http://opensource.org/licenses/BSD-3-Clause
+*/
+/*
+	an element of Fp is represented by n 52-bit limbs in Montgomery form with R' = 2^(52n)
+	and a Vec holds the same limb of 8 elements
+	points are in projective coordinates and added by the complete formulas of
+	Renes-Costello-Batina (Algorithm 7 and 9 of https://eprint.iacr.org/2015/1060)
+	so the 8 lanes run without branches
+*/
+#include <immintrin.h>
+
+#define MCL_AVX512_FUNC __attribute__((target("avx512f,avx512ifma")))
+
+namespace mcl { namespace fp { namespace avx512 {
+
+typedef __m512i Vec;
+const size_t laneN = 8;
+const int limbBit = 52;
+const uint64_t limbMask = (uint64_t(1) << limbBit) - 1;
+
+template<size_t N>
+struct FpM {
+	Vec v[N];
+};
+
+template<size_t N>
+struct EcM {
+	FpM<N> x, y, z;
+};
+
+// broadcast parameters of Fp
+template<size_t N>
+struct ParamFp {
+	Vec p[N];
+	Vec rp;
+	Vec mask;
+};
+
+// broadcast parameters of EcLanes
+template<size_t N>
+struct Param : ParamFp<N> {
+	FpM<N> b3;
+	FpM<N> one;
+	FpM<N> toLanes;
+	FpM<N> fromLanes;
+};
+
+MCL_AVX512_FUNC inline void setFpM(Vec *y, const uint64_t *x, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		y[i] = _mm512_set1_epi64(x[i]);
+	}
+}
+
+template<size_t N>
+MCL_AVX512_FUNC void initParam(Param<N>& P, const EcLanes& lanes)
+{
+	setFpM(P.p, lanes.p, N);
+	P.rp = _mm512_set1_epi64(lanes.rp);
+	P.mask = _mm512_set1_epi64(limbMask);
+	setFpM(P.b3.v, lanes.b3, N);
+	setFpM(P.one.v, lanes.one, N);
+	setFpM(P.toLanes.v, lanes.toLanes, N);
+	setFpM(P.fromLanes.v, lanes.fromLanes, N);
+}
+
+/*
+	use the maskz version of shifts because _mm512_srli_epi64 of gcc-12
+	causes -Wuninitialized by _mm512_undefined_epi32
+*/
+MCL_AVX512_FUNC inline Vec shr52(const Vec& x)
+{
+	return _mm512_maskz_srli_epi64(0xff, x, limbBit);
+}
+
+MCL_AVX512_FUNC inline Vec sar52(const Vec& x)
+{
+	return _mm512_maskz_srai_epi64(0xff, x, limbBit);
+}
+
+MCL_AVX512_FUNC inline Vec shl(const Vec& x, int n)
+{
+	return _mm512_maskz_sllv_epi64(0xff, x, _mm512_set1_epi64(n));
+}
+
+MCL_AVX512_FUNC inline Vec shr(const Vec& x, int n)
+{
+	return _mm512_maskz_srlv_epi64(0xff, x, _mm512_set1_epi64(n));
+}
+
+// propagate carries of nonnegative limbs
+template<size_t N>
+MCL_AVX512_FUNC inline void normalizeU(Vec *t, const ParamFp<N>& P)
+{
+	for (size_t i = 0; i < N - 1; i++) {
+		t[i + 1] = _mm512_add_epi64(t[i + 1], shr52(t[i]));
+		t[i] = _mm512_and_si512(t[i], P.mask);
+	}
+}
+
+// propagate carries of signed limbs, the sign is kept in t[N - 1]
+template<size_t N>
+MCL_AVX512_FUNC inline void normalizeS(Vec *t, const ParamFp<N>& P)
+{
+	for (size_t i = 0; i < N - 1; i++) {
+		t[i + 1] = _mm512_add_epi64(t[i + 1], sar52(t[i]));
+		t[i] = _mm512_and_si512(t[i], P.mask);
+	}
+}
+
+// z = t < p ? t : t - p for normalized t < 2p
+template<size_t N>
+MCL_AVX512_FUNC inline void condSubP(FpM<N>& z, const Vec *t, const ParamFp<N>& P)
+{
+	Vec u[N];
+	for (size_t i = 0; i < N; i++) {
+		u[i] = _mm512_sub_epi64(t[i], P.p[i]);
+	}
+	normalizeS<N>(u, P);
+	const __mmask8 c = _mm512_cmpge_epi64_mask(u[N - 1], _mm512_setzero_si512());
+	for (size_t i = 0; i < N; i++) {
+		z.v[i] = _mm512_mask_mov_epi64(t[i], c, u[i]);
+	}
+}
+
+template<size_t N>
+MCL_AVX512_FUNC inline void add(FpM<N>& z, const FpM<N>& x, const FpM<N>& y, const ParamFp<N>& P)
+{
+	Vec t[N];
+	for (size_t i = 0; i < N; i++) {
+		t[i] = _mm512_add_epi64(x.v[i], y.v[i]);
+	}
+	normalizeU<N>(t, P);
+	condSubP<N>(z, t, P);
+}
+
+template<size_t N>
+MCL_AVX512_FUNC inline void sub(FpM<N>& z, const FpM<N>& x, const FpM<N>& y, const ParamFp<N>& P)
+{
+	Vec t[N], u[N];
+	for (size_t i = 0; i < N; i++) {
+		t[i] = _mm512_sub_epi64(x.v[i], y.v[i]);
+	}
+	normalizeS<N>(t, P);
+	const __mmask8 c = _mm512_cmplt_epi64_mask(t[N - 1], _mm512_setzero_si512());
+	for (size_t i = 0; i < N; i++) {
+		u[i] = _mm512_add_epi64(t[i], P.p[i]);
+	}
+	normalizeS<N>(u, P);
+	for (size_t i = 0; i < N; i++) {
+		z.v[i] = _mm512_mask_mov_epi64(t[i], c, u[i]);
+	}
+}
+
+/*
+	z = xy/R' mod p by operand scanning
+	each limb of t has 12-bit room for the carries of 4n products
+*/
+template<size_t N>
+MCL_AVX512_FUNC inline void mul(FpM<N>& z, const FpM<N>& x, const FpM<N>& y, const ParamFp<N>& P)
+{
+	const Vec zero = _mm512_setzero_si512();
+	Vec t[N + 1];
+	for (size_t i = 0; i < N + 1; i++) {
+		t[i] = zero;
+	}
+	for (size_t i = 0; i < N; i++) {
+		const Vec yi = y.v[i];
+		for (size_t j = 0; j < N; j++) {
+			t[j] = _mm512_madd52lo_epu64(t[j], x.v[j], yi);
+			t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], x.v[j], yi);
+		}
+		const Vec q = _mm512_madd52lo_epu64(zero, t[0], P.rp);
+		for (size_t j = 0; j < N; j++) {
+			t[j] = _mm512_madd52lo_epu64(t[j], P.p[j], q);
+			t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], P.p[j], q);
+		}
+		t[1] = _mm512_add_epi64(t[1], shr52(t[0]));
+		for (size_t j = 0; j < N; j++) {
+			t[j] = t[j + 1];
+		}
+		t[N] = zero;
+	}
+	normalizeU<N>(t, P);
+	condSubP<N>(z, t, P);
+}
+
+template<size_t N>
+MCL_AVX512_FUNC inline __mmask8 isZero(const FpM<N>& x)
+{
+	Vec t = x.v[0];
+	for (size_t i = 1; i < N; i++) {
+		t = _mm512_or_si512(t, x.v[i]);
+	}
+	return _mm512_cmpeq_epi64_mask(t, _mm512_setzero_si512());
+}
+
+template<size_t N>
+MCL_AVX512_FUNC inline void select(FpM<N>& z, __mmask8 c, const FpM<N>& x)
+{
+	for (size_t i = 0; i < N; i++) {
+		z.v[i] = _mm512_mask_mov_epi64(z.v[i], c, x.v[i]);
+	}
+}
+
+template<size_t N>
+MCL_AVX512_FUNC inline void clear(EcM<N>& P, const Param<N>& prm)
+{
+	for (size_t i = 0; i < N; i++) {
+		P.x.v[i] = _mm512_setzero_si512();
+		P.z.v[i] = _mm512_setzero_si512();
+	}
+	P.y = prm.one;
+}
+
+// Algorithm 7 (a = 0, 12M + 2m_3b)
+template<size_t N>
+MCL_AVX512_FUNC inline void addEc(EcM<N>& R, const EcM<N>& P1, const EcM<N>& P2, const Param<N>& P)
+{
+	FpM<N> t0, t1, t2, t3, t4, x3, y3, z3;
+	mul(t0, P1.x, P2.x, P);
+	mul(t1, P1.y, P2.y, P);
+	mul(t2, P1.z, P2.z, P);
+	add(t3, P1.x, P1.y, P);
+	add(t4, P2.x, P2.y, P);
+	mul(t3, t3, t4, P);
+	add(t4, t0, t1, P);
+	sub(t3, t3, t4, P);
+	add(t4, P1.y, P1.z, P);
+	add(x3, P2.y, P2.z, P);
+	mul(t4, t4, x3, P);
+	add(x3, t1, t2, P);
+	sub(t4, t4, x3, P);
+	add(x3, P1.x, P1.z, P);
+	add(y3, P2.x, P2.z, P);
+	mul(x3, x3, y3, P);
+	add(y3, t0, t2, P);
+	sub(y3, x3, y3, P);
+	add(x3, t0, t0, P);
+	add(t0, x3, t0, P);
+	mul(t2, t2, P.b3, P);
+	add(z3, t1, t2, P);
+	sub(t1, t1, t2, P);
+	mul(y3, y3, P.b3, P);
+	mul(x3, t4, y3, P);
+	mul(t2, t3, t1, P);
+	sub(R.x, t2, x3, P);
+	mul(y3, y3, t0, P);
+	mul(t1, t1, z3, P);
+	add(R.y, t1, y3, P);
+	mul(t0, t0, t3, P);
+	mul(z3, z3, t4, P);
+	add(R.z, z3, t0, P);
+}
+
+// Algorithm 9 (a = 0, 6M + 2S + 1m_3b)
+template<size_t N>
+MCL_AVX512_FUNC inline void dblEc(EcM<N>& R, const EcM<N>& P1, const Param<N>& P)
+{
+	FpM<N> t0, t1, t2, t3, x3, y3, z3;
+	mul(t3, P1.x, P1.y, P);
+	mul(t0, P1.y, P1.y, P);
+	add(z3, t0, t0, P);
+	add(z3, z3, z3, P);
+	add(z3, z3, z3, P);
+	mul(t1, P1.y, P1.z, P);
+	mul(t2, P1.z, P1.z, P);
+	mul(t2, t2, P.b3, P);
+	mul(x3, t2, z3, P);
+	add(y3, t0, t2, P);
+	mul(R.z, t1, z3, P);
+	add(t1, t2, t2, P);
+	add(t2, t1, t2, P);
+	sub(t0, t0, t2, P);
+	mul(y3, t0, y3, P);
+	add(R.y, x3, y3, P);
+	mul(x3, t0, t3, P);
+	add(R.x, x3, x3, P);
+}
+
+// y[0:n] = 52-bit limbs of x[0:xn]
+inline void toLimb52(uint64_t *y, size_t n, const Unit *x, size_t xn)
+{
+	for (size_t i = 0; i < n; i++) {
+		const size_t q = (i * limbBit) / 64;
+		const size_t r = (i * limbBit) % 64;
+		uint64_t v = q < xn ? x[q] >> r : 0;
+		if (r > 64 - limbBit && q + 1 < xn) v |= x[q + 1] << (64 - r);
+		y[i] = v & limbMask;
+	}
+}
+
+// y[0:yn] = x[0:n] of 52-bit limbs
+inline void fromLimb52(Unit *y, size_t yn, const uint64_t *x, size_t n)
+{
+	for (size_t i = 0; i < yn; i++) {
+		y[i] = 0;
+	}
+	for (size_t i = 0; i < n; i++) {
+		const size_t q = (i * limbBit) / 64;
+		const size_t r = (i * limbBit) % 64;
+		if (q < yn) y[q] |= x[i] << r;
+		if (r > 64 - limbBit && q + 1 < yn) y[q + 1] |= x[i] >> (64 - r);
+	}
+}
+
+// load the idx-th coordinate of x[0:m] as Fp of Op to lanes
+template<size_t N>
+MCL_AVX512_FUNC void loadFp(FpM<N>& y, const Unit *x, size_t m, size_t idx, const EcLanes& lanes, const Param<N>& P)
+{
+	uint64_t buf[N][laneN] = {};
+	uint64_t t[N];
+	const size_t pointUnitN = lanes.fpUnitN * 3;
+	for (size_t i = 0; i < m; i++) {
+		toLimb52(t, N, x + pointUnitN * i + lanes.fpUnitN * idx, lanes.opN);
+		for (size_t j = 0; j < N; j++) {
+			buf[j][i] = t[j];
+		}
+	}
+	for (size_t j = 0; j < N; j++) {
+		y.v[j] = _mm512_loadu_si512(buf[j]);
+	}
+	mul(y, y, P.toLanes, P);
+}
+
+template<size_t N>
+MCL_AVX512_FUNC void storeFp(Unit *y, size_t m, size_t idx, const FpM<N>& x, const EcLanes& lanes, const Param<N>& P)
+{
+	uint64_t buf[N][laneN];
+	uint64_t t[N];
+	FpM<N> v;
+	mul(v, x, P.fromLanes, P);
+	for (size_t j = 0; j < N; j++) {
+		_mm512_storeu_si512(buf[j], v.v[j]);
+	}
+	const size_t pointUnitN = lanes.fpUnitN * 3;
+	for (size_t i = 0; i < m; i++) {
+		for (size_t j = 0; j < N; j++) {
+			t[j] = buf[j][i];
+		}
+		fromLimb52(y + pointUnitN * i + lanes.fpUnitN * idx, lanes.opN, t, N);
+	}
+}
+
+/*
+	load x[0:m] (m <= 8) to projective coordinates
+	(X, Y, Z) of Jacobi is converted to (XZ, Y, Z^3)
+	zero points and the lanes of i >= m are set to (0, 1, 0)
+*/
+template<size_t N>
+MCL_AVX512_FUNC void loadEc(EcM<N>& y, const Unit *x, size_t m, const EcLanes& lanes, const Param<N>& P)
+{
+	loadFp(y.x, x, m, 0, lanes, P);
+	loadFp(y.y, x, m, 1, lanes, P);
+	loadFp(y.z, x, m, 2, lanes, P);
+	if (lanes.isJacobi) {
+		FpM<N> t;
+		mul(y.x, y.x, y.z, P);
+		mul(t, y.z, y.z, P);
+		mul(y.z, t, y.z, P);
+	}
+	EcM<N> zero;
+	clear(zero, P);
+	const __mmask8 c = isZero(y.z);
+	select(y.x, c, zero.x);
+	select(y.y, c, zero.y);
+}
+
+// (X, Y, Z) of projective coordinates is converted to (XZ, YZ^2, Z) of Jacobi
+template<size_t N>
+MCL_AVX512_FUNC void storeEc(Unit *y, size_t m, const EcM<N>& x, const EcLanes& lanes, const Param<N>& P)
+{
+	if (lanes.isJacobi) {
+		FpM<N> t, u;
+		mul(t, x.x, x.z, P);
+		storeFp(y, m, 0, t, lanes, P);
+		mul(t, x.z, x.z, P);
+		mul(u, x.y, t, P);
+		storeFp(y, m, 1, u, lanes, P);
+	} else {
+		storeFp(y, m, 0, x.x, lanes, P);
+		storeFp(y, m, 1, x.y, lanes, P);
+	}
+	storeFp(y, m, 2, x.z, lanes, P);
+}
+
+template<size_t N>
+MCL_AVX512_FUNC void addEachT(const EcLanes& lanes, Unit *z, const Unit *x, const Unit *y, size_t n)
+{
+	Param<N> P;
+	initParam(P, lanes);
+	const size_t pointUnitN = lanes.fpUnitN * 3;
+	for (size_t pos = 0; pos < n; pos += laneN) {
+		const size_t m = fp::min_(n - pos, laneN);
+		EcM<N> X, Y;
+		loadEc(X, x + pos * pointUnitN, m, lanes, P);
+		loadEc(Y, y + pos * pointUnitN, m, lanes, P);
+		addEc(X, X, Y, P);
+		storeEc(z + pos * pointUnitN, m, X, lanes, P);
+	}
+}
+
+template<size_t N>
+MCL_AVX512_FUNC void dblEachT(const EcLanes& lanes, Unit *z, const Unit *x, size_t n)
+{
+	Param<N> P;
+	initParam(P, lanes);
+	const size_t pointUnitN = lanes.fpUnitN * 3;
+	for (size_t pos = 0; pos < n; pos += laneN) {
+		const size_t m = fp::min_(n - pos, laneN);
+		EcM<N> X;
+		loadEc(X, x + pos * pointUnitN, m, lanes, P);
+		dblEc(X, X, P);
+		storeEc(z + pos * pointUnitN, m, X, lanes, P);
+	}
+}
+
+/*
+	fixed 4-bit window method on 8 lanes
+	the table entry of each lane is selected by masks
+*/
+template<size_t N>
+MCL_AVX512_FUNC void mulEachT(const EcLanes& lanes, Unit *z, const Unit *x, const void *yVec, size_t n, getUnitAtType getUnitAt)
+{
+	const size_t w = 4;
+	const size_t tblN = size_t(1) << w;
+	Param<N> P;
+	initParam(P, lanes);
+	const size_t pointUnitN = lanes.fpUnitN * 3;
+	Unit y[laneN][maxUnitSize];
+	EcM<N> tbl[tblN];
+	for (size_t pos = 0; pos < n; pos += laneN) {
+		const size_t m = fp::min_(n - pos, laneN);
+		size_t maxBit = 0;
+		for (size_t i = 0; i < laneN; i++) {
+			bint::clearN(y[i], maxUnitSize);
+			if (i >= m) continue;
+			getUnitAt(y[i], yVec, pos + i);
+			const size_t bitSize = BitIterator<Unit>(y[i], maxUnitSize).getBitSize();
+			if (bitSize > maxBit) maxBit = bitSize;
+		}
+		clear(tbl[0], P);
+		loadEc(tbl[1], x + pos * pointUnitN, m, lanes, P);
+		for (size_t i = 2; i < tblN; i++) {
+			addEc(tbl[i], tbl[i - 1], tbl[1], P);
+		}
+		EcM<N> Q;
+		clear(Q, P);
+		const size_t winN = (maxBit + w - 1) / w;
+		for (size_t i = 0; i < winN; i++) {
+			const size_t bitPos = (winN - 1 - i) * w;
+			if (i > 0) {
+				for (size_t j = 0; j < w; j++) {
+					dblEc(Q, Q, P);
+				}
+			}
+			uint64_t d[laneN];
+			for (size_t j = 0; j < laneN; j++) {
+				d[j] = mcl::fp::getUnitAt(y[j], maxUnitSize, bitPos) & (tblN - 1);
+			}
+			const Vec idx = _mm512_loadu_si512(d);
+			EcM<N> T = tbl[0];
+			for (size_t k = 1; k < tblN; k++) {
+				const __mmask8 c = _mm512_cmpeq_epi64_mask(idx, _mm512_set1_epi64(k));
+				select(T.x, c, tbl[k].x);
+				select(T.y, c, tbl[k].y);
+				select(T.z, c, tbl[k].z);
+			}
+			addEc(Q, Q, T, P);
+		}
+		storeEc(z + pos * pointUnitN, m, Q, lanes, P);
+	}
+}
+
+/*
+	Montgomery multiplication of Fp of Op with R = 2^(64U) instead of R' = 2^(52N)
+	so the values of Op are used without the conversion of toLanes and fromLanes
+	64U = 52(N - 1) + S (0 < S <= 52)
+	the first N - 1 rounds reduce 52 bits and the last round reduces S bits
+*/
+template<size_t U>
+struct MulVec {
+	static const size_t N = (U * 64 + limbBit - 1) / limbBit;
+	static const int S = int(U * 64 - (N - 1) * limbBit);
+
+	// x[0:N] = the 52-bit limbs of w[0:U]
+	static MCL_AVX512_FUNC inline void toLimb(FpM<N>& x, const Vec *w, const Vec& mask)
+	{
+		for (size_t i = 0; i < N; i++) {
+			const size_t q = (i * limbBit) / 64;
+			const int r = int((i * limbBit) % 64);
+			Vec v = shr(w[q], r);
+			if (r > 64 - limbBit && q + 1 < U) {
+				v = _mm512_or_si512(v, shl(w[q + 1], 64 - r));
+			}
+			x.v[i] = _mm512_and_si512(v, mask);
+		}
+	}
+	// w[0:U] = x[0:N] of 52-bit limbs
+	static MCL_AVX512_FUNC inline void fromLimb(Vec *w, const FpM<N>& x)
+	{
+		for (size_t j = 0; j < U; j++) {
+			w[j] = _mm512_setzero_si512();
+		}
+		for (size_t i = 0; i < N; i++) {
+			const size_t q = (i * limbBit) / 64;
+			const int r = int((i * limbBit) % 64);
+			w[q] = _mm512_or_si512(w[q], shl(x.v[i], r));
+			if (r > 64 - limbBit && q + 1 < U) {
+				w[q + 1] = _mm512_or_si512(w[q + 1], shr(x.v[i], 64 - r));
+			}
+		}
+	}
+	static MCL_AVX512_FUNC inline void mulR(FpM<N>& z, const FpM<N>& x, const FpM<N>& y, const ParamFp<N>& P)
+	{
+		const Vec zero = _mm512_setzero_si512();
+		Vec t[N + 1];
+		for (size_t i = 0; i < N + 1; i++) {
+			t[i] = zero;
+		}
+		for (size_t i = 0; i < N; i++) {
+			const Vec yi = y.v[i];
+			for (size_t j = 0; j < N; j++) {
+				t[j] = _mm512_madd52lo_epu64(t[j], x.v[j], yi);
+				t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], x.v[j], yi);
+			}
+			Vec q = _mm512_madd52lo_epu64(zero, t[0], P.rp);
+			if (i == N - 1) {
+				q = _mm512_and_si512(q, _mm512_set1_epi64((uint64_t(1) << S) - 1));
+			}
+			for (size_t j = 0; j < N; j++) {
+				t[j] = _mm512_madd52lo_epu64(t[j], P.p[j], q);
+				t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], P.p[j], q);
+			}
+			if (i == N - 1) break;
+			t[1] = _mm512_add_epi64(t[1], shr52(t[0]));
+			for (size_t j = 0; j < N; j++) {
+				t[j] = t[j + 1];
+			}
+			t[N] = zero;
+		}
+		// t[0:N+1] is divisible by 2^S and t / 2^S < 2p
+		for (size_t i = 0; i < N; i++) {
+			t[i + 1] = _mm512_add_epi64(t[i + 1], shr52(t[i]));
+			t[i] = _mm512_and_si512(t[i], P.mask);
+		}
+		for (size_t i = 0; i < N; i++) {
+			t[i] = _mm512_or_si512(shr(t[i], S), _mm512_and_si512(shl(t[i + 1], limbBit - S), P.mask));
+		}
+		condSubP<N>(z, t, P);
+	}
+	/*
+		z[i] = x[i] * y[i] for i = 0, ..., n - 1
+		the i-th element is [i * next, i * next + U) of Unit
+	*/
+	static MCL_AVX512_FUNC void mulVec(Unit *z, const Unit *x, const Unit *y, size_t n, size_t next, const Op& op)
+	{
+		ParamFp<N> P;
+		uint64_t t[N];
+		toLimb52(t, N, op.p, U);
+		setFpM(P.p, t, N);
+		P.rp = _mm512_set1_epi64(op.rp & limbMask);
+		P.mask = _mm512_set1_epi64(limbMask);
+		const long long d = (long long)next;
+		const Vec idx = _mm512_set_epi64(d * 7, d * 6, d * 5, d * 4, d * 3, d * 2, d, 0);
+		const Vec zero = _mm512_setzero_si512();
+		for (size_t pos = 0; pos < n; pos += laneN) {
+			const __mmask8 c = __mmask8((1u << fp::min_(n - pos, laneN)) - 1);
+			const size_t offset = pos * next;
+			Vec w[U];
+			FpM<N> X, Y;
+			for (size_t j = 0; j < U; j++) {
+				w[j] = _mm512_mask_i64gather_epi64(zero, c, idx, (const long long*)(x + offset + j), 8);
+			}
+			toLimb(X, w, P.mask);
+			for (size_t j = 0; j < U; j++) {
+				w[j] = _mm512_mask_i64gather_epi64(zero, c, idx, (const long long*)(y + offset + j), 8);
+			}
+			toLimb(Y, w, P.mask);
+			mulR(X, X, Y, P);
+			fromLimb(w, X);
+			for (size_t j = 0; j < U; j++) {
+				_mm512_mask_i64scatter_epi64((long long*)(z + offset + j), c, idx, w[j], 8);
+			}
+		}
+	}
+};
+
+} } } // mcl::fp::avx512
@@ -2,6 +2,7 @@
 	#define MCL_BINT_ASM 0
 #endif
 #include <mcl/op.hpp>
+#include <mcl/fp.hpp>
 #include <mcl/util.hpp>
 #include <cybozu/sha2.hpp>
 #include <cybozu/endian.hpp>
@@ -30,10 +31,17 @@ Xbyak::util::Cpu g_cpu;
 
 #include "bint_impl.hpp"
 #include "low_func.hpp"
+#include "safegcd.hpp"
 #include <cybozu/itoa.hpp>
+#include <cybozu/benchmark.hpp>
 #include <mcl/randgen.hpp>
 #include "llvm_proto.hpp"
 
+#if defined(MCL_USE_XBYAK) && defined(__GNUC__)
+	#define MCL_USE_AVX512
+	#include "ec_avx512.hpp"
+#endif
+
 #ifdef _MSC_VER
 	#pragma warning(disable : 4127)
 #endif
@@ -79,6 +87,7 @@ const char *ModeToStr(Mode mode)
 	case FP_LLVM: return "llvm";
 	case FP_LLVM_MONT: return "llvm_mont";
 	case FP_XBYAK: return "xbyak";
+	case FP_TUNE: return "tune";
 	default:
 		assert(0);
 		return 0;
@@ -97,6 +106,7 @@ Mode StrToMode(const char *s)
 		{ "llvm", FP_LLVM },
 		{ "llvm_mont", FP_LLVM_MONT },
 		{ "xbyak", FP_XBYAK },
+		{ "tune", FP_TUNE },
 	};
 	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(tbl); i++) {
 		if (strcmp(s, tbl[i].s) == 0) return tbl[i].mode;
@@ -247,6 +257,29 @@ static void fp_invOpC(Unit *y, const Unit *x, const Op& op)
 	if (op.isMont) op.fp_mul(y, y, op.R3, op.p);
 }
 
+// constant-time fp_invOpC by safegcd for odd p
+template<size_t N>
+static void fp_invCTT(Unit *y, const Unit *x, const Op& op)
+{
+	safegcd::InvT<N>::inv(y, x, op.bitSize, op.p);
+	if (op.isMont) op.fp_mul(y, y, op.R3, op.p);
+}
+
+// bint::jacobi requires odd p
+static int fp_legendreC(const Unit *x, const Op& op)
+{
+	return bint::jacobi(x, op.N, op.p, op.N);
+}
+
+// Legendre symbol by posdivsteps for odd p
+template<size_t N>
+static int fp_legendreT(const Unit *x, const Op& op)
+{
+	int j;
+	if (safegcd::InvT<N>::jacobi(&j, x, op.bitSize, op.p)) return j;
+	return fp_legendreC(x, op);
+}
+
 // set x = y unless y = 0
 template<typename T>
 void setSafe(T& x, T y)
@@ -262,6 +295,9 @@ void setOp(Op& op)
 	op.fp_clear = bint::clearT<N>;
 	op.fp_copy = bint::copyT<N>;
 	op.fp_invOp = fp_invOpC;
+	op.fp_invCT = (op.p[0] & 1) ? fp_invCTT<N> : fp_invOpC;
+	// the Legendre symbol is not defined for even p (Op::init rejects it by sq.set)
+	op.fp_legendre = (op.p[0] & 1) ? fp_legendreT<N> : 0;
 	op.fp_mulUnit = mulUnitModT<N>;
 	op.fp_shr1 = shr1T<N>;
 	op.fp_neg = negT<N>;
@@ -361,6 +397,22 @@ static void initInvTbl(Op& op)
 }
 #endif
 
+#ifdef MCL_USE_AVX512
+// the values of 2^(64N) < 2^(52 EcLanes::maxN) are handled by avx512::MulVec
+static void setMulVec(Op& op)
+{
+	using namespace Xbyak::util;
+	if (!op.isMont || !g_cpu.has(Cpu::tAVX512F | Cpu::tAVX512_IFMA)) return;
+	switch (op.N) {
+	case 3: op.fp_mulVec = avx512::MulVec<3>::mulVec; break;
+	case 4: op.fp_mulVec = avx512::MulVec<4>::mulVec; break;
+	case 5: op.fp_mulVec = avx512::MulVec<5>::mulVec; break;
+	case 6: op.fp_mulVec = avx512::MulVec<6>::mulVec; break;
+	default: break;
+	}
+}
+#endif
+
 static bool initForMont(Op& op, const Unit *p, Mode mode)
 {
 	const size_t N = op.N;
@@ -388,6 +440,9 @@ static bool initForMont(Op& op, const Unit *p, Mode mode)
 #endif
 	if (op.fg == 0) op.fg = Op::createFpGenerator();
 	op.fg->init(op, g_cpu);
+#ifdef MCL_USE_AVX512
+	setMulVec(op);
+#endif
 #ifdef MCL_DUMP_JIT
 	return true;
 #endif
@@ -405,11 +460,164 @@ static bool initForMont(Op& op, const Unit *p, Mode mode)
 	return true;
 }
 
+/*
+	min clk of a fixed mix of add, sub, mul, sqr, mulPre and mod
+	which Fp, Fp2 (by FpDbl) and the tower are built on
+*/
+static uint64_t getOpClk(const Op& op)
+{
+	const size_t N = op.N;
+	Unit x[maxUnitSize], y[maxUnitSize], xy[maxUnitSize * 2];
+	bint::copyN(x, op.R2, N);
+	bint::copyN(y, op.R3, N);
+	const int loopN = 100;
+	uint64_t minClk = uint64_t(-1);
+	for (int i = 0; i < 10; i++) {
+		const uint64_t begin = cybozu::CpuClock::getCpuClk();
+		for (int j = 0; j < loopN; j++) {
+			// the functions of FpT (the JIT ones have the suffix A_)
+			if (op.fp_mulA_) op.fp_mulA_(x, x, y); else op.fp_mul(x, x, y, op.p);
+			if (op.fp_sqrA_) op.fp_sqrA_(y, y); else op.fp_sqr(y, y, op.p);
+			if (op.fp_addA_) op.fp_addA_(x, x, y); else op.fp_add(x, x, y, op.p);
+			if (op.fp_subA_) op.fp_subA_(y, y, x); else op.fp_sub(y, y, x, op.p);
+			op.fpDbl_mulPre(xy, x, y);
+			if (op.fpDbl_modA_) op.fpDbl_modA_(x, xy); else op.fpDbl_mod(x, xy, op.p);
+		}
+		minClk = fp::min_(minClk, cybozu::CpuClock::getCpuClk() - begin);
+	}
+	return minClk;
+}
+
+/*
+	MCL_TUNE_FILE is ignored in a setuid/setgid program on glibc
+*/
+static const char *getTuneFile()
+{
+#if defined(__GLIBC__) && defined(_GNU_SOURCE)
+	return secure_getenv("MCL_TUNE_FILE");
+#else
+	return getenv("MCL_TUNE_FILE");
+#endif
+}
+
+/*
+	set "<p in hex> <cpu>" to key where cpu is family.model.features
+	the result of tuning depends on the cpu
+	return false if key is too small
+*/
+static bool getTuneKey(char *key, size_t keySize, const mpz_class& p)
+{
+	size_t n = gmp::getStr(key, keySize, p, 16);
+	if (n == 0) return false;
+	unsigned int family = 0, model = 0, feature = 0;
+#ifdef MCL_X64_ASM
+	{
+		using namespace Xbyak::util;
+		const Cpu::Type tbl[] = {
+			Cpu::tAVX, Cpu::tAVX2, Cpu::tBMI2, Cpu::tADX, Cpu::tAVX512F, Cpu::tAVX512_IFMA,
+		};
+		for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(tbl); i++) {
+			if (g_cpu.has(tbl[i])) feature |= 1u << i;
+		}
+		family = g_cpu.displayFamily;
+		model = g_cpu.displayModel;
+	}
+#endif
+	int len = snprintf(key + n, keySize - n, " %x.%x.%x", family, model, feature);
+	return len > 0 && size_t(len) < keySize - n;
+}
+
+/*
+	split the line "<key> <mode>" of the cache file
+	return the pointer to mode and set '\0' at the end of key
+*/
+static char *splitTuneLine(char *line)
+{
+	line[strcspn(line, "\r\n")] = '\0';
+	char *sep = strrchr(line, ' ');
+	if (sep == 0) return 0;
+	*sep++ = '\0';
+	return sep;
+}
+
+static Mode loadTunedMode(const char *file, const char *key)
+{
+	FILE *fp = fopen(file, "rb");
+	if (fp == 0) return FP_AUTO;
+	Mode mode = FP_AUTO;
+	char line[1024];
+	while (fgets(line, sizeof(line), fp)) {
+		const char *modeStr = splitTuneLine(line);
+		if (modeStr && strcmp(line, key) == 0) mode = StrToMode(modeStr);
+	}
+	fclose(fp);
+	return mode;
+}
+
+/*
+	replace the line of key by "<key> <mode>" and keep the other lines
+	write a temporary file and rename it to file
+*/
+static void saveTunedMode(const char *file, const char *key, Mode mode)
+{
+	char tmpFile[1024];
+	int len = snprintf(tmpFile, sizeof(tmpFile), "%s.tmp", file);
+	if (len <= 0 || size_t(len) >= sizeof(tmpFile)) return;
+	FILE *out = fopen(tmpFile, "wb");
+	if (out == 0) return;
+	bool ok = true;
+	FILE *in = fopen(file, "rb");
+	if (in) {
+		char line[1024];
+		char buf[1024];
+		while (fgets(line, sizeof(line), in)) {
+			memcpy(buf, line, sizeof(line));
+			if (splitTuneLine(buf) && strcmp(buf, key) == 0) continue;
+			if (fputs(line, out) < 0) ok = false;
+		}
+		fclose(in);
+	}
+	if (fprintf(out, "%s %s\n", key, ModeToStr(mode)) < 0) ok = false;
+	if (fclose(out) != 0) ok = false;
+#ifdef _WIN32
+	// rename does not overwrite an existing file
+	if (ok) remove(file);
+#endif
+	if (!ok || rename(tmpFile, file) != 0) remove(tmpFile);
+}
+
+static Mode tuneMode(const mpz_class& p, size_t maxBitSize, int xi_a)
+{
+	const char *file = getTuneFile();
+	char key[1024];
+	if (!getTuneKey(key, sizeof(key), p)) file = 0;
+	if (file) {
+		Mode mode = loadTunedMode(file, key);
+		if (mode != FP_AUTO && mode != FP_TUNE) return mode;
+	}
+	const Mode tbl[] = { FP_XBYAK, FP_LLVM_MONT, FP_GMP_MONT };
+	Mode best = FP_AUTO;
+	uint64_t bestClk = uint64_t(-1);
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(tbl); i++) {
+		Op op;
+		// skip the mode that is not available and is replaced by another one
+		if (!op.init(p, maxBitSize, xi_a, tbl[i]) || op.mode != tbl[i]) continue;
+		const uint64_t clk = getOpClk(op);
+		if (clk < bestClk) {
+			best = tbl[i];
+			bestClk = clk;
+		}
+	}
+	if (file && best != FP_AUTO) saveTunedMode(file, key, best);
+	return best;
+}
+
 bool Op::init(const mpz_class& _p, size_t maxBitSize, int _xi_a, Mode mode, size_t mclMaxBitSize)
 {
 	if (mclMaxBitSize != MCL_MAX_BIT_SIZE) return false;
 	if (maxBitSize > MCL_MAX_BIT_SIZE) return false;
 	if (_p <= 0) return false;
+	if (mode == FP_TUNE) mode = tuneMode(_p, maxBitSize, _xi_a);
 	clear();
 	maxN = (maxBitSize + UnitBitSize - 1) / UnitBitSize;
 	N = gmp::getUnitSize(_p);
@@ -548,7 +756,20 @@ bool Op::init(const mpz_class& _p, size_t maxBitSize, int _xi_a, Mode mode, size
 	}
 	modp.init(mp);
 	smallModp.init(mp);
-	return fp::initForMont(*this, p, mode);
+	if (!fp::initForMont(*this, p, mode)) return false;
+	/*
+		the JIT may generate nothing (e.g. a cpu without mulx and adx)
+		then the functions set by setOp are used
+	*/
+	if (mode == FP_XBYAK && fp_mulA_ == 0) {
+#ifdef MCL_USE_LLVM
+		mode = FP_LLVM_MONT;
+#else
+		mode = FP_GMP_MONT;
+#endif
+	}
+	this->mode = mode;
+	return true;
 }
 
 #ifndef CYBOZU_DONT_USE_STRING
@@ -626,6 +847,128 @@ int64_t getInt64(bool *pb, fp::Block& b, const fp::Op& op)
 	return 0;
 }
 
+#ifdef MCL_USE_AVX512
+// y[0:n] = 52-bit limbs of x
+static bool setLimb52(uint64_t *y, size_t n, const mpz_class& x)
+{
+	Unit t[maxUnitSize];
+	bool b;
+	gmp::getArray(&b, t, maxUnitSize, x);
+	if (!b) return false;
+	avx512::toLimb52(y, n, t, maxUnitSize);
+	return true;
+}
+#endif
+
+bool initEcLanes(EcLanes& lanes, const Op& op, const Unit *b, size_t fpUnitN, bool isJacobi)
+{
+	lanes.n = 0;
+#ifdef MCL_USE_AVX512
+	using namespace Xbyak::util;
+	if (!g_cpu.has(Cpu::tAVX512F | Cpu::tAVX512_IFMA)) return false;
+	// 2p < R' = 2^(52n)
+	const size_t n = (op.bitSize + avx512::limbBit) / avx512::limbBit;
+	if (n < 4 || n > EcLanes::maxN) return false;
+	const mpz_class& p = op.mp;
+	const mpz_class R = op.isMont ? (mpz_class(1) << (op.N * UnitBitSize)) % p : mpz_class(1);
+	const mpz_class R2 = (mpz_class(1) << (n * avx512::limbBit)) % p;
+	const mpz_class M = mpz_class(1) << avx512::limbBit;
+	mpz_class invR, t;
+	gmp::invMod(invR, R, p);
+	bool ok;
+	gmp::setArray(&ok, t, b, op.N);
+	if (!ok) return false;
+	// reduce each product because Vint has a fixed size
+	// b in Montgomery form of Op -> 3b R'
+	t = (t * invR) % p;
+	t = (t * R2 * 3) % p;
+	if (!setLimb52(lanes.b3, n, t)) return false;
+	if (!setLimb52(lanes.one, n, R2)) return false;
+	// xR -> xR'
+	t = (R2 * R2) % p;
+	t = (t * invR) % p;
+	if (!setLimb52(lanes.toLanes, n, t)) return false;
+	// xR' -> xR
+	if (!setLimb52(lanes.fromLanes, n, R)) return false;
+	if (!setLimb52(lanes.p, n, p)) return false;
+	gmp::invMod(t, p % M, M);
+	t = M - t;
+	lanes.rp = gmp::getUnit(t, 0);
+	lanes.opN = op.N;
+	lanes.fpUnitN = fpUnitN;
+	lanes.isJacobi = isJacobi;
+	lanes.n = n;
+	return true;
+#else
+	(void)op;
+	(void)b;
+	(void)fpUnitN;
+	(void)isJacobi;
+	return false;
+#endif
+}
+
+void addEachLanes(const EcLanes& lanes, void *zVec, const void *xVec, const void *yVec, size_t n)
+{
+#ifdef MCL_USE_AVX512
+	Unit *z = (Unit*)zVec;
+	const Unit *x = (const Unit*)xVec;
+	const Unit *y = (const Unit*)yVec;
+	switch (lanes.n) {
+	case 4: avx512::addEachT<4>(lanes, z, x, y, n); return;
+	case 5: avx512::addEachT<5>(lanes, z, x, y, n); return;
+	case 6: avx512::addEachT<6>(lanes, z, x, y, n); return;
+	case 7: avx512::addEachT<7>(lanes, z, x, y, n); return;
+	case 8: avx512::addEachT<8>(lanes, z, x, y, n); return;
+	}
+#endif
+	(void)zVec;
+	(void)xVec;
+	(void)yVec;
+	(void)n;
+	assert(0);
+}
+
+void dblEachLanes(const EcLanes& lanes, void *zVec, const void *xVec, size_t n)
+{
+#ifdef MCL_USE_AVX512
+	Unit *z = (Unit*)zVec;
+	const Unit *x = (const Unit*)xVec;
+	switch (lanes.n) {
+	case 4: avx512::dblEachT<4>(lanes, z, x, n); return;
+	case 5: avx512::dblEachT<5>(lanes, z, x, n); return;
+	case 6: avx512::dblEachT<6>(lanes, z, x, n); return;
+	case 7: avx512::dblEachT<7>(lanes, z, x, n); return;
+	case 8: avx512::dblEachT<8>(lanes, z, x, n); return;
+	}
+#endif
+	(void)zVec;
+	(void)xVec;
+	(void)n;
+	assert(0);
+}
+
+void mulEachLanes(const EcLanes& lanes, void *zVec, const void *xVec, const void *yVec, size_t n, getUnitAtType getUnitAt)
+{
+#ifdef MCL_USE_AVX512
+	Unit *z = (Unit*)zVec;
+	const Unit *x = (const Unit*)xVec;
+	switch (lanes.n) {
+	case 4: avx512::mulEachT<4>(lanes, z, x, yVec, n, getUnitAt); return;
+	case 5: avx512::mulEachT<5>(lanes, z, x, yVec, n, getUnitAt); return;
+	case 6: avx512::mulEachT<6>(lanes, z, x, yVec, n, getUnitAt); return;
+	case 7: avx512::mulEachT<7>(lanes, z, x, yVec, n, getUnitAt); return;
+	case 8: avx512::mulEachT<8>(lanes, z, x, yVec, n, getUnitAt); return;
+	}
+#endif
+	(void)zVec;
+	(void)xVec;
+	(void)yVec;
+	(void)n;
+	(void)getUnitAt;
+	assert(0);
+}
+
 #ifdef _MSC_VER
 	#pragma warning(pop)
 #endif
@@ -265,6 +265,7 @@ struct FpGenerator : Xbyak::CodeGenerator {
 	Label fpDbl_modL;
 	Label fp_mulL;
 	Label fp2Dbl_mulPreL;
+	Label fp6Dbl_mulPreL;
 	const uint64_t *p_;
 	uint64_t rp_;
 	int pn_;
@@ -493,6 +494,13 @@ private:
 		if (gen_fp2_mul_xi(op.fp2_mul_xiA_)) {
 			setFuncInfo(prof_, suf, "2_mul_xi", op.fp2_mul_xiA_, getCurr());
 		}
+
+		if (gen_fp6Dbl_mulPre(op.fp6Dbl_mulPreA_)) {
+			setFuncInfo(prof_, suf, "6Dbl_mulPre", op.fp6Dbl_mulPreA_, getCurr());
+			if (gen_fp12_mul(op.fp12_mulA_)) {
+				setFuncInfo(prof_, suf, "12_mul", op.fp12_mulA_, getCurr());
+			}
+		}
 	}
 	template<class T1, class T2>
 	void add_ex(const T1& t1, const T2& t2, bool noCF)
@@ -3744,6 +3752,224 @@ private:
 		mov_mm(gp0 + FpByte_, t1, rax, pn_);
 		return true;
 	}
+	/*
+		FpDbl : pz = px + py
+		t.size() >= pn_ * 2
+	*/
+	void gen_raw_fpDbl_add(const RegExp& pz, const RegExp& px, const RegExp& py, const Pack& t)
+	{
+		gen_raw_add(pz, px, py, rax, pn_);
+		gen_raw_fp_add(pz + pn_ * 8, px + pn_ * 8, py + pn_ * 8, t, true);
+	}
+	/*
+		FpDbl : pz = px - py
+		use rax and require t.size() >= pn_ + 1
+	*/
+	void gen_raw_fpDbl_sub(const RegExp& pz, const RegExp& px, const RegExp& py, const Pack& t)
+	{
+		gen_raw_sub(pz, px, py, rax, pn_);
+		gen_raw_fp_sub(pz + pn_ * 8, px + pn_ * 8, py + pn_ * 8, t, true);
+	}
+	/*
+		Fp2 : pz = px + py without mod
+	*/
+	void gen_raw_fp2_addPre(const RegExp& pz, const RegExp& px, const RegExp& py)
+	{
+		gen_raw_add(pz, px, py, rax, pn_);
+		gen_raw_add(pz + FpByte_, px + FpByte_, py + FpByte_, rax, pn_);
+	}
+	/*
+		Fp2Dbl::subSpecial<true> : py -= px
+		the imaginary part is subtracted without mod
+	*/
+	void gen_raw_fp2Dbl_subSpecial(const RegExp& py, const RegExp& px, const Pack& t)
+	{
+		gen_raw_fpDbl_sub(py, py, px, t);
+		gen_raw_sub(py + FpByte_ * 2, py + FpByte_ * 2, px + FpByte_ * 2, rax, pn_ * 2);
+	}
+	/*
+		Fp6DblT::mulPreT<true> in one function
+		x = a + bv + cv^2, y = d + ev + fv^2, v^3 = xi = 1 + i
+		z.a = ((b + c)(e + f) - be - cf)xi + ad
+		z.b = (a + b)(d + e) - ad - be + cf xi
+		z.c = (a + c)(d + f) - ad - cf + be
+		the intermediate values are on the stack and fp2Dbl_mulPreL is called directly
+	*/
+	bool gen_fp6Dbl_mulPre(void3u& func)
+	{
+		if (isFullBit_) return false;
+		if (!(pn_ == 4 || pn_ == 6)) return false;
+		if (op_->xi_a != 1 || !op_->isLtQuad) return false;
+		align(16);
+		func = getCurr<void3u>();
+		StackFrame sf(this, 3, 10 | UseRDX, 0, false);
+		call(fp6Dbl_mulPreL);
+		sf.close();
+
+	L(fp6Dbl_mulPreL);
+		const int F = FpByte_;
+		const RegExp z = rsp + 0 * 8;
+		const RegExp x = rsp + 1 * 8;
+		const RegExp y = rsp + 2 * 8;
+		const Ext2 t1(F, rsp, 3 * 8);
+		const Ext2 t2(F, rsp, t1.next);
+		const Ext2 BE(F * 2, rsp, t2.next);
+		const Ext2 CF(F * 2, rsp, BE.next);
+		const Ext2 AD(F * 2, rsp, CF.next);
+		const Ext2 T(F * 2, rsp, AD.next);
+		const int SS = T.next;
+		sub(rsp, SS);
+		Pack tSub = sf.t;
+		tSub.append(rdx);
+		Pack tAdd = tSub;
+		tAdd.append(rax);
+		mov(ptr [z], gp0);
+		mov(ptr [x], gp1);
+		mov(ptr [y], gp2);
+		/*
+			(offset of x, offset of x, offset of y, offset of y, offset of z)
+			ZA = (b + c)(e + f), ZB = (a + b)(d + e), ZC = (a + c)(d + f)
+		*/
+		const int tbl[][5] = {
+			{ 1, 2, 1, 2, 0 },
+			{ 0, 1, 0, 1, 1 },
+			{ 0, 2, 0, 2, 2 },
+		};
+		for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(tbl); i++) {
+			mov(gp1, ptr [x]);
+			mov(gp2, ptr [y]);
+			gen_raw_fp2_addPre(t1, gp1 + tbl[i][0] * F * 2, gp1 + tbl[i][1] * F * 2);
+			gen_raw_fp2_addPre(t2, gp2 + tbl[i][2] * F * 2, gp2 + tbl[i][3] * F * 2);
+			mov(gp0, ptr [z]);
+			add(gp0, tbl[i][4] * F * 4);
+			lea(gp1, ptr [t1]);
+			lea(gp2, ptr [t2]);
+			call(fp2Dbl_mulPreL);
+		}
+		// BE = be, CF = cf, AD = ad
+		const struct {
+			const Ext2& d;
+			int pos;
+		} tbl2[] = {
+			{ BE, 1 }, { CF, 2 }, { AD, 0 },
+		};
+		for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(tbl2); i++) {
+			lea(gp0, ptr [tbl2[i].d]);
+			mov(gp1, ptr [x]);
+			add(gp1, tbl2[i].pos * F * 2);
+			mov(gp2, ptr [y]);
+			add(gp2, tbl2[i].pos * F * 2);
+			call(fp2Dbl_mulPreL);
+		}
+		mov(gp0, ptr [z]);
+		const RegExp ZA = gp0;
+		const RegExp ZB = gp0 + F * 4;
+		const RegExp ZC = gp0 + F * 8;
+		gen_raw_fp2Dbl_subSpecial(ZA, BE, tSub);
+		gen_raw_fp2Dbl_subSpecial(ZA, CF, tSub);
+		gen_raw_fp2Dbl_subSpecial(ZB, AD, tSub);
+		gen_raw_fp2Dbl_subSpecial(ZB, BE, tSub);
+		gen_raw_fp2Dbl_subSpecial(ZC, AD, tSub);
+		gen_raw_fp2Dbl_subSpecial(ZC, CF, tSub);
+		// ZC += BE
+		gen_raw_fpDbl_add(ZC, ZC, BE.a, tAdd);
+		gen_raw_fpDbl_add(ZC + F * 2, ZC + F * 2, BE.b, tAdd);
+		// ZA = ZA xi + AD = (ZA.a - ZA.b + AD.a) + (ZA.a + ZA.b + AD.b)i
+		gen_raw_fpDbl_sub(T.a, ZA, ZA + F * 2, tSub);
+		gen_raw_fpDbl_add(T.b, ZA, ZA + F * 2, tAdd);
+		gen_raw_fpDbl_add(ZA, T.a, AD.a, tAdd);
+		gen_raw_fpDbl_add(ZA + F * 2, T.b, AD.b, tAdd);
+		// ZB += CF xi
+		gen_raw_fpDbl_sub(T.a, CF.a, CF.b, tSub);
+		gen_raw_fpDbl_add(T.b, CF.a, CF.b, tAdd);
+		gen_raw_fpDbl_add(ZB, ZB, T.a, tAdd);
+		gen_raw_fpDbl_add(ZB + F * 2, ZB + F * 2, T.b, tAdd);
+		add(rsp, SS);
+		ret();
+		return true;
+	}
+	/*
+		Fp12T::mul in one function
+		x = a + bw, y = c + dw, w^2 = v
+		z.a = ac + bd v, z.b = (a + b)(c + d) - ac - bd
+		(a + bv + cv^2)v = c xi + av + bv^2
+		use fp6Dbl_mulPreL and fpDbl_modL
+		the sparse multiplications (mul_403, mul_041) and fasterSqr in bn.hpp are not generated
+		because they are no faster in one function than calling the Fp2Dbl functions above
+		and they increase the code size by 18KB each
+	*/
+	bool gen_fp12_mul(void3u& func)
+	{
+		align(16);
+		func = getCurr<void3u>();
+		const int F = FpByte_;
+		const RegExp z = rsp + 0 * 8;
+		const RegExp x = rsp + 1 * 8;
+		const RegExp y = rsp + 2 * 8;
+		const Ext1 t1(F * 6, rsp, 3 * 8);
+		const Ext1 t2(F * 6, rsp, t1.next);
+		const Ext1 AC(F * 12, rsp, t2.next);
+		const Ext1 BD(F * 12, rsp, AC.next);
+		const Ext1 T(F * 12, rsp, BD.next);
+		StackFrame sf(this, 3, 10 | UseRDX, T.next);
+		Pack tSub = sf.t;
+		tSub.append(rdx);
+		Pack tAdd = tSub;
+		tAdd.append(rax);
+		mov(ptr [z], gp0);
+		mov(ptr [x], gp1);
+		mov(ptr [y], gp2);
+		// t1 = a + b, t2 = c + d
+		for (int i = 0; i < 6; i++) {
+			gen_raw_fp_add((RegExp)t1 + F * i, gp1 + F * i, gp1 + F * (6 + i), tAdd);
+			gen_raw_fp_add((RegExp)t2 + F * i, gp2 + F * i, gp2 + F * (6 + i), tAdd);
+		}
+		// AC = ac
+		lea(gp0, ptr [AC]);
+		call(fp6Dbl_mulPreL);
+		// BD = bd
+		lea(gp0, ptr [BD]);
+		mov(gp1, ptr [x]);
+		add(gp1, F * 6);
+		mov(gp2, ptr [y]);
+		add(gp2, F * 6);
+		call(fp6Dbl_mulPreL);
+		// T = BD v + AC
+		const RegExp Tr = T;
+		const RegExp ACr = AC;
+		const RegExp BDr = BD;
+		gen_raw_fpDbl_sub(Tr, BDr + F * 8, BDr + F * 10, tSub);
+		gen_raw_fpDbl_add(Tr + F * 2, BDr + F * 8, BDr + F * 10, tAdd);
+		gen_raw_fpDbl_add(Tr, Tr, ACr, tAdd);
+		gen_raw_fpDbl_add(Tr + F * 2, Tr + F * 2, ACr + F * 2, tAdd);
+		for (int i = 0; i < 4; i++) {
+			gen_raw_fpDbl_add(Tr + F * (4 + i * 2), BDr + F * i * 2, ACr + F * (4 + i * 2), tAdd);
+		}
+		// z.a = T mod p
+		for (int i = 0; i < 6; i++) {
+			mov(gp0, ptr [z]);
+			add(gp0, F * i);
+			lea(gp1, ptr [Tr + F * 2 * i]);
+			call(fpDbl_modL);
+		}
+		// T = (a + b)(c + d) - AC - BD
+		lea(gp0, ptr [T]);
+		lea(gp1, ptr [t1]);
+		lea(gp2, ptr [t2]);
+		call(fp6Dbl_mulPreL);
+		for (int i = 0; i < 6; i++) {
+			gen_raw_fpDbl_sub(Tr + F * 2 * i, Tr + F * 2 * i, ACr + F * 2 * i, tSub);
+			gen_raw_fpDbl_sub(Tr + F * 2 * i, Tr + F * 2 * i, BDr + F * 2 * i, tSub);
+		}
+		// z.b = T mod p
+		for (int i = 0; i < 6; i++) {
+			mov(gp0, ptr [z]);
+			add(gp0, F * (6 + i));
+			lea(gp1, ptr [Tr + F * 2 * i]);
+			call(fpDbl_modL);
+		}
+		return true;
+	}
 };
 
 } } // mcl::fp
@@ -0,0 +1,292 @@
+#pragma once
+/**
+	@file
+	@brief constant-time modular inversion by safegcd
+	@author MITSUNARI Shigeo(@herumi)
+	@license modified new BSD license
+	http://opensource.org/licenses/BSD-3-Clause
+*/
+/*
+	D. J. Bernstein and B.-Y. Yang, Fast constant-time gcd computation and modular inversion
+	https://eprint.iacr.org/2019/266
+	the representation by signed B-bit limbs and the update of (d, e) follow modinv64 of libsecp256k1
+	all loops have trip counts depending only on p
+*/
+#include <mcl/op.hpp>
+#include <mcl/bint.hpp>
+
+namespace mcl { namespace fp { namespace safegcd {
+
+#ifdef MCL_DEFINED_UINT128_T
+typedef int64_t Limb;
+typedef uint64_t ULimb;
+typedef __attribute__((mode(TI))) int Limb2;
+const int B = 62;
+#else
+typedef int32_t Limb;
+typedef uint32_t ULimb;
+typedef int64_t Limb2;
+const int B = 30;
+#endif
+const int LimbBitSize = sizeof(Limb) * 8;
+const ULimb M = (ULimb(1) << B) - 1;
+
+// transition matrix of B divsteps scaled by 2^B
+struct Mat {
+	Limb u, v, q, r;
+};
+
+/*
+	the num of batches of B divsteps to reach g = 0 for odd f and 0 <= g < f < 2^bitSize
+	(Theorem 11.2 of the paper)
+*/
+inline size_t getBatchNum(size_t bitSize)
+{
+	const size_t d = bitSize;
+	const size_t iterN = d < 46 ? (49 * d + 80) / 17 : (49 * d + 57) / 17;
+	return (iterN + B - 1) / B;
+}
+
+// p^(-1) mod 2^B for odd p
+inline ULimb getInvB(ULimb p)
+{
+	ULimb inv = p; // 3-bit precision
+	for (int i = 0; i < 5; i++) {
+		inv *= 2 - p * inv;
+	}
+	return inv & M;
+}
+
+/*
+	apply B divsteps to the low B bits of f and g and return delta
+	divstep(delta, f, g) = (1 - delta, g, (g - f) / 2) if delta > 0 and g is odd
+	                       (1 + delta, f, (g + (g & 1) f) / 2) otherwise
+*/
+inline Limb divsteps(Mat& t, Limb delta, ULimb f, ULimb g)
+{
+	ULimb u = 1, v = 0, q = 0, r = 1;
+	for (int i = 0; i < B; i++) {
+		ULimb c1 = ULimb((-delta) >> (LimbBitSize - 1)); // delta > 0
+		const ULimb c2 = 0 - (g & 1); // g is odd
+		// (g, q, r) += (f, u, v) or -(f, u, v) if delta > 0
+		g += ((f ^ c1) - c1) & c2;
+		q += ((u ^ c1) - c1) & c2;
+		r += ((v ^ c1) - c1) & c2;
+		// (f, u, v) = old (g, q, r) if swap
+		c1 &= c2;
+		f += g & c1;
+		u += q & c1;
+		v += r & c1;
+		delta = (delta ^ Limb(c1)) - Limb(c1) + 1;
+		g >>= 1;
+		u <<= 1;
+		v <<= 1;
+	}
+	t.u = Limb(u);
+	t.v = Limb(v);
+	t.q = Limb(q);
+	t.r = Limb(r);
+	return delta;
+}
+
+/*
+	apply B posdivsteps to the low bits of f and g, update the bit 0 of jac and return eta = -delta
+	posdivstep adds a multiple of f to g instead of subtracting, so f and g stay non-negative
+	and the Jacobi symbol (g|f) is kept up to the sign in jac
+	(the variable-time version of libsecp256k1 ; several steps are done at once)
+*/
+inline Limb posdivsteps(Mat& t, Limb eta, ULimb f, ULimb g, int& jac)
+{
+	ULimb u = 1, v = 0, q = 0, r = 1;
+	int i = B;
+	for (;;) {
+		// divide g by 2^zeros with a sentinel bit
+		const int zeros = cybozu::bsf(g | (ULimb(-1) << i));
+		g >>= zeros;
+		u <<= zeros;
+		v <<= zeros;
+		eta -= zeros;
+		i -= zeros;
+		// (2|f) = -1 iff f = 3, 5 mod 8
+		jac ^= zeros & int((f >> 1) ^ (f >> 2));
+		if (i == 0) break;
+		if (eta < 0) {
+			eta = -eta;
+			fp::swap_(f, g);
+			fp::swap_(u, q);
+			fp::swap_(v, r);
+			// quadratic reciprocity
+			jac ^= int((f & g) >> 1);
+		}
+		// cancel the low min(eta + 1, i, 6) bits of g by g += f w where w = -g/f
+		const int limit = fp::min_<int>(int(eta) + 1, i);
+		const ULimb m = (ULimb(-1) >> (LimbBitSize - limit)) & 63;
+		const ULimb w = (f * g * (f * f - 2)) & m;
+		g += f * w;
+		q += u * w;
+		r += v * w;
+	}
+	t.u = Limb(u);
+	t.v = Limb(v);
+	t.q = Limb(q);
+	t.r = Limb(r);
+	return eta;
+}
+
+template<size_t N>
+struct InvT {
+	// num of signed B-bit limbs ; the top limb is not masked
+	static const size_t L = (N * UnitBitSize) / B + 1;
+	static void toLimb(Limb *y, const Unit *x)
+	{
+		for (size_t i = 0; i < L; i++) {
+			const size_t q = (i * B) / UnitBitSize;
+			const size_t r = (i * B) % UnitBitSize;
+			Unit v = 0;
+			if (q < N) {
+				v = x[q] >> r;
+				if (r + B > UnitBitSize && q + 1 < N) v |= x[q + 1] << (UnitBitSize - r);
+			}
+			y[i] = Limb(ULimb(v) & M);
+		}
+	}
+	// x must be in [0, 2^(N * UnitBitSize)) with limbs in [0, 2^B)
+	static void fromLimb(Unit *y, const Limb *x)
+	{
+		for (size_t i = 0; i < N; i++) y[i] = 0;
+		for (size_t i = 0; i < L; i++) {
+			const size_t q = (i * B) / UnitBitSize;
+			const size_t r = (i * B) % UnitBitSize;
+			const Unit v = Unit(ULimb(x[i]));
+			if (q < N) {
+				y[q] |= v << r;
+				if (r + B > UnitBitSize && q + 1 < N) y[q + 1] |= v >> (UnitBitSize - r);
+			}
+		}
+	}
+	// (f, g) = t (f, g) / 2^B where the low B bits of t (f, g) are zero
+	static void updateFg(Limb *f, Limb *g, const Mat& t)
+	{
+		Limb2 cf = Limb2(t.u) * f[0] + Limb2(t.v) * g[0];
+		Limb2 cg = Limb2(t.q) * f[0] + Limb2(t.r) * g[0];
+		cf >>= B;
+		cg >>= B;
+		for (size_t i = 1; i < L; i++) {
+			cf += Limb2(t.u) * f[i] + Limb2(t.v) * g[i];
+			cg += Limb2(t.q) * f[i] + Limb2(t.r) * g[i];
+			f[i - 1] = Limb(ULimb(cf) & M); cf >>= B;
+			g[i - 1] = Limb(ULimb(cg) & M); cg >>= B;
+		}
+		f[L - 1] = Limb(cf);
+		g[L - 1] = Limb(cg);
+	}
+	/*
+		(d, e) = (t (d, e) + p (md, me)) / 2^B
+		md and me are chosen so that the low B bits are zero and d, e stay in (-2p, p)
+	*/
+	static void updateDe(Limb *d, Limb *e, const Mat& t, const Limb *p, ULimb pInv)
+	{
+		const Limb sd = d[L - 1] >> (LimbBitSize - 1);
+		const Limb se = e[L - 1] >> (LimbBitSize - 1);
+		Limb md = (t.u & sd) + (t.v & se);
+		Limb me = (t.q & sd) + (t.r & se);
+		Limb2 cd = Limb2(t.u) * d[0] + Limb2(t.v) * e[0];
+		Limb2 ce = Limb2(t.q) * d[0] + Limb2(t.r) * e[0];
+		md -= Limb((pInv * ULimb(cd) + ULimb(md)) & M);
+		me -= Limb((pInv * ULimb(ce) + ULimb(me)) & M);
+		cd += Limb2(p[0]) * md;
+		ce += Limb2(p[0]) * me;
+		cd >>= B;
+		ce >>= B;
+		for (size_t i = 1; i < L; i++) {
+			cd += Limb2(t.u) * d[i] + Limb2(t.v) * e[i] + Limb2(p[i]) * md;
+			ce += Limb2(t.q) * d[i] + Limb2(t.r) * e[i] + Limb2(p[i]) * me;
+			d[i - 1] = Limb(ULimb(cd) & M); cd >>= B;
+			e[i - 1] = Limb(ULimb(ce) & M); ce >>= B;
+		}
+		d[L - 1] = Limb(cd);
+		e[L - 1] = Limb(ce);
+	}
+	static void carry(Limb *x)
+	{
+		for (size_t i = 0; i < L - 1; i++) {
+			x[i + 1] += x[i] >> B;
+			x[i] = Limb(ULimb(x[i]) & M);
+		}
+	}
+	// d = d mod p for d in (-2p, p) and negate d if sign < 0
+	static void normalize(Limb *d, Limb sign, const Limb *p)
+	{
+		Limb mask = d[L - 1] >> (LimbBitSize - 1);
+		for (size_t i = 0; i < L; i++) d[i] += p[i] & mask;
+		mask = sign >> (LimbBitSize - 1);
+		for (size_t i = 0; i < L; i++) d[i] = (d[i] ^ mask) - mask;
+		carry(d);
+		mask = d[L - 1] >> (LimbBitSize - 1);
+		for (size_t i = 0; i < L; i++) d[i] += p[i] & mask;
+		carry(d);
+	}
+	/*
+		y = 1/x mod p (y = 0 if x = 0) for odd p and x < p
+		f = p, g = x, d = 0, e = 1 and f = d x, g = e x mod p are kept
+		f = +-1 at the end
+	*/
+	static void inv(Unit *y, const Unit *x, size_t bitSize, const Unit *pUnit)
+	{
+		Limb p[L], f[L], g[L], d[L], e[L];
+		toLimb(p, pUnit);
+		toLimb(g, x);
+		for (size_t i = 0; i < L; i++) {
+			f[i] = p[i];
+			d[i] = 0;
+			e[i] = 0;
+		}
+		e[0] = 1;
+		const ULimb pInv = getInvB(ULimb(p[0]));
+		const size_t n = getBatchNum(bitSize);
+		Limb delta = 1;
+		for (size_t i = 0; i < n; i++) {
+			Mat t;
+			delta = divsteps(t, delta, ULimb(f[0]), ULimb(g[0]));
+			updateFg(f, g, t);
+			updateDe(d, e, t, p, pInv);
+		}
+		normalize(d, f[L - 1], p);
+		fromLimb(y, d);
+	}
+	/*
+		*pj = Jacobi symbol (x|p) for odd p and x < p by posdivsteps
+		f = p and g = x converge to f = 1 (and g = 0) if gcd(x, p) = 1
+		return false if it does not converge within the bound (then use bint::jacobi)
+	*/
+	static bool jacobi(int *pj, const Unit *x, size_t bitSize, const Unit *pUnit)
+	{
+		if (bint::isZeroN(x, N)) {
+			*pj = 0;
+			return true;
+		}
+		Limb f[L], g[L];
+		toLimb(f, pUnit);
+		toLimb(g, x);
+		// about 6 posdivsteps per bit are enough in practice
+		const size_t n = (bitSize * 6 + B - 1) / B;
+		Limb eta = -1;
+		int jac = 0;
+		for (size_t i = 0; i < n; i++) {
+			Mat t;
+			eta = posdivsteps(t, eta, ULimb(f[0]) | (ULimb(f[1]) << B), ULimb(g[0]) | (ULimb(g[1]) << B), jac);
+			updateFg(f, g, t);
+			if (f[0] == 1) {
+				Limb c = 0;
+				for (size_t j = 1; j < L; j++) c |= f[j];
+				if (c == 0) {
+					*pj = 1 - 2 * (jac & 1);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+};
+
+} } } // mcl::fp::safegcd
@@ -60,6 +60,69 @@ void benchAddDblG2()
 	CYBOZU_BENCH_C("G2::dbl(2)", C, G2::dbl, P3, P1);
 }
 
+void naivePowVec(Fp12& z, const Fp12 *xVec, const Fr *yVec, size_t n)
+{
+	z = 1;
+	for (size_t i = 0; i < n; i++) {
+		Fp12 t;
+		Fp12::pow(t, xVec[i], yVec[i]);
+		z *= t;
+	}
+}
+
+void benchPowVecGT()
+{
+	puts("benchPowVecGT");
+#ifndef NDEBUG
+	puts("skip in debug");
+	return;
+#endif
+	const size_t maxN = 4096;
+	std::vector<Fp12> xVec(maxN);
+	std::vector<Fr> yVec(maxN);
+	G1 P;
+	G2 Q;
+	hashAndMapToG1(P, "a");
+	hashAndMapToG2(Q, "b");
+	pairing(xVec[0], P, Q);
+	cybozu::XorShift rg;
+	for (size_t i = 0; i < maxN; i++) {
+		if (i > 0) Fp12::mul(xVec[i], xVec[i - 1], xVec[0]);
+		yVec[i].setByCSPRNG(rg);
+	}
+	Fp12 z;
+	for (size_t n = 1; n <= maxN; n *= 2) {
+		const int C = n < 64 ? int(256 / n) : 2;
+		printf("n=%4d\n", int(n));
+		CYBOZU_BENCH_C("GT::pow n times", C, naivePowVec, z, xVec.data(), yVec.data(), n);
+		CYBOZU_BENCH_C("GT::powVec     ", C, Fp12::powVec, z, xVec.data(), yVec.data(), n);
+		CYBOZU_BENCH_C("GT::powVecMT   ", C, Fp12::powVecMT, z, xVec.data(), yVec.data(), n, 0);
+	}
+}
+
+template<class G>
+void benchFixedBaseMSM(const G& P, const char *name)
+{
+	printf("benchFixedBaseMSM %s\n", name);
+#ifndef NDEBUG
+	puts("skip in debug");
+	return;
+#endif
+	const size_t N = 50;
+	std::vector<G> xVec(N);
+	std::vector<Fr> yVec(N);
+	cybozu::XorShift rg;
+	for (size_t i = 0; i < N; i++) {
+		G::mul(xVec[i], P, i + 3);
+		yVec[i].setByCSPRNG(rg);
+	}
+	FixedBaseMSM<G> msm;
+	msm.init(xVec.data(), N);
+	G Q;
+	CYBOZU_BENCH_C("G::mulVec          ", 100, G::mulVec, Q, xVec.data(), yVec.data(), N);
+	CYBOZU_BENCH_C("FixedBaseMSM:mulVec", 100, msm.mulVec, Q, yVec.data(), N);
+}
+
 template<class T>
 void invAdd(T& out, const T& x, const T& y)
 {
@@ -626,6 +626,15 @@ const char *f2Str =
 	f2.setStr(f2Str, 16);
 	local::mulSparse(f, l);
 	CYBOZU_TEST_EQUAL(f, f2);
+	// product of two lines
+	Fp6 l2;
+	l2.a = f.a.a;
+	l2.b = f.a.b;
+	l2.c = f.b.b;
+	local::convertFp6toFp12(f, l);
+	local::mulSparse(f, l2);
+	local::mulSparse2(f2, l, l2);
+	CYBOZU_TEST_EQUAL(f, f2);
 }
 
 CYBOZU_TEST_AUTO(pairing)
@@ -446,6 +446,33 @@ CYBOZU_TEST_AUTO(precomputed)
 	CYBOZU_TEST_ASSERT(mclBnGT_isEqual(&e1, &f3));
 }
 
+CYBOZU_TEST_AUTO(serializePrecomputedG2)
+{
+	mclBnG1 P;
+	mclBnG2 Q;
+	CYBOZU_TEST_ASSERT(!mclBnG1_hashAndMapTo(&P, "1", 1));
+	CYBOZU_TEST_ASSERT(!mclBnG2_hashAndMapTo(&Q, "1", 1));
+	std::vector<uint64_t> Qbuf(mclBn_getUint64NumToPrecompute());
+	mclBn_precomputeG2(Qbuf.data(), &Q);
+
+	const size_t size = mclBn_getPrecomputedG2SerializeSize();
+	CYBOZU_TEST_EQUAL(size, 64 + Qbuf.size() * sizeof(uint64_t));
+	std::vector<uint64_t> buf(size / sizeof(uint64_t));
+	CYBOZU_TEST_EQUAL(mclBn_serializePrecomputedG2(buf.data(), size - 1, Qbuf.data()), 0);
+	CYBOZU_TEST_EQUAL(mclBn_serializePrecomputedG2(buf.data(), size, Qbuf.data()), size);
+	CYBOZU_TEST_ASSERT(mclBn_getPrecomputedG2FromBuffer(buf.data(), size - 1) == 0);
+	const uint64_t *p = mclBn_getPrecomputedG2FromBuffer(buf.data(), size);
+	CYBOZU_TEST_ASSERT(p == buf.data() + 8);
+
+	mclBnGT e1, e2;
+	mclBn_pairing(&e1, &P, &Q);
+	mclBn_precomputedMillerLoop(&e2, &P, p);
+	mclBn_finalExp(&e2, &e2);
+	CYBOZU_TEST_ASSERT(mclBnGT_isEqual(&e1, &e2));
+	buf[0]++;
+	CYBOZU_TEST_ASSERT(mclBn_getPrecomputedG2FromBuffer(buf.data(), size) == 0);
+}
+
 CYBOZU_TEST_AUTO(millerLoopVec)
 {
 	const size_t n = 7;
@@ -466,6 +493,70 @@ CYBOZU_TEST_AUTO(millerLoopVec)
 	CYBOZU_TEST_ASSERT(mclBnGT_isEqual(&e1, &e2));
 }
 
+CYBOZU_TEST_AUTO(finalExpVec)
+{
+	const size_t n = 7;
+	mclBnGT x[n], y[n], z[n];
+	for (size_t i = 0; i < n; i++) {
+		char d = (char)(i + 1);
+		mclBnG1 P;
+		mclBnG2 Q;
+		mclBnG1_hashAndMapTo(&P, &d, 1);
+		mclBnG2_hashAndMapTo(&Q, &d, 1);
+		mclBn_millerLoop(&x[i], &P, &Q);
+		mclBn_finalExp(&z[i], &x[i]);
+	}
+	mclBn_finalExpVec(y, x, n);
+	for (size_t i = 0; i < n; i++) {
+		CYBOZU_TEST_ASSERT(mclBnGT_isEqual(&y[i], &z[i]));
+	}
+	mclBn_finalExpVecMT(x, x, n, 2);
+	for (size_t i = 0; i < n; i++) {
+		CYBOZU_TEST_ASSERT(mclBnGT_isEqual(&x[i], &z[i]));
+	}
+}
+
+CYBOZU_TEST_AUTO(pairingProductChecker)
+{
+	const size_t n = 20;
+	mclBnG1 Pvec[n];
+	mclBnG2 Qvec[n];
+	for (size_t i = 0; i < n; i++) {
+		char c = char('a' + i);
+		mclBnG1_hashAndMapTo(&Pvec[i], &c, 1);
+		mclBnG2_hashAndMapTo(&Qvec[i], &c, 1);
+	}
+	std::vector<uint64_t> Qbuf(mclBn_getUint64NumToPrecompute());
+	mclBn_precomputeG2(Qbuf.data(), &Qvec[0]);
+	mclBnPairingProductChecker *checker = mclBnPairingProductChecker_create();
+	CYBOZU_TEST_ASSERT(checker);
+	CYBOZU_TEST_ASSERT(mclBnPairingProductChecker_check(checker));
+	mclBnPairingProductChecker_addVec(checker, Pvec, Qvec, n);
+	CYBOZU_TEST_ASSERT(!mclBnPairingProductChecker_check(checker));
+	for (size_t i = 0; i < n; i++) {
+		mclBnG1 P;
+		mclBnG1_neg(&P, &Pvec[i]);
+		if (i == 0) {
+			mclBnPairingProductChecker_addPrecomputed(checker, &P, Qbuf.data());
+		} else {
+			mclBnPairingProductChecker_add(checker, &P, &Qvec[i]);
+		}
+	}
+	CYBOZU_TEST_ASSERT(mclBnPairingProductChecker_check(checker));
+	mclBnPairingProductChecker_clear(checker);
+	mclBnPairingProductChecker_add(checker, &Pvec[0], &Qvec[0]);
+	CYBOZU_TEST_ASSERT(!mclBnPairingProductChecker_check(checker));
+	mclBnPairingProductChecker_clear(checker);
+	mclBnPairingProductChecker_addVecMT(checker, Pvec, Qvec, n, 0);
+	for (size_t i = 0; i < n; i++) {
+		mclBnG1 P;
+		mclBnG1_neg(&P, &Pvec[i]);
+		mclBnPairingProductChecker_add(checker, &P, &Qvec[i]);
+	}
+	CYBOZU_TEST_ASSERT(mclBnPairingProductChecker_check(checker));
+	mclBnPairingProductChecker_destroy(checker);
+}
+
 CYBOZU_TEST_AUTO(millerLoopVecMT)
 {
 	const size_t n = 10;
@@ -1099,6 +1190,47 @@ CYBOZU_TEST_AUTO(mulVec)
 	CYBOZU_TEST_ASSERT(mclBnG1_isEqual(&z1, &w1));
 	CYBOZU_TEST_ASSERT(mclBnG2_isEqual(&z2, &w2));
 	CYBOZU_TEST_ASSERT(mclBnGT_isEqual(&zt, &wt));
+
+	const size_t workSize = std::max(mclBnG2_getMulVecMTWorkSize(N, 2), mclBnGT_getPowVecWorkSize(N));
+	std::vector<uint64_t> work((workSize + 7) / 8);
+	CYBOZU_TEST_ASSERT(mclBnG1_getMulVecWorkSize(N) <= workSize);
+	mclBnG1_mulVecWork(&z1, x1Vec, yVec, N, work.data(), workSize);
+	mclBnG2_mulVecMTWork(&z2, x2Vec, yVec, N, 2, work.data(), workSize);
+	mclBnGT_powVecWork(&zt, xtVec, yVec, N, work.data(), workSize);
+	CYBOZU_TEST_ASSERT(mclBnG1_isEqual(&z1, &w1));
+	CYBOZU_TEST_ASSERT(mclBnG2_isEqual(&z2, &w2));
+	CYBOZU_TEST_ASSERT(mclBnGT_isEqual(&zt, &wt));
+}
+
+CYBOZU_TEST_AUTO(mulEach)
+{
+	const size_t N = 20;
+	mclBnG1 x1Vec[N], z1Vec[N];
+	mclBnG2 x2Vec[N], z2Vec[N];
+	mclBnFr yVec[N];
+
+	for (size_t i = 0; i < N; i++) {
+		char c = char('a' + i);
+		mclBnG1_hashAndMapTo(&x1Vec[i], &c, 1);
+		mclBnG2_hashAndMapTo(&x2Vec[i], &c, 1);
+		mclBnFr_setByCSPRNG(&yVec[i]);
+	}
+	mclBnG1_mulEach(z1Vec, x1Vec, yVec, N);
+	mclBnG2_mulEach(z2Vec, x2Vec, yVec, N);
+	for (size_t i = 0; i < N; i++) {
+		mclBnG1 t1;
+		mclBnG2 t2;
+		mclBnG1_mul(&t1, &x1Vec[i], &yVec[i]);
+		mclBnG2_mul(&t2, &x2Vec[i], &yVec[i]);
+		CYBOZU_TEST_ASSERT(mclBnG1_isEqual(&z1Vec[i], &t1));
+		CYBOZU_TEST_ASSERT(mclBnG2_isEqual(&z2Vec[i], &t2));
+	}
+	mclBnG1_mulEachMT(x1Vec, x1Vec, yVec, N, 0);
+	mclBnG2_mulEachMT(x2Vec, x2Vec, yVec, N, 0);
+	for (size_t i = 0; i < N; i++) {
+		CYBOZU_TEST_ASSERT(mclBnG1_isEqual(&x1Vec[i], &z1Vec[i]));
+		CYBOZU_TEST_ASSERT(mclBnG2_isEqual(&x2Vec[i], &z2Vec[i]));
+	}
 }
 
 void G1onlyTest(int curve)
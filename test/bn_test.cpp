@@ -210,6 +210,233 @@ void testPrecomputed(const G1& P, const G2& Q)
 	CYBOZU_TEST_EQUAL(e1, e2);
 }
 
+void testSerializePrecomputedG2(const G1& P, const G2& Q)
+{
+	puts("testSerializePrecomputedG2");
+	Fp12 e1, e2;
+	pairing(e1, P, Q);
+	std::vector<Fp6> Qcoeff;
+	precomputeG2(Qcoeff, Q);
+	const size_t size = getPrecomputedG2SerializeSize();
+	CYBOZU_TEST_EQUAL(size, sizeof(PrecomputedG2Header) + Qcoeff.size() * sizeof(Fp6));
+	std::vector<mcl::Unit> buf((size + sizeof(mcl::Unit) - 1) / sizeof(mcl::Unit));
+	CYBOZU_TEST_EQUAL(serializePrecomputedG2(buf.data(), size - 1, Qcoeff.data()), 0u);
+	CYBOZU_TEST_EQUAL(serializePrecomputedG2(buf.data(), size, Qcoeff.data()), size);
+	// use buf directly
+	const Fp6 *p = getPrecomputedG2FromBuffer(buf.data(), size);
+	CYBOZU_TEST_ASSERT(p != 0);
+	precomputedMillerLoop(e2, P, p);
+	finalExp(e2, e2);
+	CYBOZU_TEST_EQUAL(e1, e2);
+	// copy
+	std::vector<Fp6> Qcoeff2;
+	deserializePrecomputedG2(Qcoeff2, buf.data(), size);
+	CYBOZU_TEST_ASSERT(Qcoeff == Qcoeff2);
+	// error
+	CYBOZU_TEST_ASSERT(getPrecomputedG2FromBuffer(buf.data(), size - 1) == 0);
+	CYBOZU_TEST_ASSERT(getPrecomputedG2FromBuffer((const char*)buf.data() + 1, size) == 0);
+	PrecomputedG2Header *h = (PrecomputedG2Header*)buf.data();
+	h->isMont ^= 1;
+	CYBOZU_TEST_ASSERT(getPrecomputedG2FromBuffer(buf.data(), size) == 0);
+	CYBOZU_TEST_EXCEPTION(deserializePrecomputedG2(Qcoeff2, buf.data(), size), cybozu::Exception);
+	h->isMont ^= 1;
+	memset(h + 1, 0xff, sizeof(Fp)); // out of range
+	CYBOZU_TEST_ASSERT(getPrecomputedG2FromBuffer(buf.data(), size) == 0);
+}
+
+void testCompressedGT(const G1& P, const G2& Q)
+{
+	puts("testCompressedGT");
+	Fp12 e, e1;
+	pairing(e, P, Q);
+	CompressedGT c(e), c2;
+	c.get(e1);
+	CYBOZU_TEST_EQUAL(e, e1);
+	CYBOZU_TEST_ASSERT(!c.isOne());
+	// serialize
+	uint8_t buf[1024];
+	size_t n = c.serialize(buf, sizeof(buf));
+	CYBOZU_TEST_EQUAL(n, Fp::getByteSize() * 6);
+	CYBOZU_TEST_EQUAL(c2.deserialize(buf, n), n);
+	CYBOZU_TEST_EQUAL(c, c2);
+	c2.setStr(c.getStr(16), 16);
+	CYBOZU_TEST_EQUAL(c, c2);
+	CYBOZU_TEST_ASSERT(c.isValid());
+	// c of x not in the cyclotomic subgroup is rejected
+	{
+		Fp6 t = c.getFp6();
+		t.a.a += Fp::one();
+		uint8_t buf2[1024];
+		size_t n2 = t.serialize(buf2, sizeof(buf2));
+		CYBOZU_TEST_EQUAL(c2.deserialize(buf2, n2), 0u);
+	}
+	// one
+	e1 = 1;
+	c.set(e1);
+	CYBOZU_TEST_ASSERT(c.isOne());
+	e1.clear();
+	c.get(e1);
+	CYBOZU_TEST_ASSERT(e1.isOne());
+	// vec
+	const size_t N = 40;
+	Fp12 x[N], y[N];
+	CompressedGT cx[N];
+	x[0] = e;
+	for (size_t i = 1; i < N; i++) x[i] = x[i - 1] * e;
+	x[7] = 1;
+	CompressedGT::compressVec(cx, x, N);
+	for (size_t i = 0; i < N; i++) {
+		CYBOZU_TEST_EQUAL(cx[i], CompressedGT(x[i]));
+	}
+	CompressedGT::decompressVec(y, cx, N);
+	for (size_t i = 0; i < N; i++) {
+		CYBOZU_TEST_EQUAL(x[i], y[i]);
+	}
+	// pow
+	cybozu::XorShift rg;
+	for (int i = 0; i < 10; i++) {
+		Fr r;
+		if (i == 0) {
+			r = 0;
+		} else if (i == 1) {
+			r = 1;
+		} else if (i == 2) {
+			r = -1;
+		} else {
+			r.setByCSPRNG(rg);
+		}
+		Fp12 z1;
+		Fp12::pow(z1, e, r);
+		CompressedGT cz;
+		CompressedGT::pow(cz, CompressedGT(e), r);
+		CYBOZU_TEST_EQUAL(cz, CompressedGT(z1));
+	}
+#ifdef NDEBUG
+	Fr r;
+	r.setByCSPRNG(rg);
+	c.set(e);
+	CYBOZU_BENCH_C("CompressedGT::pow", 100, CompressedGT::pow, c2, c, r);
+	CYBOZU_BENCH_C("compress", 100, c.set, e);
+	CYBOZU_BENCH_C("decompress", 100, c.get, e1);
+	CYBOZU_BENCH_C("compressVec", 10, CompressedGT::compressVec, cx, x, N);
+	CYBOZU_BENCH_C("decompressVec", 10, CompressedGT::decompressVec, y, cx, N);
+#endif
+}
+
+void testFixedBasePowGT(const G1& P, const G2& Q)
+{
+	puts("testFixedBasePowGT");
+	Fp12 e;
+	pairing(e, P, Q);
+	const size_t hTbl[] = { 1, 4, 8 };
+	cybozu::XorShift rg;
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(hTbl); i++) {
+		FixedBasePowGT fb;
+		fb.init(e, hTbl[i]);
+		for (int j = 0; j < 20; j++) {
+			Fr y;
+			if (j == 0) {
+				y = 0;
+			} else if (j == 1) {
+				y = 1;
+			} else if (j == 2) {
+				y = -1;
+			} else {
+				y.setByCSPRNG(rg);
+			}
+			Fp12 z1, z2;
+			Fp12::pow(z1, e, y);
+			fb.pow(z2, y);
+			CYBOZU_TEST_EQUAL(z1, z2);
+		}
+	}
+	mpz_class m = -12345;
+	FixedBasePowGT fb;
+	fb.init(e);
+	Fp12 z1, z2;
+	Fp12::pow(z1, e, m);
+	fb.pow(z2, m);
+	CYBOZU_TEST_EQUAL(z1, z2);
+#ifdef NDEBUG
+	Fr y;
+	y.setByCSPRNG(rg);
+	CYBOZU_BENCH_C("GT::pow", 100, Fp12::pow, z1, e, y);
+	CYBOZU_BENCH_C("FixedBasePowGT::pow", 100, fb.pow, z2, y);
+#endif
+}
+
+template<class G>
+void testFixedBaseMSM(const G& P, const char *name)
+{
+	printf("testFixedBaseMSM %s\n", name);
+	const size_t N = 50;
+	G xVec[N];
+	Fr yVec[N];
+	cybozu::XorShift rg;
+	for (size_t i = 0; i < N; i++) {
+		G::mul(xVec[i], P, i + 3);
+		if (i == 1) {
+			xVec[i].clear();
+		}
+		if (i == 2) {
+			yVec[i] = 0;
+		} else if (i == 3) {
+			yVec[i] = -1;
+		} else {
+			yVec[i].setByCSPRNG(rg);
+		}
+	}
+	const size_t cTbl[] = { 0, 1, 2, 5 };
+	for (size_t k = 0; k < CYBOZU_NUM_OF_ARRAY(cTbl); k++) {
+		FixedBaseMSM<G> msm;
+		msm.init(xVec, N, cTbl[k]);
+		CYBOZU_TEST_EQUAL(msm.getBaseNum(), N);
+		const size_t nTbl[] = { 0, 1, 17, N };
+		for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(nTbl); i++) {
+			const size_t n = nTbl[i];
+			G z1, z2;
+			z1.clear();
+			for (size_t j = 0; j < n; j++) {
+				G t;
+				G::mul(t, xVec[j], yVec[j]);
+				z1 += t;
+			}
+			msm.mulVec(z2, yVec, n);
+			CYBOZU_TEST_EQUAL(z1, z2);
+		}
+	}
+	FixedBaseMSM<G> msm1, msm2;
+	msm1.init(xVec, N);
+	std::string s = msm1.getStr();
+	msm2.setStr(s);
+	CYBOZU_TEST_EQUAL(msm2.getWindowSize(), msm1.getWindowSize());
+	G z1, z2;
+	msm1.mulVec(z1, yVec, N);
+	msm2.mulVec(z2, yVec, N);
+	CYBOZU_TEST_EQUAL(z1, z2);
+	{
+		std::string t = s;
+		t[1] ^= 1; // broken header
+		CYBOZU_TEST_EXCEPTION(msm2.setStr(t), cybozu::Exception);
+		CYBOZU_TEST_EQUAL(msm2.getBaseNum(), 0u);
+	}
+	// broken n with the table following the header
+	const uint32_t nTbl[] = { 0, 0xffffffff, uint32_t(FixedBaseMSM<G>::maxBaseN + 1) };
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(nTbl); i++) {
+		std::string t = s;
+		for (int j = 0; j < 4; j++) t[j] = char(nTbl[i] >> (j * 8));
+		CYBOZU_TEST_EXCEPTION(msm2.setStr(t), cybozu::Exception);
+		CYBOZU_TEST_EQUAL(msm2.getBaseNum(), 0u);
+		CYBOZU_TEST_EQUAL(msm2.deserialize(t.c_str(), t.size()), 0u);
+	}
+	{
+		// n = N - 1 does not read the whole table
+		std::string t = s;
+		t[0] = char(N - 1);
+		CYBOZU_TEST_ASSERT(msm2.deserialize(t.c_str(), t.size()) < t.size());
+	}
+}
+
 void testFp12pow(const G1& P, const G2& Q)
 {
 	Fp12 e, e1, e2;
@@ -231,6 +458,49 @@ void testFp12pow(const G1& P, const G2& Q)
 	}
 }
 
+void testPowVec(const G1& P, const G2& Q)
+{
+	puts("testPowVec");
+	const size_t N = 200;
+	Fp12 xVec[N];
+	Fr yVec[N];
+	pairing(xVec[0], P, Q);
+	cybozu::XorShift rg;
+	for (size_t i = 0; i < N; i++) {
+		if (i > 0) Fp12::mul(xVec[i], xVec[i - 1], xVec[0]);
+		if (i == 3) {
+			yVec[i] = 0;
+		} else if (i == 5) {
+			yVec[i] = -1;
+		} else {
+			yVec[i].setByCSPRNG(rg);
+		}
+	}
+	const size_t nTbl[] = { 1, 16, 17, 31, 64, 127, 128, 200 };
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(nTbl); i++) {
+		const size_t n = nTbl[i];
+		Fp12 z1, z2;
+		z1 = 1;
+		for (size_t j = 0; j < n; j++) {
+			Fp12 t;
+			Fp12::pow(t, xVec[j], yVec[j]);
+			z1 *= t;
+		}
+		Fp12::powVec(z2, xVec, yVec, n);
+		CYBOZU_TEST_EQUAL(z1, z2);
+		for (size_t cpuN = 0; cpuN < 4; cpuN++) {
+			z2.clear();
+			Fp12::powVecMT(z2, xVec, yVec, n, cpuN);
+			CYBOZU_TEST_EQUAL(z1, z2);
+		}
+	}
+	// all exponents are zero
+	for (size_t i = 0; i < N; i++) yVec[i] = 0;
+	Fp12 z;
+	Fp12::powVec(z, xVec, yVec, N);
+	CYBOZU_TEST_ASSERT(z.isOne());
+}
+
 void testMillerLoop2(const G1& P1, const G2& Q1)
 {
 	puts("testMillerLoop2");
@@ -269,6 +539,39 @@ void testMillerLoop2(const G1& P1, const G2& Q1)
 	CYBOZU_TEST_EQUAL(e2, e3);
 }
 
+void testFinalExpVec()
+{
+	puts("testFinalExpVec");
+	const size_t n = 40;
+	Fp12 x[n], y[n], z[n];
+	char c = 'a';
+	for (size_t i = 0; i < n; i++) {
+		G1 P;
+		G2 Q;
+		hashAndMapToG1(P, &c, 1);
+		hashAndMapToG2(Q, &c, 1);
+		millerLoop(x[i], P, Q);
+		c++;
+	}
+	x[3].clear();
+	x[5] = 1;
+	for (size_t i = 0; i < n; i++) {
+		finalExp(z[i], x[i]);
+	}
+	const size_t nTbl[] = { 0, 1, 2, 15, 16, 17, n };
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(nTbl); i++) {
+		const size_t m = nTbl[i];
+		for (size_t j = 0; j < m; j++) y[j] = 0;
+		finalExpVec(y, x, m);
+		for (size_t j = 0; j < m; j++) CYBOZU_TEST_EQUAL(y[j], z[j]);
+		for (size_t j = 0; j < m; j++) y[j] = 0;
+		finalExpVecMT(y, x, m, 3);
+		for (size_t j = 0; j < m; j++) CYBOZU_TEST_EQUAL(y[j], z[j]);
+	}
+	finalExpVec(x, x, n);
+	for (size_t i = 0; i < n; i++) CYBOZU_TEST_EQUAL(x[i], z[i]);
+}
+
 void testMillerLoopVec()
 {
 	puts("testMillerLoopVec");
@@ -323,6 +626,72 @@ void testMillerLoopVecMT()
 	}
 }
 
+void testPairingProductChecker()
+{
+	puts("testPairingProductChecker");
+	const size_t n = 40;
+	G1 Pvec[n];
+	G2 Qvec[n];
+	std::vector<Fp6> Qcoeff;
+	char c = 'a';
+	for (size_t i = 0; i < n; i++) {
+		hashAndMapToG1(Pvec[i], &c, 1);
+		hashAndMapToG2(Qvec[i], &c, 1);
+		c++;
+	}
+	// e(P, Q) e(-P, Q) = 1
+	G1 negP;
+	G1::neg(negP, Pvec[0]);
+	precomputeG2(Qcoeff, Qvec[0]);
+	for (size_t m = 0; m < n; m++) {
+		PairingProductChecker checker;
+		Fp12 f1, f2;
+		f1 = 1;
+		for (size_t i = 0; i < m; i++) {
+			Fp12 e;
+			millerLoop(e, Pvec[i], Qvec[i]);
+			f1 *= e;
+			checker.add(Pvec[i], Qvec[i]);
+		}
+		checker.getMillerLoop(f2);
+		CYBOZU_TEST_EQUAL(f1, f2);
+		CYBOZU_TEST_EQUAL(checker.check(), m == 0);
+		checker.add(Pvec[0], Qvec[0]);
+		checker.addPrecomputed(negP, Qcoeff);
+		CYBOZU_TEST_EQUAL(checker.check(), m == 0);
+	}
+	{
+		PairingProductChecker checker;
+		checker.addVec(Pvec, Qvec, n);
+		checker.addPrecomputed2(negP, Qcoeff, Pvec[0], Qcoeff);
+		PairingProductChecker checker2;
+		for (size_t i = 0; i < n; i++) {
+			G1 P;
+			G1::neg(P, Pvec[i]);
+			checker2.add(P, Qvec[i]);
+		}
+		CYBOZU_TEST_ASSERT(!checker.check());
+		checker.merge(checker2);
+		CYBOZU_TEST_ASSERT(checker.check());
+	}
+	{
+		PairingProductChecker checker;
+#ifdef MCL_USE_OMP
+		#pragma omp parallel for
+#endif
+		for (int i = 0; i < int(n); i++) {
+			G1 P;
+			G1::neg(P, Pvec[i]);
+			checker.add(Pvec[i], Qvec[i]);
+			checker.add(P, Qvec[i]);
+		}
+		CYBOZU_TEST_ASSERT(checker.check());
+		checker.clear();
+		checker.addVecMT(Pvec, Qvec, n);
+		CYBOZU_TEST_ASSERT(!checker.check());
+	}
+}
+
 void testPairing(const G1& P, const G2& Q, const char *eStr)
 {
 	puts("testPairing");
@@ -425,6 +794,9 @@ void testIo(const G1& P, const G2& Q)
 
 #include "bench.hpp"
 
+bool g_benchPowVec = false;
+bool g_benchMSM = false;
+
 CYBOZU_TEST_AUTO(naive)
 {
 	printf("mcl version=%03x\n", mcl::version);
@@ -443,6 +815,7 @@ CYBOZU_TEST_AUTO(naive)
 		return;
 #endif
 		testFp12pow(P, Q);
+		testPowVec(P, Q);
 		testIo(P, Q);
 		testTrivial(P, Q);
 		testSetStr(Q);
@@ -450,15 +823,27 @@ CYBOZU_TEST_AUTO(naive)
 		testMapToG2();
 		testCyclotomic();
 		testCompress(P, Q);
+		testCompressedGT(P, Q);
+		testFixedBasePowGT(P, Q);
+		testFixedBaseMSM(P, "G1");
+		testFixedBaseMSM(Q, "G2");
 		testPairing(P, Q, ts.e);
 		testPrecomputed(P, Q);
+		testSerializePrecomputedG2(P, Q);
 		testMillerLoop2(P, Q);
 		testMillerLoopVec();
+		testFinalExpVec();
 		testMillerLoopVecMT();
+		testPairingProductChecker();
 		testCommon(P, Q);
 		testBench(P, Q);
 		benchAddDblG1();
 		benchAddDblG2();
+		if (g_benchPowVec) benchPowVecGT();
+		if (g_benchMSM) {
+			benchFixedBaseMSM(P, "G1");
+			benchFixedBaseMSM(Q, "G2");
+		}
 	}
 	int count = (int)clk.getCount();
 	if (count) {
@@ -473,6 +858,8 @@ int main(int argc, char *argv[])
 	cybozu::Option opt;
 	std::string mode;
 	opt.appendOpt(&mode, "auto", "m", ": mode(gmp/gmp_mont/llvm/llvm_mont/xbyak)");
+	opt.appendBoolOpt(&g_benchPowVec, "bench-powvec", ": benchmark GT::powVec for n = 1, 2, 4, ..., 4096");
+	opt.appendBoolOpt(&g_benchMSM, "bench-msm", ": benchmark FixedBaseMSM::mulVec");
 	if (!opt.parse(argc, argv)) {
 		opt.usage();
 		return 1;
@@ -10,6 +10,7 @@
 #include <mcl/ecparam.hpp>
 #include <time.h>
 #include <math.h>
+#include <vector>
 
 typedef mcl::FpT<> Fp;
 struct tagZn;
@@ -71,6 +72,72 @@ void mulVecTest(const mcl::EcParam& para, mcl::ec::Mode ecMode)
 	}
 }
 
+void mulEachTest(const mcl::EcParam& para)
+{
+	puts("mulEachTest");
+	cybozu::XorShift rg;
+	const Fp x(para.gx);
+	const Fp y(para.gy);
+	Ec P(x, y);
+	const int N = 20;
+	Ec xVec[N], zVec[N];
+	Zn yVec[N];
+	for (size_t i = 0; i < N; i++) {
+		Ec::mul(xVec[i], P, i + 3);
+		yVec[i].setByCSPRNG(rg);
+	}
+	yVec[1] = 0;
+	yVec[2] = -1;
+	Ec::mulEach(zVec, xVec, yVec, N);
+	for (size_t i = 0; i < N; i++) {
+		Ec Q;
+		Ec::mul(Q, xVec[i], yVec[i]);
+		CYBOZU_TEST_ASSERT(zVec[i].isNormalized());
+		CYBOZU_TEST_EQUAL(zVec[i], Q);
+	}
+	Ec::mulEachMT(xVec, xVec, yVec, N);
+	for (size_t i = 0; i < N; i++) {
+		CYBOZU_TEST_EQUAL(xVec[i], zVec[i]);
+	}
+}
+
+void addEachTest(const mcl::EcParam& para)
+{
+	printf("addEachTest lanes=%d\n", Ec::isLanesAvailable());
+	const Fp x(para.gx);
+	const Fp y(para.gy);
+	Ec P(x, y);
+	const int N = 20;
+	Ec xVec[N], yVec[N], zVec[N];
+	for (size_t i = 0; i < N; i++) {
+		Ec::mul(xVec[i], P, i + 3);
+		Ec::mul(yVec[i], P, i * 5 + 1);
+	}
+	xVec[1].clear();
+	yVec[2].clear();
+	xVec[3].clear();
+	yVec[3].clear();
+	yVec[4] = xVec[4];
+	Ec::neg(yVec[5], xVec[5]);
+	Ec::addEach(zVec, xVec, yVec, N);
+	for (size_t i = 0; i < N; i++) {
+		Ec Q;
+		Ec::add(Q, xVec[i], yVec[i]);
+		CYBOZU_TEST_EQUAL(zVec[i], Q);
+	}
+	Ec::dblEach(zVec, xVec, N);
+	for (size_t i = 0; i < N; i++) {
+		Ec Q;
+		Ec::dbl(Q, xVec[i]);
+		CYBOZU_TEST_EQUAL(zVec[i], Q);
+	}
+	Ec::addEach(zVec, zVec, xVec, N);
+	for (size_t i = 0; i < N; i++) {
+		Ec Q;
+		Ec::mul(Q, xVec[i], 3);
+		CYBOZU_TEST_EQUAL(zVec[i], Q);
+	}
+}
 
 struct Test {
 	const mcl::EcParam& para;
@@ -293,6 +360,30 @@ struct Test {
 				CYBOZU_TEST_EQUAL_ARRAY(y, x, n);
 			}
 		}
+		// more points than one inversion chunk
+		const size_t bigN = mcl::ec::local::getNormalizeVecChunkN<Fp>() * 2 + 5;
+		std::vector<Ec> xs(bigN), ys(bigN), zs(bigN);
+		Ec::dbl(xs[0], P);
+		for (size_t i = 1; i < bigN; i++) {
+			Ec::add(xs[i], xs[i - 1], P);
+			if ((i % 7) == 0) xs[i - 1].clear();
+			if ((i % 11) == 0) Ec::normalize(xs[i - 1], xs[i - 1]);
+		}
+		Ec::normalizeVec(&ys[0], &xs[0], bigN);
+		for (size_t i = 0; i < bigN; i++) {
+			Ec t;
+			Ec::normalize(t, xs[i]);
+			CYBOZU_TEST_EQUAL(ys[i], t);
+			CYBOZU_TEST_ASSERT(ys[i].isNormalized());
+		}
+		const size_t cpuNtbl[] = { 0, 1, 3 };
+		for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(cpuNtbl); i++) {
+			Ec::normalizeVecMT(&zs[0], &xs[0], bigN, cpuNtbl[i]);
+			CYBOZU_TEST_EQUAL_ARRAY(zs, ys, bigN);
+		}
+		zs = xs;
+		Ec::normalizeVecMT(&zs[0], &zs[0], bigN, 3); // same addr
+		CYBOZU_TEST_EQUAL_ARRAY(zs, ys, bigN);
 	}
 
 	void mul() const
@@ -609,6 +700,14 @@ struct Test {
 		mcl::ec::addCTProj(Q, Zero, Zero);
 		Ec::add(R, Zero, Zero);
 		CYBOZU_TEST_EQUAL(Q, R);
+		mcl::ec::dblCTProj(Q, P);
+		Ec::dbl(R, P);
+		CYBOZU_TEST_EQUAL(Q, R);
+		mcl::ec::dblCTProj(Q, Q);
+		Ec::dbl(R, R);
+		CYBOZU_TEST_EQUAL(Q, R);
+		mcl::ec::dblCTProj(Q, Zero);
+		CYBOZU_TEST_ASSERT(Q.isZero());
 	}
 
 	template<class F>
@@ -641,6 +740,8 @@ mul 499.00usec
 	void run() const
 	{
 		mulVecTest(para, ecMode);
+		mulEachTest(para);
+		addEachTest(para);
 		normalizeVecTest();
 		cstr();
 		ope();
@@ -668,6 +769,8 @@ void test_sub_sub(const mcl::EcParam& para, mcl::fp::Mode fpMode)
 	Test(para, fpMode, mcl::ec::Jacobi).run();
 	puts("Affine");
 	Test(para, fpMode, mcl::ec::Affine).run();
+	puts("ProjComplete");
+	Test(para, fpMode, mcl::ec::ProjComplete).run();
 }
 
 void test_sub(const mcl::EcParam *para, size_t paraNum)
@@ -0,0 +1,2 @@
+#define MCL_FP_INLINE_MUL
+#include "fp_inline_test.hpp"
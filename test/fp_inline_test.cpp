@@ -0,0 +1 @@
+#include "fp_inline_test.hpp"
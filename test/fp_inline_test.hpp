@@ -0,0 +1,152 @@
+/*
+	include from fp_inline_test.cpp and fp_inline_mul_test.cpp (with MCL_FP_INLINE_MUL)
+*/
+#define MCL_FP_INLINE_CURVE MCL_BLS12_381
+#include <cybozu/test.hpp>
+#include <cybozu/benchmark.hpp>
+#include <cybozu/xorshift.hpp>
+#include <mcl/bls12_381.hpp>
+
+using namespace mcl::bn;
+
+template<int> struct InlineTag;
+template<int> struct RefTag;
+
+namespace mcl { namespace fp {
+template<> struct InlineModT<InlineTag<0> > : InlineModBN254p {};
+template<> struct InlineModT<InlineTag<1> > : InlineModBN254r {};
+template<> struct InlineModT<InlineTag<2> > : InlineModBLS12_381p {};
+template<> struct InlineModT<InlineTag<3> > : InlineModBLS12_381r {};
+} } // mcl::fp
+
+const char *g_pTbl[] = {
+	"0x2523648240000001ba344d80000000086121000000000013a700000000000013",
+	"0x2523648240000001ba344d8000000007ff9f800000000010a10000000000000d",
+	"0x1a0111ea397fe69a4b1ba7b6434bacd764774b84f38512bf6730d2a0f6b0f6241eabfffeb153ffffb9feffffffffaaab",
+	"0x73eda753299d7d483339d80809a1d80553bda402fffe5bfeffffffff00000001",
+};
+
+template<class F, class R>
+void set(F& x, const R& r)
+{
+	x.setStr(r.getStr(16), 16);
+}
+
+template<int i>
+void testInlineFp()
+{
+	typedef mcl::FpT<InlineTag<i>, 384> F;
+	typedef mcl::FpT<RefTag<i>, 384> R;
+	typedef mcl::FpDblT<F> FD;
+	typedef mcl::FpDblT<R> RD;
+	CYBOZU_TEST_ASSERT(F::useInline);
+	CYBOZU_TEST_ASSERT(!R::useInline);
+#ifdef MCL_FP_INLINE_MUL
+	CYBOZU_TEST_ASSERT(F::useInlineMul);
+#else
+	CYBOZU_TEST_ASSERT(!F::useInlineMul);
+#endif
+	bool b;
+	// a different modulus is not accepted
+	F::init(&b, g_pTbl[(i + 1) % CYBOZU_NUM_OF_ARRAY(g_pTbl)]);
+	CYBOZU_TEST_ASSERT(!b);
+	F::init(&b, g_pTbl[i]);
+	CYBOZU_TEST_ASSERT(b);
+	R::init(&b, g_pTbl[i]);
+	CYBOZU_TEST_ASSERT(b);
+	RD::init();
+	cybozu::XorShift rg;
+	R rx, ry, rz;
+	F x, y, z;
+	for (int j = 0; j < 1000; j++) {
+		rx.setByCSPRNG(rg);
+		ry.setByCSPRNG(rg);
+		if (j == 0) rx.clear();
+		if (j == 1) ry = -R(1);
+		set(x, rx);
+		set(y, ry);
+		CYBOZU_TEST_EQUAL(x.isZero(), rx.isZero());
+		R::add(rz, rx, ry); F::add(z, x, y);
+		CYBOZU_TEST_EQUAL(z.getStr(16), rz.getStr(16));
+		R::sub(rz, rx, ry); F::sub(z, x, y);
+		CYBOZU_TEST_EQUAL(z.getStr(16), rz.getStr(16));
+		R::neg(rz, rx); F::neg(z, x);
+		CYBOZU_TEST_EQUAL(z.getStr(16), rz.getStr(16));
+		R::mul(rz, rx, ry); F::mul(z, x, y);
+		CYBOZU_TEST_EQUAL(z.getStr(16), rz.getStr(16));
+		R::sqr(rz, ry); F::sqr(z, y);
+		CYBOZU_TEST_EQUAL(z.getStr(16), rz.getStr(16));
+		F::mul(x, x, x); // same addr
+		R::mul(rx, rx, rx);
+		CYBOZU_TEST_EQUAL(x.getStr(16), rx.getStr(16));
+		RD rd1, rd2;
+		FD d1, d2;
+		RD::mulPre(rd1, rx, ry); FD::mulPre(d1, x, y);
+		RD::sqrPre(rd2, ry); FD::sqrPre(d2, y);
+		RD::add(rd1, rd1, rd2); FD::add(d1, d1, d2);
+		RD::mod(rz, rd1); FD::mod(z, d1);
+		CYBOZU_TEST_EQUAL(z.getStr(16), rz.getStr(16));
+		RD::sub(rd1, rd2, rd1); FD::sub(d1, d2, d1);
+		RD::mod(rz, rd1); FD::mod(z, d1);
+		CYBOZU_TEST_EQUAL(z.getStr(16), rz.getStr(16));
+		// InlineFpT::mul is used by F only with MCL_FP_INLINE_MUL
+		// F and R have the same Montgomery representation
+		typedef mcl::fp::InlineFpT<mcl::fp::InlineModT<InlineTag<i> > > IF;
+		mcl::Unit zz[IF::N], xy[IF::N * 2];
+		R::mul(rz, rx, ry);
+		IF::mul(zz, x.getUnit(), y.getUnit());
+		CYBOZU_TEST_EQUAL_ARRAY(zz, rz.getUnit(), IF::N);
+		IF::mulPre(xy, x.getUnit(), y.getUnit());
+		IF::mod(zz, xy);
+		CYBOZU_TEST_EQUAL_ARRAY(zz, rz.getUnit(), IF::N);
+	}
+}
+
+CYBOZU_TEST_AUTO(InlineFp)
+{
+	testInlineFp<0>();
+	testInlineFp<1>();
+	testInlineFp<2>();
+	testInlineFp<3>();
+}
+
+CYBOZU_TEST_AUTO(pairing)
+{
+	CYBOZU_TEST_ASSERT(Fp::useInline);
+	CYBOZU_TEST_ASSERT(Fr::useInline);
+	bool b;
+	initPairing(&b, mcl::BN254);
+	CYBOZU_TEST_ASSERT(!b);
+	initPairing(&b, mcl::BLS12_381);
+	CYBOZU_TEST_ASSERT(b);
+	G1 P, aP;
+	G2 Q, bQ;
+	hashAndMapToG1(P, "abc", 3);
+	hashAndMapToG2(Q, "abc", 3);
+	Fr a, c;
+	a.setHashOf("a", 1);
+	c.setHashOf("b", 1);
+	G1::mul(aP, P, a);
+	G2::mul(bQ, Q, c);
+	GT e1, e2;
+	pairing(e1, P, Q);
+	pairing(e2, aP, bQ);
+	GT::pow(e1, e1, a * c);
+	CYBOZU_TEST_EQUAL(e1, e2);
+	CYBOZU_BENCH_C("pairing", 100, pairing, e1, P, Q);
+	const size_t n = 64;
+	G1 Pvec[n];
+	Fr xVec[n];
+	for (size_t i = 0; i < n; i++) {
+		G1::mul(Pvec[i], P, int(i + 3));
+		xVec[i].setByCSPRNG();
+	}
+	G1 R1, R2;
+	G1::mulVec(R1, Pvec, xVec, n);
+	R2.clear();
+	for (size_t i = 0; i < n; i++) {
+		R2 += Pvec[i] * xVec[i];
+	}
+	CYBOZU_TEST_EQUAL(R1, R2);
+	CYBOZU_BENCH_C("mulVec", 100, G1::mulVec, R1, Pvec, xVec, n);
+}
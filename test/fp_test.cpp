@@ -4,6 +4,7 @@
 #include <mcl/fp.hpp>
 #include "../src/low_func.hpp"
 #include <time.h>
+#include <fstream>
 #include <cybozu/benchmark.hpp>
 #include <cybozu/option.hpp>
 #include <cybozu/sha2.hpp>
@@ -977,12 +978,39 @@ void mul2Test()
 	}
 }
 
+void mulEachTest()
+{
+	const size_t maxN = 20;
+	Fp x[maxN], y[maxN], z[maxN];
+	cybozu::XorShift rg;
+	for (size_t n = 0; n < maxN; n++) {
+		for (size_t i = 0; i < n; i++) {
+			x[i].setByCSPRNG(rg);
+			y[i].setByCSPRNG(rg);
+		}
+		if (n > 1) {
+			x[0] = -1;
+			y[0] = -1;
+			x[1] = 0;
+		}
+		Fp::mulEach(z, x, y, n);
+		for (size_t i = 0; i < n; i++) {
+			CYBOZU_TEST_EQUAL(z[i], x[i] * y[i]);
+		}
+		Fp::mulEach(x, x, y, n); // same addr
+		CYBOZU_TEST_EQUAL_ARRAY(z, x, n);
+	}
+}
+
 void invVecTest()
 {
-	const size_t maxN = 10;
+	// n >= 32 for invVecWorkLanes
+	const size_t nTbl[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 33, 64, 100 };
+	const size_t maxN = 100;
 	Fp x[maxN], y[maxN];
 	cybozu::XorShift rg;
-	for (size_t n = 0; n < maxN; n++) {
+	for (size_t k = 0; k < CYBOZU_NUM_OF_ARRAY(nTbl); k++) {
+		const size_t n = nTbl[k];
 		for (int j = 0; j < 10; j++) {
 			size_t retN = 0;
 			for (size_t i = 0; i < n; i++) {
@@ -996,6 +1024,11 @@ void invVecTest()
 			}
 			size_t ret = invVec(y, x, n);
 			CYBOZU_TEST_EQUAL(ret, retN);
+			Fp z[maxN];
+			CYBOZU_TEST_EQUAL(Fp::invVec(z, x, n), retN);
+			CYBOZU_TEST_EQUAL_ARRAY(z, y, n);
+			CYBOZU_TEST_EQUAL(Fp::invVecMT(z, x, n, 2), retN);
+			CYBOZU_TEST_EQUAL_ARRAY(z, y, n);
 			for (size_t i = 0; i < n; i++) {
 				if (x[i].isZero()) {
 					CYBOZU_TEST_ASSERT(y[i].isZero());
@@ -1009,6 +1042,88 @@ void invVecTest()
 	}
 }
 
+void invConstTimeTest()
+{
+	Fp x, y, z;
+	x.clear();
+	Fp::inv(y, x, true);
+	CYBOZU_TEST_ASSERT(y.isZero());
+	const int tbl[] = { 1, -1, 2, -2, 3, 0x12345 };
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(tbl); i++) {
+		x = tbl[i];
+		Fp::inv(y, x, true);
+		Fp::inv(z, x);
+		CYBOZU_TEST_EQUAL(y, z);
+	}
+	cybozu::XorShift rg;
+	for (int i = 0; i < 100; i++) {
+		x.setByCSPRNG(rg);
+		if (x.isZero()) continue;
+		Fp::inv(y, x, true);
+		Fp::inv(z, x);
+		CYBOZU_TEST_EQUAL(y, z);
+		Fp::inv(x, x, true); // same addr
+		CYBOZU_TEST_EQUAL(x, z);
+	}
+}
+
+void squareRootTest()
+{
+	const mpz_class& p = Fp::getOp().mp;
+	Fp x, y, z, w;
+	x.clear();
+	CYBOZU_TEST_ASSERT(Fp::squareRoot(y, x));
+	CYBOZU_TEST_ASSERT(y.isZero());
+	CYBOZU_TEST_ASSERT(!Fp::invSquareRoot(y, x));
+	cybozu::XorShift rg;
+	for (int i = 0; i < 100; i++) {
+		x.setByCSPRNG(rg);
+		if (x.isZero()) continue;
+		Fp::sqr(y, x);
+		CYBOZU_TEST_ASSERT(Fp::squareRoot(z, y));
+		CYBOZU_TEST_ASSERT(z == x || z == -x);
+		CYBOZU_TEST_ASSERT(Fp::invSquareRoot(w, y));
+		CYBOZU_TEST_EQUAL(w * z, 1);
+		// x is a square iff legendre(x, p) = 1
+		const bool isSquare = mcl::gmp::legendre(x.getMpz(), p) > 0;
+		CYBOZU_TEST_EQUAL(Fp::squareRoot(z, x), isSquare);
+		CYBOZU_TEST_EQUAL(Fp::invSquareRoot(w, x), isSquare);
+		if (isSquare) {
+			CYBOZU_TEST_EQUAL(z * z, x);
+			CYBOZU_TEST_EQUAL(w * z, 1);
+		}
+		Fp::squareRoot(y, y); // same addr
+		CYBOZU_TEST_ASSERT(y == x || y == -x);
+	}
+}
+
+void legendreTest()
+{
+	const mpz_class& p = Fp::getOp().mp;
+	Fp x;
+	x.clear();
+	CYBOZU_TEST_EQUAL(Fp::legendre(x), 0);
+	CYBOZU_TEST_ASSERT(Fp::isSquare(x));
+	const int N = 100;
+	Fp xs[N];
+	cybozu::XorShift rg;
+	for (int i = 0; i < N; i++) {
+		xs[i].setByCSPRNG(rg);
+		if (i == 0) xs[i] = 1;
+		if (i == 1) xs[i] = -1;
+		if (i == 2) xs[i] = 2;
+		if (i == 3) xs[i].clear();
+	}
+	for (int i = 0; i < N; i++) {
+		const int v = mcl::gmp::legendre(xs[i].getMpz(), p);
+		CYBOZU_TEST_EQUAL(Fp::legendre(xs[i]), v);
+		CYBOZU_TEST_EQUAL(Fp::isSquare(xs[i]), v >= 0);
+		// generic version for non-reduced x
+		mpz_class m = xs[i].getMpz() + p * 3;
+		CYBOZU_TEST_EQUAL(mcl::bint::jacobi(mcl::gmp::getUnit(m), mcl::gmp::getUnitSize(m), mcl::gmp::getUnit(p), mcl::gmp::getUnitSize(p)), v);
+	}
+}
+
 void getMontgomeryCoeffTest()
 {
 	const mcl::fp::Op& op = Fp::getOp();
@@ -1038,6 +1153,8 @@ void sub(mcl::fp::Mode mode)
 		"0x7523648240000001ba344d80000000086121000000000013a700000000000017",
 		"0x800000000000000000000000000000000000000000000000000000000000005f",
 		"0xfffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2f", // secp256k1
+		"0x73eda753299d7d483339d80809a1d80553bda402fffe5bfeffffffff00000001", // BLS12-381 r ; p - 1 = 2^32 q
+		"0xffffffffffffffffffffffffffffffff000000000000000000000001", // NIST P224 ; p - 1 = 2^96 q
 		"0xffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff43", // max prime
 #if MCL_MAX_BIT_SIZE >= 384
 
@@ -1061,6 +1178,10 @@ void sub(mcl::fp::Mode mode)
 		Fp::init(pStr, mode);
 		getMontgomeryCoeffTest();
 		invVecTest();
+		invConstTimeTest();
+		squareRootTest();
+		legendreTest();
+		mulEachTest();
 		mul2Test();
 		cstrTest();
 		setStrTest();
@@ -1123,6 +1244,68 @@ CYBOZU_TEST_AUTO(main)
 #endif
 }
 
+#ifndef _WIN32
+// read the cache file which must have only one line "<key> <mode>"
+static bool readTuneFile(std::string& key, std::string& mode, const char *file)
+{
+	std::ifstream ifs(file, std::ios::binary);
+	std::string line, next;
+	if (!std::getline(ifs, line) || std::getline(ifs, next)) return false;
+	size_t pos = line.rfind(' ');
+	if (pos == std::string::npos) return false;
+	key = line.substr(0, pos);
+	mode = line.substr(pos + 1);
+	return true;
+}
+
+static void writeTuneFile(const char *file, const std::string& key, const char *mode)
+{
+	std::ofstream ofs(file, std::ios::binary);
+	ofs << key << ' ' << mode << '\n';
+}
+#endif
+
+CYBOZU_TEST_AUTO(tune)
+{
+	using namespace mcl::fp;
+	const char *pStr = "0x1a0111ea397fe69a4b1ba7b6434bacd764774b84f38512bf6730d2a0f6b0f6241eabfffeb153ffffb9feffffffffaaab";
+	Fp::init(pStr, FP_TUNE);
+	const Mode mode = Fp::getMode();
+	printf("tune=%s\n", ModeToStr(mode));
+	CYBOZU_TEST_ASSERT(mode == FP_XBYAK || mode == FP_LLVM_MONT || mode == FP_GMP_MONT);
+	const mpz_class& p = Fp::getOp().mp;
+	Fp x, y;
+	x.setStr("0x123456789abcdef");
+	y = -x;
+	x *= y;
+	CYBOZU_TEST_EQUAL(x.getMpz(), (p - mpz_class("0x123456789abcdef") * mpz_class("0x123456789abcdef") % p) % p);
+#ifndef _WIN32
+	const char *file = "fp_test_tune.txt";
+	remove(file);
+	setenv("MCL_TUNE_FILE", file, 1);
+	// the result is saved
+	Fp::init(pStr, FP_TUNE);
+	const Mode saved = Fp::getMode();
+	std::string key, modeStr;
+	CYBOZU_TEST_ASSERT(readTuneFile(key, modeStr, file));
+	CYBOZU_TEST_EQUAL(modeStr, ModeToStr(saved));
+	// the saved mode is loaded without measurement
+	Fp::init(pStr, FP_TUNE);
+	CYBOZU_TEST_EQUAL(Fp::getMode(), saved);
+	// the cached mode is used even if it is not the fastest
+	writeTuneFile(file, key, "gmp_mont");
+	Fp::init(pStr, FP_TUNE);
+	CYBOZU_TEST_EQUAL(Fp::getMode(), FP_GMP_MONT);
+	// an invalid entry is measured again and is replaced
+	writeTuneFile(file, key, "auto");
+	Fp::init(pStr, FP_TUNE);
+	CYBOZU_TEST_ASSERT(readTuneFile(key, modeStr, file));
+	CYBOZU_TEST_EQUAL(modeStr, ModeToStr(Fp::getMode()));
+	remove(file);
+	unsetenv("MCL_TUNE_FILE");
+#endif
+}
+
 CYBOZU_TEST_AUTO(convertArrayAsLE)
 {
 	using namespace mcl::fp;
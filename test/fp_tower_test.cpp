@@ -124,6 +124,8 @@ void testFp2()
 	}
 	y = x;
 	Fp2::inv(y, x);
+	Fp2::inv(z, x, true);
+	CYBOZU_TEST_EQUAL(z, y);
 	y *= x;
 	CYBOZU_TEST_EQUAL(y, 1);
 
@@ -146,6 +148,17 @@ void testFp2()
 		CYBOZU_TEST_ASSERT(Fp2::squareRoot(z, y));
 		CYBOZU_TEST_EQUAL(z * z, y);
 	}
+	// x is a square iff legendre(x) >= 0 if Fp2 is a field (-1 is not a square)
+	for (int i = 0; i < 20; i++) {
+		x.a = i * i + 5;
+		x.b = i * 3 + 1;
+		if (!Fp::isSquare(-1)) {
+			CYBOZU_TEST_EQUAL(Fp2::isSquare(x), Fp2::squareRoot(z, x));
+			if (Fp2::isSquare(x)) CYBOZU_TEST_EQUAL(z * z, x);
+		}
+		Fp2::sqr(y, x);
+		CYBOZU_TEST_EQUAL(Fp2::legendre(y), 1);
+	}
 
 	// serialize
 	for (int i = 0; i < 2; i++) {
@@ -204,8 +217,36 @@ void testFp6()
 	Fp6::mul(w, x, x);
 	testFp6sqr(a, b, c, z);
 	testFp6sqr(a, b, c, w);
+	// compare with the schoolbook method
+	cybozu::XorShift rg;
+	for (int i = 0; i < 100; i++) {
+		Fp *px = x.getFp0();
+		Fp *py = y.getFp0();
+		for (int j = 0; j < 6; j++) {
+			if (i == 0) {
+				px[j] = -1;
+				py[j] = -1;
+			} else {
+				px[j].setByCSPRNG(rg);
+				py[j].setByCSPRNG(rg);
+			}
+		}
+		Fp6::mul(z, x, y);
+		Fp2 t;
+		t = x.b * y.c + x.c * y.b;
+		Fp2::mul_xi(t, t);
+		w.a = x.a * y.a + t;
+		t = x.c * y.c;
+		Fp2::mul_xi(t, t);
+		w.b = x.a * y.b + x.b * y.a + t;
+		w.c = x.a * y.c + x.b * y.b + x.c * y.a;
+		CYBOZU_TEST_EQUAL(z, w);
+	}
+	x = Fp6(a, b, c);
 	for (int i = 0; i < 10; i++) {
 		Fp6::inv(y, x);
+		Fp6::inv(z, x, true);
+		CYBOZU_TEST_EQUAL(z, y);
 		Fp6::mul(z, y, x);
 		CYBOZU_TEST_EQUAL(z, 1);
 		x += y;
@@ -250,9 +291,40 @@ void testFp12()
 	y *= y;
 	Fp12::sqr(x, x);
 	CYBOZU_TEST_EQUAL(x, y);
+	// compare with the schoolbook method
+	cybozu::XorShift rg;
+	for (int i = 0; i < 100; i++) {
+		Fp *px = x.getFp0();
+		Fp *py = y.getFp0();
+		for (int j = 0; j < 12; j++) {
+			if (i == 0) {
+				px[j] = -1;
+				py[j] = -1;
+			} else {
+				px[j].setByCSPRNG(rg);
+				py[j].setByCSPRNG(rg);
+			}
+		}
+		Fp12::mul(z, x, y);
+		Fp6 t = x.b * y.b;
+		Fp2::mul_xi(t.c, t.c);
+		w.a = Fp6(t.c, t.a, t.b) + x.a * y.a;
+		w.b = x.a * y.b + x.b * y.a;
+		CYBOZU_TEST_EQUAL(z, w);
+		// same address
+		w = x;
+		Fp12::mul(w, w, y);
+		CYBOZU_TEST_EQUAL(z, w);
+		w = y;
+		Fp12::mul(w, x, w);
+		CYBOZU_TEST_EQUAL(z, w);
+	}
+	x = Fp12(xa, xb);
 	for (int i = 0; i < 10; i++) {
 		w = x;
 		Fp12::inv(w, w);
+		Fp12::inv(z, x, true);
+		CYBOZU_TEST_EQUAL(z, w);
 		Fp12::mul(y, w, x);
 		CYBOZU_TEST_EQUAL(y, 1);
 		x += y;
@@ -400,6 +472,53 @@ void benchFp2()
 	printf("add %8.2f|sub %8.2f|mul %8.2f|sqr %8.2f|inv %8.2f|mul_xi %8.2f\n", addT, subT, mulT, sqrT, invT, mul_xiT);
 }
 
+template<class T>
+void testInvVec1(T *x, size_t n, cybozu::XorShift& rg)
+{
+	const size_t maxN = 40;
+	T y[maxN], z[maxN];
+	size_t retN = 0;
+	for (size_t i = 0; i < n; i++) {
+		// Fp2, Fp6 and Fp12 have no setByCSPRNG
+		Fp *p = x[i].getFp0();
+		for (size_t j = 0; j < sizeof(T) / sizeof(Fp); j++) {
+			p[j].setByCSPRNG(rg);
+		}
+		if (i % 5 == 1) { // 0 or 1
+			x[i].clear();
+			p[0] = int(i % 2);
+		}
+		if (!(x[i].isZero() || x[i].isOne())) retN++;
+		if (x[i].isZero()) {
+			y[i].clear();
+		} else {
+			T::inv(y[i], x[i]);
+		}
+	}
+	CYBOZU_TEST_EQUAL(T::invVec(z, x, n), retN);
+	CYBOZU_TEST_EQUAL_ARRAY(z, y, n);
+	CYBOZU_TEST_EQUAL(T::invVecMT(z, x, n, 2), retN);
+	CYBOZU_TEST_EQUAL_ARRAY(z, y, n);
+	T::invVec(x, x, n); // same addr
+	CYBOZU_TEST_EQUAL_ARRAY(x, y, n);
+}
+
+void testInvVec()
+{
+	const size_t maxN = 40;
+	cybozu::XorShift rg;
+	const size_t nTbl[] = { 0, 1, 2, 7, 33, maxN };
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(nTbl); i++) {
+		const size_t n = nTbl[i];
+		Fp2 x2[maxN];
+		testInvVec1(x2, n, rg);
+		Fp6 x6[maxN];
+		testInvVec1(x6, n, rg);
+		Fp12 x12[maxN];
+		testInvVec1(x12, n, rg);
+	}
+}
+
 void test(const char *p, mcl::fp::Mode mode)
 {
 	const int xi_a = 1;
@@ -424,6 +543,7 @@ void test(const char *p, mcl::fp::Mode mode)
 	testFpDbl();
 	testFp6();
 	testFp12();
+	testInvVec();
 	testIo();
 }
 
@@ -101,6 +101,59 @@ void testGLV(const G& P, const char *name)
 	}
 }
 
+template<class GLV>
+void splitByMpz(mpz_class u[], const Fr& x)
+{
+	mpz_class y = x.getMpz();
+	GLV::split(u, y);
+}
+
+template<class GLV>
+void splitUnit(bool isNeg[], mcl::Unit u[][GLV::splitUnitN], const Fr& x)
+{
+	mcl::Unit y[GLV::splitUnitN];
+	x.getUnitArray(y);
+	GLV::splitUnit(isNeg, u, y, Fr::getUnitSize());
+}
+
+template<class GLV, class G>
+void testSplitUnit(const G& P, const char *name)
+{
+	printf("testSplitUnit %s\n", name);
+	const int splitN = GLV::splitN;
+	const size_t N = GLV::splitUnitN;
+	cybozu::XorShift rg;
+	mpz_class u[splitN];
+	mcl::Unit ua[splitN][N];
+	bool isNeg[splitN];
+	for (int i = 0; i < 1000; i++) {
+		Fr x;
+		if (i < 100) {
+			x = i - 50;
+		} else {
+			x.setByCSPRNG(rg);
+		}
+		splitByMpz<GLV>(u, x);
+		splitUnit<GLV>(isNeg, ua, x);
+		for (int j = 0; j < splitN; j++) {
+			mpz_class t;
+			mcl::gmp::setArray(t, ua[j], N);
+			if (isNeg[j]) t = -t;
+			CYBOZU_TEST_EQUAL(t, u[j]);
+		}
+	}
+#ifdef NDEBUG
+	Fr x;
+	x.setByCSPRNG(rg);
+	G Q;
+	CYBOZU_BENCH_C("split(mpz)", 10000, splitByMpz<GLV>, u, x);
+	CYBOZU_BENCH_C("splitUnit ", 10000, splitUnit<GLV>, isNeg, ua, x);
+	CYBOZU_BENCH_C("G::mul    ", 1000, G::mul, Q, P, x);
+#else
+	(void)P;
+#endif
+}
+
 template<class G>
 void naiveMulVec(G& out, const G *xVec, const Fr *yVec, size_t n)
 {
@@ -124,6 +177,26 @@ void mulVecCopy(G& z, G *x, const Fr *y, size_t n, const G* x0)
 	G::mulVec(z, x, y, n);
 }
 
+template<class G>
+void mulVecWorkCopy(G& z, G *x, const Fr *y, size_t n, const G* x0, void *work, size_t workSize)
+{
+	for (size_t i = 0; i < n; i++) x[i] = x0[i];
+	G::mulVec(z, x, y, n, work, workSize);
+}
+
+template<class G>
+void mulVecWindowMT(G& z, const G *xVec, const Fr *yVec, size_t n, size_t cpuN)
+{
+	const size_t yUnitSize = Fr::getUnitSize();
+	std::vector<mcl::Unit> y(yUnitSize * n);
+	std::vector<G> x(n);
+	for (size_t i = 0; i < n; i++) {
+		yVec[i].getUnitArray(&y[yUnitSize * i]);
+	}
+	G::normalizeVec(x.data(), xVec, n);
+	CYBOZU_TEST_ASSERT(mcl::ec::mulVecWindowMT(z, x.data(), y.data(), yUnitSize, yUnitSize, n, cpuN));
+}
+
 template<class G>
 void testMulVec(const G& P, const char *name)
 {
@@ -147,13 +220,227 @@ void testMulVec(const G& P, const char *name)
 		naiveMulVec(Q1, xVec.data(), yVec.data(), n);
 		G::mulVec(Q2, xVec.data(), yVec.data(), n);
 		CYBOZU_TEST_EQUAL(Q1, Q2);
+		G::setMulVecMode(mcl::ec::MulVecBatchAffine);
+		G::mulVec(Q2, xVec.data(), yVec.data(), n);
+		G::setMulVecMode(mcl::ec::MulVecJacobi);
+		CYBOZU_TEST_EQUAL(Q1, Q2);
+		std::vector<uint64_t> work((G::getMulVecWorkSize(n) + 7) / 8);
+		CYBOZU_TEST_EQUAL(work.empty(), 16 < n && n < 128);
+		Q2.clear();
+		G::mulVec(Q2, xVec.data(), yVec.data(), n, work.data(), work.size() * 8);
+		CYBOZU_TEST_EQUAL(Q1, Q2);
+		// too small work is ignored
+		Q2.clear();
+		G::mulVec(Q2, xVec.data(), yVec.data(), n, work.data(), work.size() * 8 / 2);
+		CYBOZU_TEST_EQUAL(Q1, Q2);
+		if (!work.empty()) {
+			// unaligned work is ignored
+			work.resize(work.size() + 1);
+			Q2.clear();
+			G::mulVec(Q2, xVec.data(), yVec.data(), n, (char*)work.data() + 1, (work.size() - 1) * 8);
+			CYBOZU_TEST_EQUAL(Q1, Q2);
+		}
+		if (n >= 128) {
+			const size_t cpuNTbl[] = { 1, 3, 8, 64 };
+			for (size_t j = 0; j < CYBOZU_NUM_OF_ARRAY(cpuNTbl); j++) {
+				Q2.clear();
+				mulVecWindowMT(Q2, xVec.data(), yVec.data(), n, cpuNTbl[j]);
+				CYBOZU_TEST_EQUAL(Q1, Q2);
+			}
+			Q2.clear();
+			G::mulVecMT(Q2, xVec.data(), yVec.data(), n);
+			CYBOZU_TEST_EQUAL(Q1, Q2);
+			work.resize((G::getMulVecMTWorkSize(n, 3) + 7) / 8);
+			Q2.clear();
+			G::mulVecMT(Q2, xVec.data(), yVec.data(), n, 3, work.data(), work.size() * 8);
+			CYBOZU_TEST_EQUAL(Q1, Q2);
+		}
 #ifdef NDEBUG
 		printf("n=%zd\n", n);
 		const int C = 10;
 		CYBOZU_BENCH_C("naive ", C, naiveMulVec, Q1, xVec.data(), yVec.data(), n);
 		CYBOZU_BENCH_C("mulVec", C, mulVecCopy, Q1, xVec.data(), yVec.data(), n, x0Vec.data());
+		work.resize((G::getMulVecWorkSize(n) + 7) / 8);
+		CYBOZU_BENCH_C("mulVecWork", C, mulVecWorkCopy<G>, Q1, xVec.data(), yVec.data(), n, x0Vec.data(), (void*)work.data(), work.size() * 8);
+		G::setMulVecMode(mcl::ec::MulVecBatchAffine);
+		CYBOZU_BENCH_C("mulVecBatchAffine", C, mulVecCopy, Q1, xVec.data(), yVec.data(), n, x0Vec.data());
+		G::setMulVecMode(mcl::ec::MulVecJacobi);
+#endif
+	}
+}
+
+template<class G>
+void naiveMulEach(G *zVec, const G *xVec, const Fr *yVec, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		G::mul(zVec[i], xVec[i], yVec[i]);
+	}
+}
+
+template<class G>
+void testMulEach(const G& P, const char *name)
+{
+	printf("testMulEach %s\n", name);
+	const size_t N = 100;
+	std::vector<G> xVec(N), zVec(N), wVec(N);
+	std::vector<Fr> yVec(N);
+	cybozu::XorShift rg;
+	for (size_t i = 0; i < N; i++) {
+		G::mul(xVec[i], P, i + 3);
+		yVec[i].setByCSPRNG(rg);
+	}
+	// zero point, zero, small and negative scalars
+	xVec[1].clear();
+	yVec[2] = 0;
+	yVec[3] = 1;
+	yVec[4] = -1;
+	yVec[5] = 12345;
+	naiveMulEach(wVec.data(), xVec.data(), yVec.data(), N);
+	const size_t nTbl[] = { 1, 7, 8, 9, 17, N };
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(nTbl); i++) {
+		const size_t n = nTbl[i];
+		G::mulEach(zVec.data(), xVec.data(), yVec.data(), n);
+		for (size_t j = 0; j < n; j++) {
+			CYBOZU_TEST_ASSERT(zVec[j].isNormalized());
+			CYBOZU_TEST_EQUAL(zVec[j], wVec[j]);
+		}
+		const size_t cpuNTbl[] = { 0, 1, 3, 200 };
+		for (size_t j = 0; j < CYBOZU_NUM_OF_ARRAY(cpuNTbl); j++) {
+			G::mulEachMT(zVec.data(), xVec.data(), yVec.data(), n, cpuNTbl[j]);
+			for (size_t k = 0; k < n; k++) {
+				CYBOZU_TEST_EQUAL(zVec[k], wVec[k]);
+			}
+		}
+	}
+	// zVec == xVec
+	zVec = xVec;
+	G::mulEach(zVec.data(), zVec.data(), yVec.data(), N);
+	for (size_t i = 0; i < N; i++) {
+		CYBOZU_TEST_EQUAL(zVec[i], wVec[i]);
+	}
+#ifdef NDEBUG
+	CYBOZU_BENCH_C("mul     ", 10, naiveMulEach, zVec.data(), xVec.data(), yVec.data(), N);
+	CYBOZU_BENCH_C("mulEach ", 10, G::mulEach, zVec.data(), xVec.data(), yVec.data(), N);
+#endif
+}
+
+template<class GLV, class G>
+void testFixedBaseMul(const G& P, const char *name)
+{
+	printf("testFixedBaseMul %s\n", name);
+	typedef mcl::fp::FixedBaseMul<G, GLV> FBM;
+	cybozu::XorShift rg;
+	const size_t tbl[][2] = {
+		{ 0, 2 }, { 1, 1 }, { 4, 3 }, { 8, 1 },
+	};
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(tbl); i++) {
+		FBM fbm(P, Fr::getBitSize(), tbl[i][0], tbl[i][1]);
+		G Q1, Q2;
+		for (int j = 0; j < 100; j++) {
+			Fr x;
+			if (j < 10) {
+				x = j - 5;
+			} else {
+				x.setByCSPRNG(rg);
+			}
+			fbm.mul(Q1, x);
+			G::mul(Q2, P, x);
+			CYBOZU_TEST_EQUAL(Q1, Q2);
+		}
+		// not reduced by r
+		mpz_class t = Fr::getOp().mp * 3 + 12345;
+		fbm.mul(Q1, t);
+		G::mul(Q2, P, t);
+		CYBOZU_TEST_EQUAL(Q1, Q2);
+		fbm.mul(Q1, -t);
+		G::mul(Q2, P, -t);
+		CYBOZU_TEST_EQUAL(Q1, Q2);
+	}
+#ifdef NDEBUG
+	Fr x;
+	x.setByCSPRNG(rg);
+	G Q;
+	CYBOZU_BENCH_C("G::mul          ", 1000, G::mul, Q, P, x);
+	const size_t hTbl[] = { 4, 6, 8, 10 };
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(hTbl); i++) {
+		FBM fbm(P, Fr::getBitSize(), hTbl[i]);
+		printf("h=%2zd tblSize=%5zd ", hTbl[i], fbm.getTableSize());
+		CYBOZU_BENCH_C("mul", 1000, fbm.mul, Q, x);
+	}
 #endif
+}
+
+// the same points, opposite points and zero in the same bucket
+template<class G>
+void testMulVecBatchAffine(const G& P, const char *name)
+{
+	printf("testMulVecBatchAffine %s\n", name);
+	const size_t n = 300;
+	std::vector<G> xVec(n);
+	std::vector<Fr> yVec(n);
+	cybozu::XorShift rg;
+	for (size_t i = 0; i < n; i++) {
+		switch (i % 4) {
+		case 0: xVec[i] = P; break;
+		case 1: G::neg(xVec[i], P); break;
+		case 2: G::dbl(xVec[i], P); break;
+		default: xVec[i].clear(); break;
+		}
+		if (i % 3 == 0) {
+			yVec[i] = 1;
+		} else if (i % 3 == 1) {
+			yVec[i] = -1;
+		} else {
+			yVec[i].setByCSPRNG(rg);
+		}
 	}
+	G::setMulVecMode(mcl::ec::MulVecBatchAffine);
+	const size_t nTbl[] = { 128, 129, 200, n };
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(nTbl); i++) {
+		G Q1, Q2;
+		naiveMulVec(Q1, xVec.data(), yVec.data(), nTbl[i]);
+		G::mulVec(Q2, xVec.data(), yVec.data(), nTbl[i]);
+		CYBOZU_TEST_EQUAL(Q1, Q2);
+	}
+	for (size_t i = 0; i < n; i++) yVec[i] = 0;
+	G Q;
+	G::mulVec(Q, xVec.data(), yVec.data(), n);
+	CYBOZU_TEST_ASSERT(Q.isZero());
+	G::setMulVecMode(mcl::ec::MulVecJacobi);
+}
+
+/*
+	many digits of the same bucket must not make the rounds of the batch O(n)
+	compare the clk of MulVecBatchAffine with MulVecJacobi for equal scalars
+*/
+template<class G>
+void testMulVecBatchAffineSameScalar(const G& P, const char *name)
+{
+	const size_t n = 4096;
+	std::vector<G> xVec(n);
+	std::vector<Fr> yVec(n);
+	xVec[0] = P;
+	for (size_t i = 1; i < n; i++) {
+		G::add(xVec[i], xVec[i - 1], P);
+	}
+	G::normalizeVec(xVec.data(), xVec.data(), n);
+	for (size_t i = 0; i < n; i++) yVec[i] = 1;
+	const int modeTbl[] = { mcl::ec::MulVecJacobi, mcl::ec::MulVecBatchAffine };
+	uint64_t clk[2];
+	G Q[2];
+	for (size_t i = 0; i < 2; i++) {
+		G::setMulVecMode(modeTbl[i]);
+		clk[i] = uint64_t(-1);
+		for (int j = 0; j < 3; j++) {
+			const uint64_t begin = cybozu::CpuClock::getCpuClk();
+			G::mulVec(Q[i], xVec.data(), yVec.data(), n);
+			clk[i] = std::min(clk[i], cybozu::CpuClock::getCpuClk() - begin);
+		}
+	}
+	G::setMulVecMode(mcl::ec::MulVecJacobi);
+	printf("same scalar %s n=%zd jacobi=%.2fMclk batchAffine=%.2fMclk\n", name, n, clk[0] * 1e-6, clk[1] * 1e-6);
+	CYBOZU_TEST_EQUAL(Q[0], Q[1]);
+	CYBOZU_TEST_ASSERT(clk[1] < clk[0] * 4);
 }
 
 void naivePowVec(GT& out, const GT *xVec, const Fr *yVec, size_t n)
@@ -193,6 +480,20 @@ void testPowVec(const GT& e)
 		naivePowVec(Q1, xVec.data(), yVec.data(), n);
 		GT::powVec(Q2, xVec.data(), yVec.data(), n);
 		CYBOZU_TEST_EQUAL(Q1, Q2);
+		std::vector<uint64_t> work((GT::getPowVecWorkSize(n) + 7) / 8);
+		CYBOZU_TEST_ASSERT(!work.empty());
+		Q2.clear();
+		GT::powVec(Q2, xVec.data(), yVec.data(), n, work.data(), work.size() * 8);
+		CYBOZU_TEST_EQUAL(Q1, Q2);
+		// unaligned work is ignored
+		work.resize(work.size() + 1);
+		Q2.clear();
+		GT::powVec(Q2, xVec.data(), yVec.data(), n, (char*)work.data() + 1, (work.size() - 1) * 8);
+		CYBOZU_TEST_EQUAL(Q1, Q2);
+		work.resize((GT::getPowVecMTWorkSize(n, 3) + 7) / 8);
+		Q2.clear();
+		GT::powVecMT(Q2, xVec.data(), yVec.data(), n, 3, work.data(), work.size() * 8);
+		CYBOZU_TEST_EQUAL(Q1, Q2);
 #ifdef NDEBUG
 		const int C = 10;
 		CYBOZU_BENCH_C("naive ", C, naivePowVec, Q1, xVec.data(), yVec.data(), n);
@@ -248,9 +549,18 @@ CYBOZU_TEST_AUTO(glv)
 		pairing(e, P, Q);
 		testGLV(P, "G1");
 		testGLV(Q, "G2");
+		testSplitUnit<mcl::bn::local::GLV1>(P, "G1");
+		testSplitUnit<mcl::bn::local::GLV2>(Q, "G2");
 		testGT(e);
 		testMulVec(P, "G1");
 		testMulVec(Q, "G2");
+		testMulEach(P, "G1");
+		testMulEach(Q, "G2");
+		testFixedBaseMul<mcl::bn::local::GLV1>(P, "G1");
+		testFixedBaseMul<mcl::bn::local::GLV2>(Q, "G2");
+		testMulVecBatchAffine(P, "G1");
+		testMulVecBatchAffine(Q, "G2");
+		testMulVecBatchAffineSameScalar(P, "G1");
 		testPowVec(e);
 	}
 }
@@ -48,3 +48,58 @@ CYBOZU_TEST_AUTO(int)
 	Ec::mul(R, P, y);
 	CYBOZU_TEST_EQUAL(Q, R);
 }
+
+CYBOZU_TEST_AUTO(FixedBaseMul)
+{
+	typedef mcl::FpT<> Fp;
+	typedef mcl::EcT<Fp> Ec;
+	const struct mcl::EcParam& para = mcl::ecparam::secp192k1;
+	Fp::init(para.p);
+	Ec::init(para.a, para.b);
+	const Fp x(para.gx);
+	const Fp y(para.gy);
+	const Ec P(x, y);
+
+	typedef mcl::fp::FixedBaseMul<Ec> FBM;
+	const size_t bitSize = 13;
+	Ec Q, R;
+
+	const size_t tbl[][2] = {
+		{ 1, 1 }, { 1, 5 }, { 3, 1 }, { 3, 2 }, { 4, 4 }, { 13, 1 },
+	};
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(tbl); i++) {
+		FBM fbm(P, bitSize, tbl[i][0], tbl[i][1]);
+		for (int j = -3; j < (1 << bitSize); j++) {
+			fbm.mul(Q, j);
+			Ec::mul(R, P, j);
+			CYBOZU_TEST_EQUAL(Q, R);
+		}
+		// larger than bitSize
+		fbm.mul(Q, x);
+		Ec::mul(R, P, x);
+		CYBOZU_TEST_EQUAL(Q, R);
+	}
+	FBM fbm(P, para.bitSize);
+	CYBOZU_TEST_EQUAL(fbm.getTableSize(), 2u * 511);
+	fbm.mul(Q, -12345);
+	Ec::mul(R, P, -12345);
+	CYBOZU_TEST_EQUAL(Q, R);
+	mpz_class t(para.gx);
+	fbm.mul(Q, t);
+	Ec::mul(R, P, t);
+	CYBOZU_TEST_EQUAL(Q, R);
+	t = -t;
+	fbm.mul(Q, t);
+	Ec::mul(R, P, t);
+	CYBOZU_TEST_EQUAL(Q, R);
+
+	fbm.mul(Q, x);
+	Ec::mul(R, P, x);
+	CYBOZU_TEST_EQUAL(Q, R);
+
+	fbm.mul(Q, y);
+	Ec::mul(R, P, y);
+	CYBOZU_TEST_EQUAL(Q, R);
+	CYBOZU_TEST_EXCEPTION(fbm.init(P, 0), cybozu::Exception);
+	CYBOZU_TEST_EXCEPTION(fbm.init(P, bitSize, 17), cybozu::Exception);
+}